@@ -0,0 +1,121 @@
+#version 330
+
+// affichage des particules en GL_POINTS, un sommet par particule :
+// imposteur= 1 : le point couvre la projection de la sphere, chaque fragment lance un rayon depuis
+//                la camera, calcule l'intersection avec la sphere et ecrit la profondeur du point touche ;
+// imposteur= 0 : point de taille fixe, couleur sans eclairage.
+
+#ifdef VERTEX_SHADER
+
+layout(location= 4) in vec3 centre;         // position de la particule
+layout(location= 5) in float valeur;        // densite ou vitesse (coloration)
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform vec4 viewport;
+uniform int imposteur= 1;
+uniform float rayon= 0.05;
+uniform float taille_point= 3;
+
+out vec3 vertex_centre;
+out float vertex_valeur;
+
+void main( )
+{
+    vec4 c= viewMatrix * vec4(centre, 1);
+    vertex_centre= c.xyz;
+    vertex_valeur= valeur;
+    gl_Position= projectionMatrix * c;
+
+    if(imposteur == 0)
+    {
+        gl_PointSize= taille_point;
+        return;
+    }
+
+    // sphere derriere la camera ou camera dans la sphere : rien a dessiner
+    float dist= -c.z - rayon;
+    if(dist <= 0.0)
+    {
+        gl_Position= vec4(2, 2, 2, 1);
+        gl_PointSize= 1;
+        return;
+    }
+
+    // diametre projete, agrandi pour couvrir l'ellipse des spheres eloignees de l'axe de vue
+    gl_PointSize= 1.2 * rayon * projectionMatrix[1][1] * viewport.w / dist;
+}
+#endif
+
+
+#ifdef FRAGMENT_SHADER
+
+in vec3 vertex_centre;
+in float vertex_valeur;
+
+uniform mat4 projectionMatrix;
+uniform mat4 projectionInvMatrix;
+uniform vec4 viewport;
+uniform int imposteur= 1;
+uniform float rayon= 0.05;
+
+uniform vec4 mesh_color= vec4(0, 0, 1, 1);
+uniform int use_valeur= 0;
+uniform float valeur_min= 0;
+uniform float valeur_max= 1;
+
+uniform vec3 light;
+uniform vec4 light_color= vec4(1, 1, 1, 1);
+
+out vec4 fragment_color;
+
+// palette bleu -> cyan -> vert -> jaune -> rouge
+vec3 palette( const float t )
+{
+    return clamp(vec3(1.5 - abs(4.0 * t - 3.0), 1.5 - abs(4.0 * t - 2.0), 1.5 - abs(4.0 * t - 1.0)), 0.0, 1.0);
+}
+
+void main( )
+{
+    vec4 color= mesh_color;
+    if(use_valeur != 0)
+    {
+        float t= (vertex_valeur - valeur_min) / max(valeur_max - valeur_min, 1e-6);
+        color= vec4(palette(clamp(t, 0.0, 1.0)), 1);
+    }
+
+    if(imposteur == 0)
+    {
+        // disque plat
+        vec2 p= gl_PointCoord * 2.0 - 1.0;
+        if(dot(p, p) > 1)
+            discard;
+
+        gl_FragDepth= gl_FragCoord.z;
+        fragment_color= vec4(color.rgb * light_color.rgb, 1);
+        return;
+    }
+
+    // rayon camera -> fragment, dans le repere camera
+    vec2 ndc= (gl_FragCoord.xy - viewport.xy) / viewport.zw * 2.0 - 1.0;
+    vec4 q= projectionInvMatrix * vec4(ndc, -1, 1);
+    vec3 d= normalize(q.xyz / q.w);
+
+    // intersection avec la sphere : |t.d - c|^2 = r^2
+    float b= dot(d, vertex_centre);
+    float delta= b * b - dot(vertex_centre, vertex_centre) + rayon * rayon;
+    if(delta < 0)
+        discard;
+
+    vec3 p= (b - sqrt(delta)) * d;
+    vec3 normal= (p - vertex_centre) / rayon;
+
+    // profondeur du point de la sphere, meme transformation que le pipeline
+    vec4 clip= projectionMatrix * vec4(p, 1);
+    float z= clip.z / clip.w;
+    gl_FragDepth= (gl_DepthRange.diff * z + gl_DepthRange.near + gl_DepthRange.far) * 0.5;
+
+    float cos_theta= max(0, dot(normal, normalize(light - p)));
+    fragment_color= vec4(color.rgb * light_color.rgb * (0.2 + 0.8 * cos_theta), 1);
+}
+#endif
@@ -0,0 +1,66 @@
+#version 330
+
+// affichage instancie des particules : un seul draw pour toutes les spheres,
+// chaque instance est translatee au centre de sa particule.
+
+#ifdef VERTEX_SHADER
+
+layout(location= 0) in vec3 position;       // sommet de la sphere, centree en 0
+layout(location= 4) in vec3 centre;         // par instance : position de la particule
+layout(location= 5) in float valeur;        // par instance : densite ou vitesse (coloration)
+
+uniform mat4 vpMatrix;
+uniform mat4 viewMatrix;
+
+out vec3 vertex_position;
+out vec3 vertex_normal;
+out float vertex_valeur;
+
+void main( )
+{
+    gl_Position= vpMatrix * vec4(position + centre, 1);
+
+    vertex_position= vec3(viewMatrix * vec4(position + centre, 1));
+    vertex_normal= mat3(viewMatrix) * normalize(position);
+    vertex_valeur= valeur;
+}
+#endif
+
+
+#ifdef FRAGMENT_SHADER
+
+in vec3 vertex_position;
+in vec3 vertex_normal;
+in float vertex_valeur;
+
+uniform vec4 mesh_color= vec4(0, 0, 1, 1);
+uniform int use_valeur= 0;
+uniform float valeur_min= 0;
+uniform float valeur_max= 1;
+
+uniform vec3 light;
+uniform vec4 light_color= vec4(1, 1, 1, 1);
+
+out vec4 fragment_color;
+
+// palette bleu -> cyan -> vert -> jaune -> rouge
+vec3 palette( const float t )
+{
+    return clamp(vec3(1.5 - abs(4.0 * t - 3.0), 1.5 - abs(4.0 * t - 2.0), 1.5 - abs(4.0 * t - 1.0)), 0.0, 1.0);
+}
+
+void main( )
+{
+    vec4 color= mesh_color;
+    if(use_valeur != 0)
+    {
+        float t= (vertex_valeur - valeur_min) / max(valeur_max - valeur_min, 1e-6);
+        color= vec4(palette(clamp(t, 0.0, 1.0)), 1);
+    }
+
+    vec3 normal= normalize(vertex_normal);
+    float cos_theta= max(0, dot(normal, normalize(light - vertex_position)));
+
+    fragment_color= vec4(color.rgb * light_color.rgb * (0.2 + 0.8 * cos_theta), 1);
+}
+#endif
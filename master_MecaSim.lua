@@ -16,3 +16,50 @@ project("master_MecaSim_etudiant")
 	includedirs { gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/" }
     files ( gkit_files )
     files ( master_MecaSim_files )
+    excludes { gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/main-batch.cpp",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/main-bench.cpp" }
+	configuration "linux"
+		-- racines sans errno : les boucles des noyaux de lissage (NoyauxSIMD.cpp) sont vectorisees
+		buildoptions { "-fno-math-errno" }
+
+-- simulation sans fenetre (ni SDL, ni OpenGL) : seuls les calculs de gKit sont compiles
+master_MecaSim_batch_gkit_files = {	gkit_dir .. "/src/gKit/vec.cpp", gkit_dir .. "/src/gKit/vec.h",
+									gkit_dir .. "/src/gKit/mat.cpp", gkit_dir .. "/src/gKit/mat.h",
+									gkit_dir .. "/src/gKit/color.cpp", gkit_dir .. "/src/gKit/color.h"
+	}
+
+project("master_MecaSim_batch")
+    language "C++"
+    kind "ConsoleApp"
+    targetdir ( gfx_masterMecaSim_dir .. "/bin" )
+	includedirs { gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/" }
+	defines { "MECASIM_HEADLESS" }
+    files ( master_MecaSim_batch_gkit_files )
+    files ( master_MecaSim_files )
+    excludes { gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/main.cpp",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/main-bench.cpp",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/Viewer*.cpp",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/Viewer*.h",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/RenduParticules*" }
+	configuration "linux"
+		-- les bibliotheques graphiques de la solution ne sont pas chargees si elles ne sont pas utilisees
+		linkoptions { "-Wl,--as-needed" }
+		buildoptions { "-fno-math-errno" }
+
+-- micro-benchmarks des calculs SPH (sans fenetre), resultats en JSON
+project("master_MecaSim_bench")
+    language "C++"
+    kind "ConsoleApp"
+    targetdir ( gfx_masterMecaSim_dir .. "/bin" )
+	includedirs { gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/" }
+	defines { "MECASIM_HEADLESS" }
+    files ( master_MecaSim_batch_gkit_files )
+    files ( master_MecaSim_files )
+    excludes { gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/main.cpp",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/main-batch.cpp",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/Viewer*.cpp",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/Viewer*.h",
+               gfx_masterMecaSim_dir .. "/src/master_MecaSim/src-etudiant/RenduParticules*" }
+	configuration "linux"
+		linkoptions { "-Wl,--as-needed" }
+		buildoptions { "-fno-math-errno" }
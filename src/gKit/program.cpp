@@ -6,8 +6,135 @@
 #include <algorithm>
 
 #include <climits>
+#include <unordered_map>
 
-#include "program.h"
+#include "program.h"
+
+
+// cache des uniforms de chaque program : identifiant et type, par nom, et premiere utilisation (cf uniforms.cpp).
+struct UniformInfo
+{
+    GLint location;
+    GLenum type;
+    bool used;
+};
+
+typedef std::unordered_map<std::string, UniformInfo> UniformCache;
+
+static
+std::unordered_map<GLuint, UniformCache>& uniform_caches( )
+{
+    static std::unordered_map<GLuint, UniformCache> caches;
+    return caches;
+}
+
+// remplit le cache avec les uniforms actifs du program, apres l'edition de liens.
+static
+void cache_uniforms( const GLuint program )
+{
+    UniformCache& cache= uniform_caches()[program];
+    cache.clear();
+
+    GLint count= 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    GLint length= 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &length);
+    if(count == 0 || length == 0)
+        return;
+
+    std::vector<char> name(length +1, 0);
+    for(int i= 0; i < count; i++)
+    {
+        GLint size= 0;
+        GLenum type= 0;
+        glGetActiveUniform(program, i, (GLsizei) name.size(), NULL, &size, &type, &name.front());
+
+        // les uniforms des blocs n'ont pas d'identifiant : -1
+        UniformInfo info= { glGetUniformLocation(program, &name.front()), type, false };
+        std::string key(&name.front());
+        cache[key]= info;
+
+        // tableau : "values[0]" est aussi accessible avec "values"
+        size_t b= key.rfind("[0]");
+        if(b != std::string::npos && b + 3 == key.size())
+            cache[key.substr(0, b)]= info;
+    }
+}
+
+static
+void release_uniforms( const GLuint program )
+{
+    uniform_caches().erase(program);
+}
+
+static
+UniformInfo *find_uniform( const GLuint program, const char *uniform )
+{
+    if(program == 0)
+        return NULL;
+
+    std::unordered_map<GLuint, UniformCache>::iterator p= uniform_caches().find(program);
+    if(p == uniform_caches().end())
+    {
+        // program cree sans read_program( ) / reload_program( ) : construit le cache maintenant
+        GLint status= GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if(status == GL_FALSE)
+            return NULL;
+
+        cache_uniforms(program);
+        p= uniform_caches().find(program);
+    }
+
+    UniformCache::iterator u= p->second.find(uniform);
+    if(u == p->second.end())
+    {
+        // element d'un tableau ("values[3]"), absent de la liste des uniforms actifs : une seule requete openGL,
+        // le resultat est conserve dans le cache, meme si l'uniform n'existe pas (identifiant -1, type GL_NONE)
+        UniformInfo info= { glGetUniformLocation(program, uniform), GL_NONE, false };
+        if(info.location >= 0)
+        {
+            // type de l'element : celui du tableau, cf "values" dans cache_uniforms( )
+            std::string key(uniform);
+            size_t b= key.rfind('[');
+            if(b != std::string::npos && key.back() == ']')
+            {
+                UniformCache::const_iterator t= p->second.find(key.substr(0, b));
+                if(t != p->second.end())
+                    info.type= t->second.type;
+            }
+        }
+
+        u= p->second.insert(std::make_pair(std::string(uniform), info)).first;
+    }
+
+    if(u->second.location < 0 && u->second.type == GL_NONE)
+        return NULL;
+    return &u->second;
+}
+
+GLint program_uniform_location( const GLuint program, const char *uniform )
+{
+    const UniformInfo *info= find_uniform(program, uniform);
+    return info ? info->location : -1;
+}
+
+GLint program_uniform_location( const GLuint program, const char *uniform, bool& first )
+{
+    UniformInfo *info= find_uniform(program, uniform);
+    first= (info != NULL && info->used == false);
+    if(info == NULL)
+        return -1;
+
+    info->used= true;
+    return info->location;
+}
+
+GLenum program_uniform_type( const GLuint program, const char *uniform )
+{
+    const UniformInfo *info= find_uniform(program, uniform);
+    return info ? info->type : GL_NONE;
+}
 
 
 // charge un fichier texte.
@@ -99,6 +226,9 @@ int reload_program( GLuint program, const char *filename, const char *definition
     if(program == 0)
         return -1;
 
+    // les identifiants des uniforms changent avec les sources
+    release_uniforms(program);
+
     // supprime les shaders attaches au program
     int shaders_max= 0;
     glGetProgramiv(program, GL_ATTACHED_SHADERS, &shaders_max);
@@ -138,9 +268,12 @@ int reload_program( GLuint program, const char *filename, const char *definition
         if(fragment_shader == 0)
             printf("[error] compiling fragment shader...\n%s\n", definitions);
         printf("[error] linking program %u '%s'...\n", program, filename);
+        uniform_caches()[program];      // cache vide, pas d'uniforms
         return -1;
     }
 
+    cache_uniforms(program);
+
     // pour etre coherent avec les autres fonctions de creation, active l'objet gl qui vient d'etre cree.
     glUseProgram(program);
     return 0;
@@ -170,6 +303,7 @@ int release_program( const GLuint program )
         glDeleteShader(shaders[i]);
     }
 
+    release_uniforms(program);
     glDeleteProgram(program);
     return 0;
 }
@@ -31,5 +31,17 @@ int program_format_errors( const GLuint program, std::string& errors );
 //! affiche les erreurs de compilation.
 int program_print_errors( const GLuint program );
 
+//! renvoie l'identifiant d'un uniform du program, ou -1 s'il n'existe pas.\n
+//! les identifiants et les types des uniforms sont lus une seule fois, apres l'edition de liens du program, et conserves
+//! dans un cache (par program et par nom) : pas de requete openGL. le cache est vide par reload_program( ) et release_program( ).
+GLint program_uniform_location( const GLuint program, const char *uniform );
+
+//! renvoie l'identifiant d'un uniform du program, ou -1 s'il n'existe pas, comme program_uniform_location( ).\n
+//! first vaut true lors de la premiere recherche de l'uniform depuis la construction du cache (verifications a ne faire qu'une fois).
+GLint program_uniform_location( const GLuint program, const char *uniform, bool& first );
+
+//! renvoie le type openGL (GL_FLOAT, GL_FLOAT_VEC3, GL_SAMPLER_2D, etc.) d'un uniform du program, ou GL_NONE s'il n'existe pas.
+GLenum program_uniform_type( const GLuint program, const char *uniform );
+
 ///@}
 #endif
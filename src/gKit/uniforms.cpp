@@ -13,8 +13,9 @@ int location( const GLuint program, const char *uniform )
     if(program == 0) 
         return -1;
     
-    // recuperer l'identifiant de l'uniform dans le program
-    GLint location= glGetUniformLocation(program, uniform);
+    // recuperer l'identifiant de l'uniform dans le program, cf le cache de program.cpp
+    bool first= false;
+    GLint location= program_uniform_location(program, uniform, first);
     if(location < 0)
     {
         char error[1024]= { 0 };
@@ -38,27 +39,31 @@ int location( const GLuint program, const char *uniform )
     }
     
 #ifndef GK_RELEASE
-    // verifier que le program est bien en cours d'utilisation, ou utiliser glProgramUniform, mais c'est gl 4
-    GLuint current;
-    glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *) &current);
-    if(current != program)
+    // verifier que le program est bien en cours d'utilisation, ou utiliser glProgramUniform, mais c'est gl 4.
+    // une seule fois par uniform : glGetIntegerv( ) synchronise le driver, et serait execute a chaque affectation
+    if(first)
     {
-        char error[1024]= { 0 };
-    #ifdef GL_VERSION_4_3
+        GLuint current;
+        glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *) &current);
+        if(current != program)
         {
-            char label[1024];
-            glGetObjectLabel(GL_PROGRAM, program, sizeof(label), NULL, label);
-            char labelc[1024];
-            glGetObjectLabel(GL_PROGRAM, current, sizeof(labelc), NULL, labelc);
+            char error[1024]= { 0 };
+        #ifdef GL_VERSION_4_3
+            {
+                char label[1024];
+                glGetObjectLabel(GL_PROGRAM, program, sizeof(label), NULL, label);
+                char labelc[1024];
+                glGetObjectLabel(GL_PROGRAM, current, sizeof(labelc), NULL, labelc);
             
-            sprintf(error, "uniform( %s %u, '%s' ): invalid shader program %s %u", label, program, uniform, labelc, current); 
-        }
-    #else
-        sprintf(error, "uniform( program %u, '%s'): invalid shader program %u...", program, uniform, current); 
-    #endif
+                sprintf(error, "uniform( %s %u, '%s' ): invalid shader program %s %u", label, program, uniform, labelc, current); 
+            }
+        #else
+            sprintf(error, "uniform( program %u, '%s'): invalid shader program %u...", program, uniform, current); 
+        #endif
         
-        printf("%s\n", error);
-        glUseProgram(program);
+            printf("%s\n", error);
+            glUseProgram(program);
+        }
     }
 #endif
     
@@ -133,3 +138,52 @@ void program_use_texture( const GLuint program, const char *uniform, const int u
     // transmet l'indice de l'unite de texture au shader
     glUniform1i(id, unit);
 }
+
+
+static
+bool compatible_type( const GLenum expected, const GLenum type )
+{
+    if(type == expected)
+        return true;
+
+    // les bool et les samplers s'affectent avec glUniform1i / glUniform1ui
+    if(expected == GL_INT || expected == GL_UNSIGNED_INT)
+    {
+        switch(type)
+        {
+            case GL_BOOL:
+            case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_BUFFER:
+            case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+GLint program_uniform_handle_location( const GLuint program, const char *uniform, const GLenum type )
+{
+    GLint id= location(program, uniform);
+    if(id < 0)
+        return id;
+
+    GLenum declared= program_uniform_type(program, uniform);
+    if(compatible_type(type, declared) == false)
+        printf("uniform( program %u, '%s'): type mismatch, declared 0x%04x, expected 0x%04x.\n", program, uniform, declared, type);
+
+    return id;
+}
+
+void program_use_texture( const UniformHandle<int>& uniform, const int unit, const GLuint texture, const GLuint sampler )
+{
+    if(uniform.valid() == false)
+        return;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindSampler(unit, sampler);
+    glUniform1i(uniform.location, unit);
+}
@@ -45,5 +45,68 @@ void program_uniform( const GLuint program, const char *uniform, const Transform
 //! configure le pipeline et le shader program pour utiliser une texture, et des parametres de filtrages, eventuellement.
 void program_use_texture( const GLuint program, const char *uniform, const int unit, const GLuint texture, const GLuint sampler= 0 );
 
+
+//! identifiant d'un uniform de type T (float, vec3, Transform, etc.), cf program_uniform_handle( ).\n
+//! affecter une valeur avec program_uniform(handle, value) ne fait ni recherche par nom ni requete openGL, le program doit etre
+//! selectionne (cf glUseProgram( )). les identifiants changent avec reload_program( ) : il faut redemander les handles.
+template < typename T >
+struct UniformHandle
+{
+    UniformHandle( ) : location(-1) {}
+    explicit UniformHandle( const GLint id ) : location(id) {}
+
+    //! renvoie vrai si l'uniform existe dans le program.
+    bool valid( ) const { return location >= 0; }
+
+    GLint location;
+};
+
+//! type openGL d'un uniform declare avec le type T. 
+template < typename T > GLenum uniform_type( );
+template < > inline GLenum uniform_type<unsigned int>( ) { return GL_UNSIGNED_INT; }
+template < > inline GLenum uniform_type<int>( ) { return GL_INT; }
+template < > inline GLenum uniform_type<float>( ) { return GL_FLOAT; }
+template < > inline GLenum uniform_type<vec2>( ) { return GL_FLOAT_VEC2; }
+template < > inline GLenum uniform_type<vec3>( ) { return GL_FLOAT_VEC3; }
+template < > inline GLenum uniform_type<Point>( ) { return GL_FLOAT_VEC3; }
+template < > inline GLenum uniform_type<Vector>( ) { return GL_FLOAT_VEC3; }
+template < > inline GLenum uniform_type<vec4>( ) { return GL_FLOAT_VEC4; }
+template < > inline GLenum uniform_type<Color>( ) { return GL_FLOAT_VEC4; }
+template < > inline GLenum uniform_type<Transform>( ) { return GL_FLOAT_MAT4; }
+
+//! renvoie l'identifiant d'un uniform et verifie que son type dans le shader est compatible avec type. utiliser program_uniform_handle( ).
+GLint program_uniform_handle_location( const GLuint program, const char *uniform, const GLenum type );
+
+//! renvoie le handle d'un uniform du shader program, a recuperer une fois, apres read_program( ) ou reload_program( ).
+template < typename T >
+UniformHandle<T> program_uniform_handle( const GLuint program, const char *uniform )
+{
+    return UniformHandle<T>(program_uniform_handle_location(program, uniform, uniform_type<T>()));
+}
+
+//! affecte une valeur a un uniform du shader program selectionne. uint.
+inline void program_uniform( const UniformHandle<unsigned int>& u, const unsigned int v ) { glUniform1ui(u.location, v); }
+//! affecte une valeur a un uniform du shader program selectionne. int.
+inline void program_uniform( const UniformHandle<int>& u, const int v ) { glUniform1i(u.location, v); }
+//! affecte une valeur a un uniform du shader program selectionne. float.
+inline void program_uniform( const UniformHandle<float>& u, const float v ) { glUniform1f(u.location, v); }
+//! affecte une valeur a un uniform du shader program selectionne. vec2.
+inline void program_uniform( const UniformHandle<vec2>& u, const vec2& v ) { glUniform2fv(u.location, 1, &v.x); }
+//! affecte une valeur a un uniform du shader program selectionne. vec3.
+inline void program_uniform( const UniformHandle<vec3>& u, const vec3& v ) { glUniform3fv(u.location, 1, &v.x); }
+//! affecte une valeur a un uniform du shader program selectionne. Point.
+inline void program_uniform( const UniformHandle<Point>& u, const Point& a ) { glUniform3fv(u.location, 1, &a.x); }
+//! affecte une valeur a un uniform du shader program selectionne. Vector.
+inline void program_uniform( const UniformHandle<Vector>& u, const Vector& v ) { glUniform3fv(u.location, 1, &v.x); }
+//! affecte une valeur a un uniform du shader program selectionne. vec4.
+inline void program_uniform( const UniformHandle<vec4>& u, const vec4& v ) { glUniform4fv(u.location, 1, &v.x); }
+//! affecte une valeur a un uniform du shader program selectionne. Color.
+inline void program_uniform( const UniformHandle<Color>& u, const Color& c ) { glUniform4fv(u.location, 1, &c.r); }
+//! affecte une valeur a un uniform du shader program selectionne. Transform.
+inline void program_uniform( const UniformHandle<Transform>& u, const Transform& v ) { glUniformMatrix4fv(u.location, 1, GL_TRUE, v.buffer()); }
+
+//! configure le pipeline et le shader program selectionne pour utiliser une texture, cf program_use_texture( ).
+void program_use_texture( const UniformHandle<int>& uniform, const int unit, const GLuint texture, const GLuint sampler= 0 );
+
 ///@}
 #endif
@@ -33,85 +33,488 @@ principales fonctions de calculs.
 #include <math.h>
 #include <vector>
 #include <iostream>
+#include <algorithm>
 #include <omp.h>
 
 #include "vec.h"
 #include "ObjetSimule.h"
 #include "ObjetSimuleSPH.h"
-#include "Viewer.h"
+#include "NoyauxSIMD.h"
 
 using namespace std;
 
+/**
+ * Tableaux de travail des noyaux de calcul par paires : un par thread, conserves d une passe a
+ * l autre (agrandis seulement si le nombre de threads augmente).
+ */
+void ObjetSimuleSPH::PreparationTampons()
+{
+    if ((int)_Tampons.size() < omp_get_max_threads())
+        _Tampons.resize(omp_get_max_threads());
+}
+
+/**
+ * Reinitialisation des etats accumules au cours d un pas de temps :
+ * densite reduite a la contribution de la particule elle-meme, forces nulles.
+ */
+void ObjetSimuleSPH::Reinitialisation()
+{
+    const float *M = _Particules.M.data();
+    float *rho = _Particules.rho.data();
+    float *fx = _Particules.Force.x.data(), *fy = _Particules.Force.y.data(), *fz = _Particules.Force.z.data();
+    float c = (_Noyaux->constantes != NULL) ? _ConstantesNoyau.w0 : 4 / M_PI / (h * h);
+
+#pragma omp parallel for simd
+    for (int i = 0; i < _Nb_Sommets; ++i)
+    {
+        rho[i] = c * M[i];
+        fx[i] = 0;
+        fy[i] = 0;
+        fz[i] = 0;
+    }
+}
+
 /**
  * Calcul des densites des particules.
  * Formule :
- *  \rho_i = \frac{4m}{\pi h^8} \sum_{j \in N_i} (h^2 - r^2)^3.
+ *  \rho_i = \frac{4m}{\pi h^8} \sum_{j \in N_i} (h^2 - r^2)^3,
+ * ou \rho_i = m \sum_{j \in N_i} W(r) avec le noyau de densite d un jeu de noyaux de lissage.
+ * Seules les paires de particules des cellules voisines de la grille sont considerees ;
+ * les contributions d une particule et de ses candidats sont calculees par le noyau SIMD.
+ * Les candidats sont ceux de la grille, ou ceux des listes de Verlet dans ce mode.
+ * Les voisins retenus (r < h) sont enregistres dans _Voisins pour la passe des forces.
  */
 void ObjetSimuleSPH::CalculDensite()
 {
     float h2 = h * h;
     float h8 = h * h * h * h * h * h * h * h;
-    float c = 4 * M[0] / M_PI / h8;
-#pragma omp parallel for
+    float *rho = _Particules.rho.data();
+
+    DonneesDensite d;
+    d.px = _Particules.P.x.data();
+    d.py = _Particules.P.y.data();
+    d.pz = _Particules.P.z.data();
+    d.h2 = h2;
+    d.c = (_Noyaux->constantes != NULL) ? _Particules.M[0] : 4 * _Particules.M[0] / M_PI / h8;
+    d.noyau = _ConstantesNoyau;
+
+    PreparationTampons();
+    const FonctionNoyauDensite noyau = _Noyaux->densite;
+    _Voisins.Initialise(_Nb_Sommets);
+
+    // Contributions de la particule i et de ses candidats voisins
+    auto densite_particule = [&](int i, const int *voisins, int n) {
+        TamponPaires &t = _Tampons[omp_get_thread_num()];
+        t.Reserve(n);
+        int m = noyau(i, voisins, n, d, t.voisins_h.data(), t.w.data());
+
+        float rho_i = 0;
+        for (int k = 0; k < m; ++k)
+        {
+            rho_i += t.w[k];
+            rho[t.voisins_h[k]] += t.w[k];
+        }
+        rho[i] += rho_i;
+
+        _Voisins.Ajoute(i, t.voisins_h.data(), m);
+    };
+
+    // Parcours parallele par couleurs de cellules : pas d ecriture concurrente sur rho[j]
+    // (en mode Verlet, les couleurs sont celles de la grille qui a servi a construire les listes)
+    if (_Verlet)
+        _Grille.ParcoursParticulesParallele([&](int i) {
+            densite_particule(i, _ListesVerlet.Voisins(i), _ListesVerlet.Nb(i));
+        });
+    else
+        _Grille.ParcoursCandidatsParallele(densite_particule);
+} //void
+
+/**
+ * Construction des listes de Verlet : paires de particules a distance < h + skin,
+ * parmi les candidats de la grille (cellules de taille h + skin).
+ * Le filtrage et la compaction des candidats sont faits par le noyau SIMD de densite
+ * avec le rayon h + skin (les poids calcules ne sont pas utilises).
+ */
+void ObjetSimuleSPH::ConstructionListesVerlet()
+{
+    float r = h + _Skin;
+
+    DonneesDensite d;
+    d.px = _Particules.P.x.data();
+    d.py = _Particules.P.y.data();
+    d.pz = _Particules.P.z.data();
+    d.h2 = r * r;
+    d.c = 0;
+    d.noyau = _ConstantesNoyau;
+
+    PreparationTampons();
+    const FonctionNoyauDensite noyau = _Noyaux->densite;
+    _ListesVerlet.Initialise(_Nb_Sommets);
+
+    _Grille.ParcoursCandidatsParallele([&](int i, const int *voisins, int n) {
+        TamponPaires &t = _Tampons[omp_get_thread_num()];
+        t.Reserve(n);
+        int m = noyau(i, voisins, n, d, t.voisins_h.data(), t.w.data());
+        _ListesVerlet.Ajoute(i, t.voisins_h.data(), m);
+    });
+
+    /* Positions de reference pour le critere de reconstruction */
+    _PositionsVerlet = _Particules.P;
+    _VerletValide = true;
+    ++_NbReconstructions;
+}
+
+/**
+ * Calcul des pressions par l equation d etat :
+ *  p_i = bulk (\rho_i - \rho_0).
+ * Avec un solveur incompressible, les pressions sont nulles : les forces calculees ensuite
+ * ne contiennent que la viscosite, les pressions sont obtenues par la correction.
+ */
+void ObjetSimuleSPH::CalculPression()
+{
+    const float *rho = _Particules.rho.data();
+    _Pression.resize(_Nb_Sommets);
+    float *press = _Pression.data();
+
+    if (_ModePression != PRESSION_EQUATION_ETAT)
+    {
+        std::fill(_Pression.begin(), _Pression.end(), 0.f);
+        return;
+    }
+
+#pragma omp parallel for simd
     for (int i = 0; i < _Nb_Sommets; ++i)
+        press[i] = bulk * (rho[i] - rho0);
+}
+
+/**
+ * Calcul des forces d interaction entre particules, sur les listes de voisins
+ * construites par CalculDensite (pas de nouvelle recherche dans la grille).
+ * Attention - Calcul direct de fij / rho_i : le facteur 1 / (rho_i rho_j) est inclus
+ * dans le terme de chaque paire, Force[i] est directement une acceleration.
+ * Avec un jeu de noyaux de lissage, terme de paire
+ *  m / (rho_i rho_j) (-1/2 (p_i + p_j) grad W(r) - visco laplacien W_visc(r) (v_i - v_j)).
+ */
+void ObjetSimuleSPH::CalculInteraction(float visco)
+{
+    float h2 = h * h;
+
+    DonneesForce d;
+    d.px = _Particules.P.x.data();
+    d.py = _Particules.P.y.data();
+    d.pz = _Particules.P.z.data();
+    d.vx = _Particules.V.x.data();
+    d.vy = _Particules.V.y.data();
+    d.vz = _Particules.V.z.data();
+    d.rho = _Particules.rho.data();
+    d.press = _Pression.data();
+    d.h = h;
+    d.h2 = h2;
+    d.noyau = _ConstantesNoyau;
+    if (_Noyaux->constantes != NULL)
     {
-        rho[i] += 4 * M[i] / M_PI / (h * h);
-        for (int j = i + 1; j < _Nb_Sommets; ++j)
+        d.c = _Particules.M[0];
+        d.c_press = -0.5f;
+        d.c_mu = -visco;
+    }
+    else
+    {
+        d.c = _Particules.M[0] / M_PI / (h2 * h2);
+        d.c_press = 15;
+        d.c_mu = -40 * visco;
+    }
+
+    SommeForcesPaires(d, _Particules.Force);
+} //void
+
+/**
+ * Somme des termes des paires (noyau des forces) sur les listes de voisins du pas :
+ * le terme de chaque paire est ajoute a forces[i] et retranche de forces[j].
+ */
+void ObjetSimuleSPH::SommeForcesPaires(const DonneesForce &d, ChampVectoriel &forces)
+{
+    float *fx = forces.x.data(), *fy = forces.y.data(), *fz = forces.z.data();
+
+    PreparationTampons();
+    const FonctionNoyauForce noyau = _Noyaux->force;
+
+    // Parcours parallele par couleurs de cellules : pas d ecriture concurrente sur forces[j]
+    _Grille.ParcoursParticulesParallele([&](int i) {
+        int n = _Voisins.Nb(i);
+        TamponPaires &t = _Tampons[omp_get_thread_num()];
+        t.Reserve(n);
+        int m = noyau(i, _Voisins.Voisins(i), n, d, t.voisins_h.data(), t.tx.data(), t.ty.data(), t.tz.data());
+
+        float fxi = 0, fyi = 0, fzi = 0;
+        for (int k = 0; k < m; ++k)
         {
-            float dx = P[i].x - P[j].x;
-            float dy = P[i].y - P[j].y;
-            float dz = P[i].z - P[j].z;
-            float r2 = dx * dx + dy * dy + dz * dz;
-            float z = h2 - r2;
-            if (z > 0)
-            {
-                float rho_ij = c * z * z * z;
-                rho[i] += rho_ij;
-                rho[j] += rho_ij;
-            }
+            int j = t.voisins_h[k];
+            fxi += t.tx[k];
+            fyi += t.ty[k];
+            fzi += t.tz[k];
+            fx[j] -= t.tx[k];
+            fy[j] -= t.ty[k];
+            fz[j] -= t.tz[k];
         }
-    }
+        fx[i] += fxi;
+        fy[i] += fyi;
+        fz[i] += fzi;
+    });
 } //void
 
 /**
- * Calcul des forces d interaction entre particules.
-  * Attention - Calcul direct de fij / rho_i
+ * Densites aux positions predites _PositionsPredites, dans _DensitesPredites.
+ * Les paires sont celles des listes de voisins du pas (r < h aux positions courantes) ;
+ * le noyau de densite ne garde que celles qui restent a distance < h apres le deplacement.
  */
-void ObjetSimuleSPH::CalculInteraction(float visco)
+void ObjetSimuleSPH::CalculDensitePredite()
 {
     float h2 = h * h;
-    float c = M[0] / M_PI / (h2 * h2);
-    float c_bulk = 15 * bulk;
-    float c_mu = -40 * visco;
+    float h8 = h * h * h * h * h * h * h * h;
+    _DensitesPredites.resize(_Nb_Sommets);
+    const float *M = _Particules.M.data();
+    float *rho = _DensitesPredites.data();
+    float c0 = (_Noyaux->constantes != NULL) ? _ConstantesNoyau.w0 : 4 / M_PI / h2;
 
-#pragma omp parallel for
+#pragma omp parallel for simd
     for (int i = 0; i < _Nb_Sommets; ++i)
+        rho[i] = c0 * M[i];
+
+    DonneesDensite d;
+    d.px = _PositionsPredites.x.data();
+    d.py = _PositionsPredites.y.data();
+    d.pz = _PositionsPredites.z.data();
+    d.h2 = h2;
+    d.c = (_Noyaux->constantes != NULL) ? _Particules.M[0] : 4 * _Particules.M[0] / M_PI / h8;
+    d.noyau = _ConstantesNoyau;
+
+    PreparationTampons();
+    const FonctionNoyauDensite noyau = _Noyaux->densite;
+
+    _Grille.ParcoursParticulesParallele([&](int i) {
+        int n = _Voisins.Nb(i);
+        TamponPaires &t = _Tampons[omp_get_thread_num()];
+        t.Reserve(n);
+        int m = noyau(i, _Voisins.Voisins(i), n, d, t.voisins_h.data(), t.w.data());
+
+        float rho_i = 0;
+        for (int k = 0; k < m; ++k)
+        {
+            rho_i += t.w[k];
+            rho[t.voisins_h[k]] += t.w[k];
+        }
+        rho[i] += rho_i;
+    });
+}
+
+/**
+ * Donnees communes des noyaux des forces et des gradients, aux positions et vitesses courantes :
+ * constante c = m / (\pi h^4) des noyaux d origine, ou la masse m avec un jeu de noyaux de lissage.
+ */
+void ObjetSimuleSPH::DonneesPaires(DonneesForce &d) const
+{
+    d.px = _Particules.P.x.data();
+    d.py = _Particules.P.y.data();
+    d.pz = _Particules.P.z.data();
+    d.vx = _Particules.V.x.data();
+    d.vy = _Particules.V.y.data();
+    d.vz = _Particules.V.z.data();
+    d.h = h;
+    d.h2 = h * h;
+    d.c = (_Noyaux->constantes != NULL) ? _Particules.M[0] : _Particules.M[0] / M_PI / (d.h2 * d.h2);
+    d.noyau = _ConstantesNoyau;
+}
+
+/**
+ * Accelerations dues aux seules pressions press (viscosite nulle), aux positions courantes, dans accel :
+ * terme de pression de la paire du noyau des forces multiplie par facteur,
+ *  -facteur / 2 m (press_i + press_j) / (rho_i rho_j) grad W_ij.
+ * PCISPH : pressions et densites des particules, facteur = 1 (terme de CalculInteraction) ;
+ * DFSPH : press = kappa / rho, densites unitaires, facteur = 2 (-m (press_i + press_j) grad W_ij).
+ * IISPH : press = p / rho^2, densites unitaires, facteur = 2.
+ */
+void ObjetSimuleSPH::CalculAccelPression(const float *press, const float *rho, float facteur, ChampVectoriel &accel)
+{
+    accel.resize(_Nb_Sommets);
+    std::fill(accel.x.begin(), accel.x.end(), 0.f);
+    std::fill(accel.y.begin(), accel.y.end(), 0.f);
+    std::fill(accel.z.begin(), accel.z.end(), 0.f);
+
+    DonneesForce d;
+    DonneesPaires(d);
+    d.rho = rho;
+    d.press = press;
+    d.c_press = ((_Noyaux->constantes != NULL) ? -0.5f : 15.f) * facteur;
+    d.c_mu = 0;
+
+    SommeForcesPaires(d, accel);
+}
+
+/**
+ * Sommes sur les listes de voisins du pas, aux positions courantes, des gradients du noyau de densite,
+ * m grad W_ij = -gd_ij r_ij, et du noyau du gradient des pressions, m grad W'_ij = -gp_ij r_ij
+ * (noyau des gradients) :
+ *  densite_i = \sum_j m grad W_ij, pression_i = \sum_j m grad W'_ij,
+ *  produits_i = \sum_j m grad W_ij . m grad W'_ij.
+ */
+void ObjetSimuleSPH::SommesGradients(ChampVectoriel &densite, ChampVectoriel &pression, float *produits)
+{
+    const int n = _Nb_Sommets;
+    const float *px = _Particules.P.x.data(), *py = _Particules.P.y.data(), *pz = _Particules.P.z.data();
+
+    densite.resize(n);
+    pression.resize(n);
+    for (ChampVectoriel *s : {&densite, &pression})
     {
-        for (int j = i + 1; j < _Nb_Sommets; ++j)
+        std::fill(s->x.begin(), s->x.end(), 0.f);
+        std::fill(s->y.begin(), s->y.end(), 0.f);
+        std::fill(s->z.begin(), s->z.end(), 0.f);
+    }
+    std::fill(produits, produits + n, 0.f);
+    float *dsx = densite.x.data(), *dsy = densite.y.data(), *dsz = densite.z.data();
+    float *psx = pression.x.data(), *psy = pression.y.data(), *psz = pression.z.data();
+
+    DonneesForce d;
+    DonneesPaires(d);
+    PreparationTampons();
+    const FonctionNoyauGradients noyau = _Noyaux->gradients;
+
+    // Parcours parallele par couleurs de cellules : pas d ecriture concurrente sur les sommes de j
+    _Grille.ParcoursParticulesParallele([&](int i) {
+        int nv = _Voisins.Nb(i);
+        TamponPaires &t = _Tampons[omp_get_thread_num()];
+        t.Reserve(nv);
+        int m = noyau(i, _Voisins.Voisins(i), nv, d, t.voisins_h.data(), t.w.data(), t.tx.data());
+        float dxi = 0, dyi = 0, dzi = 0, pxi = 0, pyi = 0, pzi = 0, prod_i = 0;
+
+        for (int k = 0; k < m; ++k)
         {
-            float dx = P[i].x - P[j].x;
-            float dy = P[i].y - P[j].y;
-            float dz = P[i].z - P[j].z;
-            float r2 = dx * dx + dy * dy + dz * dz;
-            if (r2 < h2)
-            {
-                float q = sqrt(r2) / h;
-                float tmp0 = c * (1 - q) / rho[i] / rho[j];
-                float press = tmp0 * c_bulk * (rho[i] + rho[j] - 2 * rho0) * (1 - q) / q;
-                float visc = tmp0 * c_mu;
-                float vdx = V[i].x - V[j].x;
-                float vdy = V[i].y - V[j].y;
-                float vdz = V[i].z - V[j].z;
-                Force[i].x = (Force[i].x + (press * dx + visc * vdx)) / rho[i];
-                Force[i].y = (Force[i].y + (press * dy + visc * vdy)) / rho[i];
-                Force[i].z = (Force[i].z + (press * dz + visc * vdz)) / rho[i];
-                Force[j].x = (Force[j].x - (press * dx + visc * vdx)) / rho[j];
-                Force[j].y = (Force[j].y - (press * dy + visc * vdy)) / rho[j];
-                Force[j].z = (Force[j].z - (press * dz + visc * vdz)) / rho[j];
-            }
+            int j = t.voisins_h[k];
+            float dx = px[i] - px[j], dy = py[i] - py[j], dz = pz[i] - pz[j];
+            float gd = t.w[k], gp = t.tx[k];
+            float prod = gd * gp * (dx * dx + dy * dy + dz * dz);
+            dxi -= gd * dx;
+            dyi -= gd * dy;
+            dzi -= gd * dz;
+            pxi -= gp * dx;
+            pyi -= gp * dy;
+            pzi -= gp * dz;
+            dsx[j] += gd * dx;
+            dsy[j] += gd * dy;
+            dsz[j] += gd * dz;
+            psx[j] += gp * dx;
+            psy[j] += gp * dy;
+            psz[j] += gp * dz;
+            prod_i += prod;
+            produits[j] += prod;
         }
-    } //void
+        dsx[i] += dxi;
+        dsy[i] += dyi;
+        dsz[i] += dzi;
+        psx[i] += pxi;
+        psy[i] += pyi;
+        psz[i] += pzi;
+        produits[i] += prod_i;
+    });
 }
+
+/**
+ * Facteurs de DFSPH, sur les listes de voisins du pas : avec des increments de vitesses
+ * -dt \sum_j m (kappa_i / \rho_i + kappa_j / \rho_j) grad W'_ij (gradient des pressions) et la variation
+ * de densite \sum_j m (v_i - v_j) . grad W_ij (noyau de densite, cf CalculDivergence),
+ *  alpha_i = \rho_i / (\sum_j m grad W_ij . \sum_j m grad W'_ij + \sum_j m grad W_ij . m grad W'_ij).
+ * Facteur nul pour une particule sans voisin.
+ */
+void ObjetSimuleSPH::CalculFacteursDFSPH()
+{
+    const int n = _Nb_Sommets;
+    const float *rho = _Particules.rho.data();
+
+    // Sommes des gradients dans _VitessesPredites et _AccelPression (libres a ce stade), produits dans alpha
+    _Alpha.resize(n);
+    SommesGradients(_VitessesPredites, _AccelPression, _Alpha.data());
+    const float *dx = _VitessesPredites.x.data(), *dy = _VitessesPredites.y.data(), *dz = _VitessesPredites.z.data();
+    const float *px = _AccelPression.x.data(), *py = _AccelPression.y.data(), *pz = _AccelPression.z.data();
+    float *alpha = _Alpha.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < n; ++i)
+    {
+        float denominateur = dx[i] * px[i] + dy[i] * py[i] + dz[i] * pz[i] + alpha[i];
+        alpha[i] = (denominateur > 0) ? rho[i] / denominateur : 0.f;
+    }
+}
+
+/**
+ * Coefficients d IISPH, sur les listes de voisins du pas, pour un schema d integration deplacant
+ * une particule de coef a sous une acceleration a. Avec les accelerations de pression
+ *  a_i = -\sum_j m (p_i / \rho_i^2 + p_j / \rho_j^2) grad W'_ij (gradient des pressions),
+ * la pression p_i deplace i de d_ii p_i, d_ii = -coef / \rho_i^2 \sum_j m grad W'_ij, et chaque voisin j
+ * de coef p_i / \rho_i^2 m grad W'_ij ; la densite de i (noyau de densite W) varie alors de a_ii p_i, avec
+ *  a_ii = \sum_j m grad W_ij . d_ii - coef / \rho_i^2 \sum_j m grad W_ij . m grad W'_ij (negatif).
+ */
+void ObjetSimuleSPH::CalculCoefficientsIISPH(float coef)
+{
+    const int n = _Nb_Sommets;
+    const float *rho = _Particules.rho.data();
+
+    // Sommes des gradients du noyau de densite dans _AccelPression (libre a ce stade)
+    _Aii.resize(n);
+    SommesGradients(_AccelPression, _Dii, _Aii.data());
+    const float *gx = _AccelPression.x.data(), *gy = _AccelPression.y.data(), *gz = _AccelPression.z.data();
+    float *dx = _Dii.x.data(), *dy = _Dii.y.data(), *dz = _Dii.z.data();
+    float *aii = _Aii.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < n; ++i)
+    {
+        float f = -coef / (rho[i] * rho[i]);
+        dx[i] *= f;
+        dy[i] *= f;
+        dz[i] *= f;
+        aii[i] = gx[i] * dx[i] + gy[i] * dy[i] + gz[i] * dz[i] + f * aii[i];
+    }
+}
+
+/**
+ * Derivees particulaires des densites pour les vitesses v, sur les listes de voisins du pas, avec le
+ * gradient du noyau de densite (variation au premier ordre des densites de CalculDensite) :
+ *  div_i = \sum_j m (v_i - v_j) . grad W_ij = -\sum_j gd_ij (v_i - v_j) . r_ij,
+ * le terme d une paire etant le meme pour i et pour j.
+ */
+void ObjetSimuleSPH::CalculDivergence(const ChampVectoriel &v, float *div)
+{
+    const int n = _Nb_Sommets;
+    const float *px = _Particules.P.x.data(), *py = _Particules.P.y.data(), *pz = _Particules.P.z.data();
+    const float *vx = v.x.data(), *vy = v.y.data(), *vz = v.z.data();
+
+    std::fill(div, div + n, 0.f);
+
+    DonneesForce d;
+    DonneesPaires(d);
+    PreparationTampons();
+    const FonctionNoyauGradients noyau = _Noyaux->gradients;
+
+    // Parcours parallele par couleurs de cellules : pas d ecriture concurrente sur div[j]
+    _Grille.ParcoursParticulesParallele([&](int i) {
+        int nv = _Voisins.Nb(i);
+        TamponPaires &t = _Tampons[omp_get_thread_num()];
+        t.Reserve(nv);
+        int m = noyau(i, _Voisins.Voisins(i), nv, d, t.voisins_h.data(), t.w.data(), t.tx.data());
+        float div_i = 0;
+
+        for (int k = 0; k < m; ++k)
+        {
+            int j = t.voisins_h[k];
+            float dx = px[i] - px[j], dy = py[i] - py[j], dz = pz[i] - pz[j];
+            float t_ij = -t.w[k] * (dx * (vx[i] - vx[j]) + dy * (vy[i] - vy[j]) + dz * (vz[i] - vz[j]));
+            div_i += t_ij;
+            div[j] += t_ij;
+        }
+        div[i] += div_i;
+    });
+}
+
 /**
  * Gestion des collisions.
  * Notre condition aux limites correspond à une frontière inélastique
@@ -126,67 +529,176 @@ void ObjetSimuleSPH::CalculInteraction(float visco)
 void ObjetSimuleSPH::damp_reflect(int frontiere, float barrier, int indice_part)
 {
     /// frontiere : indique quelle frontiere (x, y, z) du domaine est concernee
+    Vector P = _Particules.P[indice_part];
+    Vector V = _Particules.V[indice_part];
+    Vector Vprec = _Particules.Vprec[indice_part];
+
+    // meme rebond que celui fait pendant l integration (cf SolveurExpl.h)
+    if (frontiere == 0)
+        RebondMur(barrier, P.x, P.y, P.z, V.x, V.y, V.z, Vprec.x, Vprec.y, Vprec.z);
+    else if (frontiere == 1)
+        RebondMur(barrier, P.y, P.x, P.z, V.y, V.x, V.z, Vprec.y, Vprec.x, Vprec.z);
+    else if (frontiere == 2)
+        RebondMur(barrier, P.z, P.x, P.y, V.z, V.x, V.y, Vprec.z, Vprec.x, Vprec.y);
+
+    _Particules.P.set(indice_part, P);
+    _Particules.V.set(indice_part, V);
+    _Particules.Vprec.set(indice_part, Vprec);
+}
+
+/**
+ * Collision avec une frontiere de forme quelconque, de normale unitaire normale (vers le fluide)
+ * au point de la particule, qui a penetre de -distance dans la frontiere.
+ * Generalisation de damp_reflect aux murs non alignes sur les axes : meme retour en arriere
+ * selon le temps ecoule depuis la collision, symetrie par rapport au plan tangent et amortissement.
+ * Une particule qui s eloigne deja de la frontiere est seulement ramenee a sa surface.
+ */
+void ObjetSimuleSPH::damp_reflect(const Vector &normale, float distance, int indice_part)
+{
     float coef = 0.75;
-    if (frontiere == 0 && V[indice_part].x != 0)
+    Vector P = _Particules.P[indice_part];
+    Vector V = _Particules.V[indice_part];
+    Vector Vprec = _Particules.Vprec[indice_part];
+
+    float vn = dot(V, normale);
+    if (vn < 0)
     {
-        float tbounce = (P[indice_part].x - barrier) / V[indice_part].x;
-        P[indice_part] = P[indice_part] - V[indice_part] * (1 - coef) * tbounce;
-        P[indice_part].x = 2 * barrier - P[indice_part].x;
-        V[indice_part].x = -V[indice_part].x;
-        Vprec[indice_part].x = -Vprec[indice_part].x;
-        V[indice_part] = V[indice_part] * coef;
-        Vprec[indice_part] = Vprec[indice_part] * coef;
+        float tbounce = distance / vn;
+        P = P - V * (1 - coef) * tbounce;
+        // penetration apres le retour en arriere : coef * distance
+        P = P - normale * (2 * coef * distance);
+        V = V - normale * (2 * vn);
+        Vprec = Vprec - normale * (2 * dot(Vprec, normale));
+        V = V * coef;
+        Vprec = Vprec * coef;
     }
-    else if (frontiere == 1 && V[indice_part].y != 0)
+    else
+        P = P - normale * distance;
+
+    _Particules.P.set(indice_part, P);
+    _Particules.V.set(indice_part, V);
+    _Particules.Vprec.set(indice_part, Vprec);
+}
+
+/// Murs du domaine (min et max selon x, y et z)
+static const MursDomaine barriers =
+    {
+        {-1.f, 1.f},
+        {0.f, 2.f},
+        {-1.f, 1.f},
+    };
+
+/**
+ * Murs traites pendant l integration (cf SolveurExpl::Solve), dans la meme passe que les
+ * vitesses et positions : c est le cas sans maillage de collision, dont les requetes ont
+ * besoin des vitesses d avant les rebonds. NULL si les murs sont traites par Collision(),
+ * ou si la frontiere est un conteneur (pas de murs).
+ */
+const MursDomaine *ObjetSimuleSPH::MursIntegration() const
+{
+    if (!AvecMurs() || !_MaillageCollision.EstVide())
+        return NULL;
+    return &barriers;
+}
+
+/**
+ * Bornes du domaine : les murs des collisions.
+ */
+void ObjetSimuleSPH::Domaine(Vector &pmin, Vector &pmax) const
+{
+    // un conteneur remplace les murs
+    if (!AvecMurs())
     {
-        float tbounce = (P[indice_part].y - barrier) / V[indice_part].y;
-        P[indice_part] = P[indice_part] - V[indice_part] * (1 - coef) * tbounce;
-        P[indice_part].y = 2 * barrier - P[indice_part].y;
-        V[indice_part].y = -V[indice_part].y;
-        Vprec[indice_part].y = -Vprec[indice_part].y;
-        V[indice_part] = V[indice_part] * coef;
-        Vprec[indice_part] = Vprec[indice_part] * coef;
+        pmin = _Frontiere.Min();
+        pmax = _Frontiere.Max();
+        return;
     }
-    else if (frontiere == 2 && V[indice_part].z != 0)
+
+    pmin = Vector(barriers[0][0], barriers[1][0], barriers[2][0]);
+    pmax = Vector(barriers[0][1], barriers[1][1], barriers[2][1]);
+}
+
+/**
+ * Collisions avec le maillage de collision.
+ * Le trajet de chaque particule pendant le pas va de P - dt Vprec (cf SolveurExpl::Solve) a P :
+ * une particule qui traverse un triangle ou s en approche a moins de l epaisseur est renvoyee
+ * par damp_reflect. Les requetes (BVH) et les reponses sont calculees en parallele.
+ */
+void ObjetSimuleSPH::CollisionMaillage()
+{
+    const float dt = _SolveurExpl->_delta_t;
+    const float *px = _Particules.P.x.data(), *py = _Particules.P.y.data(), *pz = _Particules.P.z.data();
+    const float *wx = _Particules.Vprec.x.data(), *wy = _Particules.Vprec.y.data(), *wz = _Particules.Vprec.z.data();
+
+    _DebutPas.resize(_Nb_Sommets);
+    _Contacts.resize(_Nb_Sommets);
+    float *dx = _DebutPas.x.data(), *dy = _DebutPas.y.data(), *dz = _DebutPas.z.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < _Nb_Sommets; ++i)
     {
-        float tbounce = (P[indice_part].z - barrier) / V[indice_part].z;
-        P[indice_part] = P[indice_part] - V[indice_part] * (1 - coef) * tbounce;
-        P[indice_part].z = 2 * barrier - P[indice_part].z;
-        V[indice_part].z = -V[indice_part].z;
-        Vprec[indice_part].z = -Vprec[indice_part].z;
-        V[indice_part] = V[indice_part] * coef;
-        Vprec[indice_part] = Vprec[indice_part] * coef;
+        dx[i] = px[i] - dt * wx[i];
+        dy[i] = py[i] - dt * wy[i];
+        dz[i] = pz[i] - dt * wz[i];
     }
+
+    _MaillageCollision.Contacts(_Nb_Sommets, dx, dy, dz, px, py, pz, _EpaisseurCollision, _Contacts.data());
+
+#pragma omp parallel for
+    for (int i = 0; i < _Nb_Sommets; ++i)
+        if (_Contacts[i].triangle >= 0 && _Contacts[i].distance < 0)
+            damp_reflect(_Contacts[i].normale, _Contacts[i].distance, i);
 }
 
 /**
  * Gestion des collisions.
- * Pour chacune des particules nous verifions la reflection
- * avec chacun des 4 murs du domaine.
+ * Le maillage de collision est traite en premier (le trajet des particules pendant le pas
+ * est reconstruit a partir des vitesses, avant leur modification par les rebonds).
+ * Pour chacune des particules nous verifions ensuite la reflection
+ * avec chacun des murs du domaine (sauf si la frontiere est un conteneur, ou si les murs
+ * ont deja ete traites pendant l integration, cf MursIntegration),
+ * puis avec la frontiere de forme quelconque : une interpolation dans son champ de distance.
  */
 void ObjetSimuleSPH::Collision()
 {
+    if (!_MaillageCollision.EstVide())
+        CollisionMaillage();
 
-    float barriers[3][2] =
+    const float *px = _Particules.P.x.data();
+    const float *py = _Particules.P.y.data();
+    const float *pz = _Particules.P.z.data();
+
+    // damp_reflect(..., i) ne modifie que la particule i : boucles paralleles sur les particules
+    if (AvecMurs() && MursIntegration() == NULL)
+    {
+#pragma omp parallel for
+        for (int i = 0; i < _Nb_Sommets; ++i)
         {
-            {-1.f, 1.f},
-            {0.f, 2.f},
-            {-1.f, 1.f},
-        };
+            if (px[i] < barriers[0][0])
+                damp_reflect(0, barriers[0][0], i);
+            if (px[i] > barriers[0][1])
+                damp_reflect(0, barriers[0][1], i);
+            if (py[i] < barriers[1][0])
+                damp_reflect(1, barriers[1][0], i);
+            if (py[i] > barriers[1][1])
+                damp_reflect(1, barriers[1][1], i);
+            if (pz[i] < barriers[2][0])
+                damp_reflect(2, barriers[2][0], i);
+            if (pz[i] > barriers[2][1])
+                damp_reflect(2, barriers[2][1], i);
+        }
+    }
 
+    if (_Frontiere.EstVide())
+        return;
+
+#pragma omp parallel for
     for (int i = 0; i < _Nb_Sommets; ++i)
     {
-        if (P[i].x < barriers[0][0])
-            damp_reflect(0, barriers[0][0], i);
-        if (P[i].x > barriers[0][1])
-            damp_reflect(0, barriers[0][1], i);
-        if (P[i].y < barriers[1][0])
-            damp_reflect(1, barriers[1][0], i);
-        if (P[i].y > barriers[1][1])
-            damp_reflect(1, barriers[1][1], i);
-        if (P[i].z < barriers[2][0])
-            damp_reflect(2, barriers[2][0], i);
-        if (P[i].z > barriers[2][1])
-            damp_reflect(2, barriers[2][1], i);
+        Vector gradient;
+        float d = _Frontiere.Distance(Vector(px[i], py[i], pz[i]), gradient);
+        float norme = length(gradient);
+        if (d < 0 && norme > 0)
+            damp_reflect(gradient / norme, d, i);
     }
 }
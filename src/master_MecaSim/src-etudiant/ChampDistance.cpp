@@ -0,0 +1,408 @@
+/** \file ChampDistance.cpp
+ \brief Construction et interpolation du champ de distance signee des frontieres.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "ChampDistance.h"
+#include "MaillageCollision.h"
+
+#ifndef MECASIM_HEADLESS
+#include "wavefront.h"
+#endif
+
+
+/**
+ * Signe de l orientation de l origine par rapport au segment (x1, y1) (x2, y2), et aire signee.
+ * Les cas degeneres (aire nulle) sont departages de facon coherente : un point situe sur une
+ * arete commune a deux triangles n est compte que dans l un des deux.
+ */
+static int Orientation(double x1, double y1, double x2, double y2, double &aire)
+{
+    aire = y1 * x2 - x1 * y2;
+    if (aire > 0) return 1;
+    if (aire < 0) return -1;
+    if (y2 > y1) return 1;
+    if (y2 < y1) return -1;
+    if (x1 > x2) return 1;
+    if (x1 < x2) return -1;
+    return 0;
+}
+
+
+/**
+ * Test d appartenance du point (x0, y0) au triangle 2D (x1, y1) (x2, y2) (x3, y3),
+ * et coordonnees barycentriques (a, b, c) du point.
+ */
+static bool PointDansTriangle(double x0, double y0, double x1, double y1, double x2, double y2,
+                              double x3, double y3, double &a, double &b, double &c)
+{
+    x1 -= x0; x2 -= x0; x3 -= x0;
+    y1 -= y0; y2 -= y0; y3 -= y0;
+
+    int signe_a = Orientation(x2, y2, x3, y3, a);
+    if (signe_a == 0)
+        return false;
+    int signe_b = Orientation(x3, y3, x1, y1, b);
+    if (signe_b != signe_a)
+        return false;
+    int signe_c = Orientation(x1, y1, x2, y2, c);
+    if (signe_c != signe_a)
+        return false;
+
+    double somme = a + b + c;
+    if (somme == 0)
+        return false;
+    a /= somme;
+    b /= somme;
+    c /= somme;
+    return true;
+}
+
+
+#ifdef MECASIM_HEADLESS
+/**
+ * Lecture d un fichier .obj sans gKit (version sans affichage) : sommets (v) et faces (f),
+ * les polygones sont decoupes en eventail de triangles.
+ */
+static bool LectureObj(const std::string &fichier, std::vector<Vector> &sommets, std::vector<int> &triangles)
+{
+    std::ifstream in(fichier.c_str());
+    if (!in)
+        return false;
+
+    std::string ligne;
+    while (std::getline(in, ligne))
+    {
+        std::istringstream mots(ligne);
+        std::string cle;
+        mots >> cle;
+
+        if (cle == "v")
+        {
+            Vector s;
+            mots >> s.x >> s.y >> s.z;
+            sommets.push_back(s);
+        }
+        else if (cle == "f")
+        {
+            // indices a partir de 1, ou negatifs (relatifs au dernier sommet) ; v/vt/vn
+            std::vector<int> face;
+            std::string mot;
+            while (mots >> mot)
+            {
+                int indice = atoi(mot.c_str());
+                face.push_back(indice < 0 ? (int)sommets.size() + indice : indice - 1);
+            }
+            for (size_t k = 2; k < face.size(); k++)
+            {
+                triangles.push_back(face[0]);
+                triangles.push_back(face[k - 1]);
+                triangles.push_back(face[k]);
+            }
+        }
+    }
+
+    return true;
+}
+#endif
+
+
+/**
+ * Lecture des triangles d un maillage.
+ * Fichier .obj : read_mesh de gKit (version avec affichage), sinon une lecture simplifiee.
+ * Fichier .eti : faceset.eti (indices des 3 sommets de chaque face), les sommets etant lus
+ * dans le fichier points.eti du meme dossier (nombre de sommets puis leurs coordonnees).
+ */
+bool ChampDistance::LectureMaillage(const std::string &fichier, std::vector<Vector> &sommets, std::vector<int> &triangles)
+{
+    sommets.clear();
+    triangles.clear();
+
+    std::string extension = fichier.substr(fichier.find_last_of('.') + 1);
+    if (extension == "obj")
+    {
+#ifndef MECASIM_HEADLESS
+        Mesh maillage = read_mesh(fichier.c_str());
+        if (maillage.vertex_count() == 0)
+            return false;
+
+        for (int t = 0; t < maillage.triangle_count(); t++)
+        {
+            TriangleData triangle = maillage.triangle(t);
+            sommets.push_back(Vector(triangle.a));
+            sommets.push_back(Vector(triangle.b));
+            sommets.push_back(Vector(triangle.c));
+            triangles.push_back(3 * t);
+            triangles.push_back(3 * t + 1);
+            triangles.push_back(3 * t + 2);
+        }
+#else
+        if (!LectureObj(fichier, sommets, triangles))
+        {
+            std::cout << "Frontiere : impossible de lire " << fichier << std::endl;
+            return false;
+        }
+#endif
+    }
+    else
+    {
+        std::string dossier = fichier.substr(0, fichier.find_last_of('/') + 1);
+        std::ifstream points((dossier + "points.eti").c_str());
+        std::ifstream faces(fichier.c_str());
+        if (!points || !faces)
+        {
+            std::cout << "Frontiere : impossible de lire " << fichier << " ou " << dossier << "points.eti" << std::endl;
+            return false;
+        }
+
+        int nb_sommets = 0;
+        points >> nb_sommets;
+        sommets.resize(nb_sommets);
+        for (int s = 0; s < nb_sommets; s++)
+            points >> sommets[s].x >> sommets[s].y >> sommets[s].z;
+
+        int a, b, c;
+        while (faces >> a >> b >> c)
+        {
+            triangles.push_back(a);
+            triangles.push_back(b);
+            triangles.push_back(c);
+        }
+    }
+
+    // les indices doivent designer des sommets lus
+    for (size_t k = 0; k < triangles.size(); k++)
+        if (triangles[k] < 0 || triangles[k] >= (int)sommets.size())
+        {
+            std::cout << "Frontiere : indice de sommet " << triangles[k] << " invalide dans " << fichier << std::endl;
+            sommets.clear();
+            triangles.clear();
+            return false;
+        }
+
+    return !triangles.empty();
+}
+
+
+/**
+ * Construction du champ de distance signee (maillage ferme).
+ * 1. distances exactes aux triangles proches de chaque noeud (bande d une cellule autour des triangles),
+ * 2. propagation du triangle le plus proche aux autres noeuds par balayages dans les 8 directions,
+ * 3. signe : parite du nombre de triangles traverses le long de chaque ligne de noeuds selon x.
+ * Le champ est positif dans la region du fluide : a l exterieur du maillage pour un obstacle,
+ * a l interieur pour un conteneur.
+ */
+void ChampDistance::Construit(const std::vector<Vector> &sommets, const std::vector<int> &triangles,
+                              float pas, float marge, TypeFrontiere type)
+{
+    _Valeurs.clear();
+    if (sommets.empty() || triangles.empty() || pas <= 0)
+        return;
+
+    /* Grille : boite englobante du maillage et marge */
+    Vector pmin = sommets[0], pmax = sommets[0];
+    for (size_t s = 1; s < sommets.size(); s++)
+    {
+        pmin = Vector(std::min(pmin.x, sommets[s].x), std::min(pmin.y, sommets[s].y), std::min(pmin.z, sommets[s].z));
+        pmax = Vector(std::max(pmax.x, sommets[s].x), std::max(pmax.y, sommets[s].y), std::max(pmax.z, sommets[s].z));
+    }
+
+    _Pas = pas;
+    _InvPas = 1 / pas;
+    _Origine = pmin - Vector(marge, marge, marge);
+    _Nx = std::max(2, (int)ceil((pmax.x - pmin.x + 2 * marge) * _InvPas) + 1);
+    _Ny = std::max(2, (int)ceil((pmax.y - pmin.y + 2 * marge) * _InvPas) + 1);
+    _Nz = std::max(2, (int)ceil((pmax.z - pmin.z + 2 * marge) * _InvPas) + 1);
+
+    const int nb_noeuds = _Nx * _Ny * _Nz;
+    const float infini = (_Nx + _Ny + _Nz) * _Pas;
+    _Valeurs.assign(nb_noeuds, infini);
+    std::vector<int> plus_proche(nb_noeuds, -1);
+    std::vector<int> croisements(nb_noeuds, 0);
+
+    const int nb_triangles = (int)triangles.size() / 3;
+
+    /* 1. Distances exactes pres des triangles, et croisements des lignes selon x */
+    for (int t = 0; t < nb_triangles; t++)
+    {
+        const Vector &a = sommets[triangles[3 * t]];
+        const Vector &b = sommets[triangles[3 * t + 1]];
+        const Vector &c = sommets[triangles[3 * t + 2]];
+
+        // coordonnees dans la grille
+        Vector ga = (a - _Origine) * _InvPas, gb = (b - _Origine) * _InvPas, gc = (c - _Origine) * _InvPas;
+
+        int i0 = std::max(0, (int)floor(std::min(ga.x, std::min(gb.x, gc.x))) - 1);
+        int i1 = std::min(_Nx - 1, (int)ceil(std::max(ga.x, std::max(gb.x, gc.x))) + 1);
+        int j0 = std::max(0, (int)floor(std::min(ga.y, std::min(gb.y, gc.y))) - 1);
+        int j1 = std::min(_Ny - 1, (int)ceil(std::max(ga.y, std::max(gb.y, gc.y))) + 1);
+        int k0 = std::max(0, (int)floor(std::min(ga.z, std::min(gb.z, gc.z))) - 1);
+        int k1 = std::min(_Nz - 1, (int)ceil(std::max(ga.z, std::max(gb.z, gc.z))) + 1);
+
+        for (int k = k0; k <= k1; k++)
+            for (int j = j0; j <= j1; j++)
+                for (int i = i0; i <= i1; i++)
+                {
+                    Vector p = _Origine + Vector(i, j, k) * _Pas;
+                    float d = length(p - PointPlusProcheTriangle(p, a, b, c));
+                    int n = Indice(i, j, k);
+                    if (d < _Valeurs[n])
+                    {
+                        _Valeurs[n] = d;
+                        plus_proche[n] = t;
+                    }
+                }
+
+        // lignes (j, k) traversant le triangle : le croisement est compte au premier noeud au-dela
+        j0 = std::max(0, (int)ceil(std::min(ga.y, std::min(gb.y, gc.y))));
+        j1 = std::min(_Ny - 1, (int)floor(std::max(ga.y, std::max(gb.y, gc.y))));
+        k0 = std::max(0, (int)ceil(std::min(ga.z, std::min(gb.z, gc.z))));
+        k1 = std::min(_Nz - 1, (int)floor(std::max(ga.z, std::max(gb.z, gc.z))));
+
+        for (int k = k0; k <= k1; k++)
+            for (int j = j0; j <= j1; j++)
+            {
+                double wa, wb, wc;
+                if (!PointDansTriangle(j, k, ga.y, ga.z, gb.y, gb.z, gc.y, gc.z, wa, wb, wc))
+                    continue;
+
+                double x = wa * ga.x + wb * gb.x + wc * gc.x;
+                int i = std::max(0, (int)ceil(x));
+                if (i < _Nx)
+                    croisements[Indice(i, j, k)]++;
+            }
+    }
+
+    /* 2. Propagation : balayages de la grille dans les 8 directions, deux fois */
+    for (int passe = 0; passe < 2; passe++)
+        for (int direction = 0; direction < 8; direction++)
+        {
+            int di = (direction & 1) ? -1 : 1;
+            int dj = (direction & 2) ? -1 : 1;
+            int dk = (direction & 4) ? -1 : 1;
+            int ia = di > 0 ? 1 : _Nx - 2, ib = di > 0 ? _Nx : -1;
+            int ja = dj > 0 ? 1 : _Ny - 2, jb = dj > 0 ? _Ny : -1;
+            int ka = dk > 0 ? 1 : _Nz - 2, kb = dk > 0 ? _Nz : -1;
+
+            for (int k = ka; k != kb; k += dk)
+                for (int j = ja; j != jb; j += dj)
+                    for (int i = ia; i != ib; i += di)
+                    {
+                        int n = Indice(i, j, k);
+                        Vector p = _Origine + Vector(i, j, k) * _Pas;
+
+                        // 7 voisins deja visites dans cette direction
+                        for (int v = 1; v < 8; v++)
+                        {
+                            int t = plus_proche[Indice(i - ((v & 1) ? di : 0), j - ((v & 2) ? dj : 0), k - ((v & 4) ? dk : 0))];
+                            if (t < 0 || t == plus_proche[n])
+                                continue;
+
+                            float d = length(p - PointPlusProcheTriangle(p, sommets[triangles[3 * t]], sommets[triangles[3 * t + 1]],
+                                                                             sommets[triangles[3 * t + 2]]));
+                            if (d < _Valeurs[n])
+                            {
+                                _Valeurs[n] = d;
+                                plus_proche[n] = t;
+                            }
+                        }
+                    }
+        }
+
+    /* 3. Signe : un noeud precede d un nombre impair de croisements sur sa ligne est dans le maillage */
+    for (int k = 0; k < _Nz; k++)
+        for (int j = 0; j < _Ny; j++)
+        {
+            int total = 0;
+            for (int i = 0; i < _Nx; i++)
+            {
+                int n = Indice(i, j, k);
+                total += croisements[n];
+                bool interieur = (total % 2) == 1;
+                if (interieur == (type == FRONTIERE_OBSTACLE))
+                    _Valeurs[n] = -_Valeurs[n];
+            }
+        }
+
+    std::cout << "Frontiere : " << nb_triangles << " triangles, champ de distance " << _Nx << " x " << _Ny
+              << " x " << _Nz << " (pas " << _Pas << ")" << std::endl;
+}
+
+
+/**
+ * Distance signee au point p.
+ */
+float ChampDistance::Distance(const Vector &p) const
+{
+    Vector gradient;
+    return Distance(p, gradient);
+}
+
+
+/**
+ * Distance signee et gradient au point p : interpolation trilineaire des 8 noeuds de la cellule
+ * et derivees de cette interpolation. Hors de la grille, la valeur au point le plus proche de la
+ * grille est prolongee de la distance a la grille (le signe du bord est conserve).
+ */
+float ChampDistance::Distance(const Vector &p, Vector &gradient) const
+{
+    if (EstVide())
+    {
+        gradient = Vector(0, 0, 0);
+        return 0;
+    }
+
+    // coordonnees dans la grille, ramenees dans la grille
+    Vector g = (p - _Origine) * _InvPas;
+    Vector c(std::min(std::max(g.x, 0.f), float(_Nx - 1)),
+             std::min(std::max(g.y, 0.f), float(_Ny - 1)),
+             std::min(std::max(g.z, 0.f), float(_Nz - 1)));
+
+    int i = std::min((int)c.x, _Nx - 2);
+    int j = std::min((int)c.y, _Ny - 2);
+    int k = std::min((int)c.z, _Nz - 2);
+    float fx = c.x - i, fy = c.y - j, fz = c.z - k;
+
+    const float *v = &_Valeurs[Indice(i, j, k)];
+    const int sy = _Nx, sz = _Nx * _Ny;
+    float v000 = v[0], v100 = v[1], v010 = v[sy], v110 = v[sy + 1];
+    float v001 = v[sz], v101 = v[sz + 1], v011 = v[sz + sy], v111 = v[sz + sy + 1];
+
+    // interpolation selon x, puis y, puis z
+    float x00 = v000 + fx * (v100 - v000), x10 = v010 + fx * (v110 - v010);
+    float x01 = v001 + fx * (v101 - v001), x11 = v011 + fx * (v111 - v011);
+    float y0 = x00 + fy * (x10 - x00), y1 = x01 + fy * (x11 - x01);
+    float d = y0 + fz * (y1 - y0);
+
+    float dx0 = (1 - fy) * (v100 - v000) + fy * (v110 - v010);
+    float dx1 = (1 - fy) * (v101 - v001) + fy * (v111 - v011);
+    gradient = Vector(dx0 + fz * (dx1 - dx0),
+                      (1 - fz) * (x10 - x00) + fz * (x11 - x01),
+                      y1 - y0) * _InvPas;
+
+    Vector dehors = (g - c) * _Pas;
+    float e2 = length2(dehors);
+    if (e2 > 0)
+    {
+        float e = sqrt(e2);
+        if (d >= 0)
+        {
+            d += e;
+            gradient = dehors / e;
+        }
+        else
+        {
+            d -= e;
+            gradient = -dehors / e;
+        }
+    }
+
+    return d;
+}
@@ -0,0 +1,79 @@
+/** \file ChampDistance.h
+ \brief Frontieres de forme quelconque (conteneurs, obstacles, terrains) decrites par un champ
+ de distance signee precalcule sur une grille reguliere, construit a partir d un maillage triangule.
+ */
+
+#ifndef CHAMP_DISTANCE_H
+#define CHAMP_DISTANCE_H
+
+
+/** Librairies de base **/
+#include <vector>
+#include <string>
+
+// Fichiers de gkit2light
+#include "vec.h"
+
+
+/// Type de frontiere : le fluide est a l exterieur (obstacle) ou a l interieur (conteneur) du maillage
+enum TypeFrontiere
+{
+    FRONTIERE_OBSTACLE = 0,
+    FRONTIERE_CONTENEUR = 1
+};
+
+
+/**
+ * \brief Champ de distance signee sur une grille reguliere.
+ * La distance est positive dans la region du fluide et negative dans la frontiere ; elle est
+ * calculee aux noeuds de la grille a la construction, puis interpolee (trilineaire) avec son
+ * gradient, qui donne la normale a la frontiere. Le cout d une requete est constant quelle que
+ * soit la complexite du maillage.
+ */
+class ChampDistance
+{
+public:
+
+    /*! Constructeur : champ vide */
+    ChampDistance() : _Nx(0), _Ny(0), _Nz(0), _Pas(0), _InvPas(0) {}
+
+    /*! Lecture des triangles d un maillage : fichier .obj, ou faceset.eti (sommets dans points.eti du meme dossier) */
+    static bool LectureMaillage(const std::string &fichier, std::vector<Vector> &sommets, std::vector<int> &triangles);
+
+    /*! Construction du champ (noeuds espaces de pas, marge autour du maillage) */
+    void Construit(const std::vector<Vector> &sommets, const std::vector<int> &triangles,
+                   float pas, float marge, TypeFrontiere type);
+
+    /*! Indique si le champ n a pas ete construit */
+    bool EstVide() const { return _Valeurs.empty(); }
+
+    /*! Distance signee au point p */
+    float Distance(const Vector &p) const;
+
+    /*! Distance signee et son gradient au point p */
+    float Distance(const Vector &p, Vector &gradient) const;
+
+    /*! Bornes de la grille */
+    Vector Min() const { return _Origine; }
+    Vector Max() const { return _Origine + Vector(_Nx - 1, _Ny - 1, _Nz - 1) * _Pas; }
+
+private:
+
+    /*! Indice du noeud (i, j, k) */
+    int Indice(int i, int j, int k) const { return (k * _Ny + j) * _Nx + i; }
+
+    /// Nombre de noeuds selon x, y et z
+    int _Nx, _Ny, _Nz;
+
+    /// Position du noeud (0, 0, 0)
+    Vector _Origine;
+
+    /// Espacement des noeuds et son inverse
+    float _Pas, _InvPas;
+
+    /// Distances signees aux noeuds
+    std::vector<float> _Valeurs;
+};
+
+
+#endif
@@ -0,0 +1,157 @@
+/** \file GrilleSPH.cpp
+ \brief Construction de la grille de recherche des voisins (tri par comptage).
+ */
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "vec.h"
+#include "GrilleSPH.h"
+#include "TriMorton.h"
+
+
+/// Nombre minimum de cellules autorisees avant d agrandir la taille des cellules
+const int NB_CELLULES_MIN = 4096;
+
+/// Nombre maximum de cellules par particule (evite une grille demesuree si une particule s echappe)
+const int NB_CELLULES_PAR_PARTICULE = 8;
+
+
+/**
+ * Constructeur de la class GrilleSPH.
+ */
+GrilleSPH::GrilleSPH()
+    : _Origine(0, 0, 0), _Taille(1)
+{
+    _Dim[0] = _Dim[1] = _Dim[2] = 1;
+}
+
+
+/**
+ * Couleur de la cellule (ix, iy, iz) pour le parcours parallele.
+ */
+static int couleur_cellule(int ix, int iy, int iz)
+{
+    return (ix % 3) + 3 * (iy % 3) + 9 * (iz % 3);
+}
+
+
+/**
+ * Construction de la grille.
+ * La grille couvre la boite englobante des particules avec des cellules de taille taille_cellule
+ * (agrandie si le nombre de cellules devient trop grand par rapport au nombre de particules).
+ * Les particules sont ensuite triees par cellule par un tri par comptage en O(N).
+ */
+void GrilleSPH::Construction(int nb_part, const ChampVectoriel &P, float taille_cellule)
+{
+    /* Boite englobante des particules */
+    Vector pmin(0, 0, 0), pmax(0, 0, 0);
+    if (nb_part > 0)
+        pmin = pmax = P[0];
+
+    for (int i = 1; i < nb_part; ++i)
+    {
+        pmin.x = std::min(pmin.x, P.x[i]);
+        pmin.y = std::min(pmin.y, P.y[i]);
+        pmin.z = std::min(pmin.z, P.z[i]);
+        pmax.x = std::max(pmax.x, P.x[i]);
+        pmax.y = std::max(pmax.y, P.y[i]);
+        pmax.z = std::max(pmax.z, P.z[i]);
+    }
+
+    /* Dimensions de la grille */
+    float ex = pmax.x - pmin.x;
+    float ey = pmax.y - pmin.y;
+    float ez = pmax.z - pmin.z;
+
+    double nb_max = std::max(NB_CELLULES_MIN, NB_CELLULES_PAR_PARTICULE * nb_part);
+    _Taille = taille_cellule;
+
+    // Agrandit les cellules tant que la grille est trop grande (la taille reste >= h)
+    while ((floor(ex / _Taille) + 1) * (floor(ey / _Taille) + 1) * (floor(ez / _Taille) + 1) > nb_max)
+        _Taille *= 1.25f;
+
+    _Origine = pmin;
+    _Dim[0] = (int)(ex / _Taille) + 1;
+    _Dim[1] = (int)(ey / _Taille) + 1;
+    _Dim[2] = (int)(ez / _Taille) + 1;
+
+    int nb_cellules = NbCellules();
+
+    /* Tri par comptage des particules dans les cellules */
+    _CelluleParticule.resize(nb_part);
+    _Tri.resize(nb_part);
+    _Debut.assign(nb_cellules + 1, 0);
+
+    float inv = 1.0f / _Taille;
+    for (int i = 0; i < nb_part; ++i)
+    {
+        int ix = std::max(0, std::min((int)((P.x[i] - _Origine.x) * inv), _Dim[0] - 1));
+        int iy = std::max(0, std::min((int)((P.y[i] - _Origine.y) * inv), _Dim[1] - 1));
+        int iz = std::max(0, std::min((int)((P.z[i] - _Origine.z) * inv), _Dim[2] - 1));
+        int c = Cellule(ix, iy, iz);
+
+        _CelluleParticule[i] = c;
+        _Debut[c + 1]++;
+    }
+
+    // Somme prefixe : debut de chaque cellule dans _Tri
+    for (int c = 0; c < nb_cellules; ++c)
+        _Debut[c + 1] += _Debut[c];
+
+    // Placement des particules (ordre croissant des indices dans chaque cellule)
+    std::vector<int> position(_Debut.begin(), _Debut.end() - 1);
+    for (int i = 0; i < nb_part; ++i)
+        _Tri[position[_CelluleParticule[i]]++] = i;
+
+    /* Repartition des cellules non vides par couleur (tri par comptage) */
+    _DebutCouleur.assign(NB_COULEURS + 1, 0);
+    _CellulesCouleur.clear();
+
+    for (int iz = 0; iz < _Dim[2]; ++iz)
+        for (int iy = 0; iy < _Dim[1]; ++iy)
+            for (int ix = 0; ix < _Dim[0]; ++ix)
+            {
+                int c = Cellule(ix, iy, iz);
+                if (_Debut[c + 1] > _Debut[c])
+                    _DebutCouleur[couleur_cellule(ix, iy, iz) + 1]++;
+            }
+
+    for (int k = 0; k < NB_COULEURS; ++k)
+        _DebutCouleur[k + 1] += _DebutCouleur[k];
+
+    _CellulesCouleur.resize(_DebutCouleur[NB_COULEURS]);
+    std::vector<int> position_couleur(_DebutCouleur.begin(), _DebutCouleur.end() - 1);
+
+    for (int iz = 0; iz < _Dim[2]; ++iz)
+        for (int iy = 0; iy < _Dim[1]; ++iy)
+            for (int ix = 0; ix < _Dim[0]; ++ix)
+            {
+                int c = Cellule(ix, iy, iz);
+                if (_Debut[c + 1] > _Debut[c])
+                    _CellulesCouleur[position_couleur[couleur_cellule(ix, iy, iz)]++] = c;
+            }
+}
+
+
+/**
+ * Code de Morton de la cellule de chaque particule (grille construite au prealable).
+ * Les coordonnees de cellule au-dela de 1023 sont tronquees : l ordre obtenu reste valide,
+ * seule la localite en souffre.
+ */
+void GrilleSPH::CodesMorton(std::vector<unsigned int> &codes) const
+{
+    int nb_part = (int)_CelluleParticule.size();
+    codes.resize(nb_part);
+
+#pragma omp parallel for
+    for (int i = 0; i < nb_part; ++i)
+    {
+        int c = _CelluleParticule[i];
+        int ix = c % _Dim[0];
+        int iy = (c / _Dim[0]) % _Dim[1];
+        int iz = c / (_Dim[0] * _Dim[1]);
+        codes[i] = CodeMorton(ix, iy, iz);
+    }
+}
@@ -0,0 +1,181 @@
+/** \file GrilleSPH.h
+ \brief Grille reguliere (liste chainee de cellules) pour la recherche des voisins
+ des particules SPH.
+ */
+
+#ifndef GRILLE_SPH_H
+#define GRILLE_SPH_H
+
+
+/** Librairies de base **/
+#include <vector>
+
+// Fichiers de gkit2light
+#include "vec.h"
+
+// Fichiers de master_meca_sim
+#include "ParticleStore.h"
+
+
+/**
+ * \brief Grille uniforme de cellules de taille >= h.
+ * Les particules sont triees par cellule (tri par comptage) : deux particules a distance < h
+ * sont donc dans la meme cellule ou dans deux cellules adjacentes (27 cellules voisines).
+ * La grille couvre la boite englobante des particules et est reconstruite a chaque pas de temps.
+ */
+class GrilleSPH
+{
+public:
+
+    /*! Constructeur */
+    GrilleSPH();
+
+    /*! Construction de la grille pour les nb_part premieres positions de P */
+    void Construction(int nb_part, const ChampVectoriel &P, float taille_cellule);
+
+    /*! Nombre de cellules de la grille */
+    int NbCellules() const { return _Dim[0] * _Dim[1] * _Dim[2]; }
+
+    /*! Indice lineaire de la cellule (ix, iy, iz) */
+    int Cellule(int ix, int iy, int iz) const { return (iz * _Dim[1] + iy) * _Dim[0] + ix; }
+
+    /*! Code de Morton de la cellule de chacune des nb_part particules */
+    void CodesMorton(std::vector<unsigned int> &codes) const;
+
+    /*! Parcours parallele de chaque particule avec la liste de ses candidats voisins */
+    template <class Fonction>
+    void ParcoursCandidatsParallele(Fonction f) const;
+
+    /*! Parcours parallele des particules dans l ordre des couleurs de cellules */
+    template <class Fonction>
+    void ParcoursParticulesParallele(Fonction f) const;
+
+
+    /// Coin min de la grille
+    Vector _Origine;
+
+    /// Taille d une cellule (>= h)
+    float _Taille;
+
+    /// Nombre de cellules selon x, y et z
+    int _Dim[3];
+
+    /// Indice dans _Tri de la premiere particule de chaque cellule (NbCellules + 1 valeurs)
+    std::vector<int> _Debut;
+
+    /// Indices des particules triees par cellule
+    std::vector<int> _Tri;
+
+    /// Cellule de chaque particule
+    std::vector<int> _CelluleParticule;
+
+    /// Indice dans _CellulesCouleur de la premiere cellule de chaque couleur (NB_COULEURS + 1 valeurs)
+    std::vector<int> _DebutCouleur;
+
+    /// Cellules non vides triees par couleur
+    std::vector<int> _CellulesCouleur;
+};
+
+
+/// Nombre de couleurs des cellules : (ix % 3, iy % 3, iz % 3)
+const int NB_COULEURS = 27;
+
+
+/// Demi-voisinage : 13 cellules "en avant" de la cellule courante
+/// (chaque paire de cellules adjacentes n est visitee qu une seule fois).
+static const int DEMI_VOISINAGE[13][3] =
+    {
+        {1, 0, 0},
+        {-1, 1, 0}, {0, 1, 0}, {1, 1, 0},
+        {-1, -1, 1}, {0, -1, 1}, {1, -1, 1},
+        {-1, 0, 1}, {0, 0, 1}, {1, 0, 1},
+        {-1, 1, 1}, {0, 1, 1}, {1, 1, 1},
+};
+
+
+/**
+ * Parcours parallele des particules, cellule par cellule et couleur par couleur.
+ * Une cellule ne modifie que ses particules et celles de ses cellules adjacentes :
+ * deux cellules de meme couleur (ix % 3, iy % 3, iz % 3) n ecrivent donc jamais
+ * sur les memes particules. Les couleurs sont traitees l une apres l autre et les cellules
+ * d une meme couleur en parallele, sans synchronisation ni tampon par thread.
+ * L ordre des accumulations sur chaque particule ne depend pas du nombre de threads :
+ * le resultat est identique bit a bit d une execution a l autre.
+ * f(i, voisins, n) est appelee avec les n candidats j de i : particules suivantes de la cellule
+ * de i puis particules des 13 cellules du demi-voisinage. Les distances ne sont pas testees :
+ * les candidats sont filtres (r < h) par le noyau de calcul, qui peut traiter tout le lot en SIMD.
+ */
+template <class Fonction>
+void GrilleSPH::ParcoursCandidatsParallele(Fonction f) const
+{
+    for (int couleur = 0; couleur < NB_COULEURS; ++couleur)
+    {
+        int debut = _DebutCouleur[couleur];
+        int fin = _DebutCouleur[couleur + 1];
+
+#pragma omp parallel
+        {
+            std::vector<int> candidats;
+
+#pragma omp for schedule(dynamic, 8)
+            for (int k = debut; k < fin; ++k)
+            {
+                int c = _CellulesCouleur[k];
+                int ix = c % _Dim[0];
+                int iy = (c / _Dim[0]) % _Dim[1];
+                int iz = c / (_Dim[0] * _Dim[1]);
+
+                for (int a = _Debut[c]; a < _Debut[c + 1]; ++a)
+                {
+                    candidats.clear();
+
+                    // Particules suivantes de la meme cellule
+                    for (int b = a + 1; b < _Debut[c + 1]; ++b)
+                        candidats.push_back(_Tri[b]);
+
+                    // Particules des cellules du demi-voisinage
+                    for (int v = 0; v < 13; ++v)
+                    {
+                        int jx = ix + DEMI_VOISINAGE[v][0];
+                        int jy = iy + DEMI_VOISINAGE[v][1];
+                        int jz = iz + DEMI_VOISINAGE[v][2];
+                        if (jx < 0 || jy < 0 || jz < 0 || jx >= _Dim[0] || jy >= _Dim[1] || jz >= _Dim[2])
+                            continue;
+
+                        int cv = Cellule(jx, jy, jz);
+                        candidats.insert(candidats.end(), _Tri.begin() + _Debut[cv], _Tri.begin() + _Debut[cv + 1]);
+                    }
+
+                    f(_Tri[a], candidats.data(), (int)candidats.size());
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * Parcours parallele des particules, cellule par cellule et couleur par couleur.
+ * f(i) peut modifier i et les particules des cellules adjacentes a celle de i
+ * (par exemple via une liste de voisins construite par ParcoursCandidatsParallele).
+ */
+template <class Fonction>
+void GrilleSPH::ParcoursParticulesParallele(Fonction f) const
+{
+    for (int couleur = 0; couleur < NB_COULEURS; ++couleur)
+    {
+        int debut = _DebutCouleur[couleur];
+        int fin = _DebutCouleur[couleur + 1];
+
+#pragma omp parallel for schedule(dynamic, 8)
+        for (int k = debut; k < fin; ++k)
+        {
+            int c = _CellulesCouleur[k];
+            for (int a = _Debut[c]; a < _Debut[c + 1]; ++a)
+                f(_Tri[a]);
+        }
+    }
+}
+
+
+#endif
@@ -0,0 +1,63 @@
+/** \file ListeVoisins.cpp
+ \brief Listes compactes des voisins des particules SPH.
+ */
+
+#include <vector>
+#include <omp.h>
+
+#include "ListeVoisins.h"
+
+
+/**
+ * Remise a zero des listes : un bloc vide par thread (la capacite des blocs est conservee
+ * d un pas de temps a l autre).
+ */
+void ListeVoisins::Initialise(int nb_part)
+{
+    _Blocs.resize(omp_get_max_threads());
+    for (unsigned int t = 0; t < _Blocs.size(); ++t)
+        _Blocs[t].clear();
+
+    _Bloc.assign(nb_part, 0);
+    _Debut.assign(nb_part, 0);
+    _Nb.assign(nb_part, 0);
+}
+
+
+/**
+ * Enregistre les voisins de la particule i a la fin du bloc du thread courant.
+ */
+void ListeVoisins::Ajoute(int i, const int *voisins, int m)
+{
+    int t = omp_get_thread_num();
+    std::vector<int> &bloc = _Blocs[t];
+
+    _Bloc[i] = t;
+    _Debut[i] = (int)bloc.size();
+    _Nb[i] = m;
+    bloc.insert(bloc.end(), voisins, voisins + m);
+}
+
+
+/**
+ * Nombre total de paires de voisins.
+ */
+long ListeVoisins::NbPaires() const
+{
+    long n = 0;
+    for (unsigned int i = 0; i < _Nb.size(); ++i)
+        n += _Nb[i];
+    return n;
+}
+
+
+/**
+ * Memoire occupee par les listes : blocs des voisins et index par particule.
+ */
+size_t ListeVoisins::Memoire() const
+{
+    size_t octets = (_Bloc.capacity() + _Debut.capacity() + _Nb.capacity()) * sizeof(int);
+    for (unsigned int t = 0; t < _Blocs.size(); ++t)
+        octets += _Blocs[t].capacity() * sizeof(int);
+    return octets;
+}
@@ -0,0 +1,61 @@
+/** \file ListeVoisins.h
+ \brief Listes compactes des voisins des particules SPH, construites par la passe de densite
+ et reutilisees par la passe des forces.
+ */
+
+#ifndef LISTE_VOISINS_H
+#define LISTE_VOISINS_H
+
+
+/** Librairies de base **/
+#include <stddef.h>
+#include <vector>
+
+
+/**
+ * \brief Demi-listes de voisins : pour chaque particule i, les voisins j "en avant" de i
+ * (meme ordre que le parcours de la grille), chaque paire n apparaissant qu une fois.
+ * Chaque thread ecrit les listes des particules qu il traite dans son propre bloc :
+ * la construction se fait en parallele sans synchronisation.
+ */
+class ListeVoisins
+{
+public:
+
+    /*! Constructeur */
+    ListeVoisins() {}
+
+    /*! Remise a zero des listes pour nb_part particules */
+    void Initialise(int nb_part);
+
+    /*! Enregistre les m voisins de la particule i (appele par le thread qui traite i) */
+    void Ajoute(int i, const int *voisins, int m);
+
+    /*! Voisins de la particule i */
+    const int *Voisins(int i) const { return _Blocs[_Bloc[i]].data() + _Debut[i]; }
+
+    /*! Nombre de voisins de la particule i */
+    int Nb(int i) const { return _Nb[i]; }
+
+    /*! Nombre total de paires de voisins */
+    long NbPaires() const;
+
+    /*! Memoire occupee par les listes (en octets, capacites reservees comprises) */
+    size_t Memoire() const;
+
+
+    /// Listes des voisins, un bloc par thread
+    std::vector<std::vector<int> > _Blocs;
+
+    /// Bloc contenant la liste de chaque particule
+    std::vector<int> _Bloc;
+
+    /// Debut de la liste de chaque particule dans son bloc
+    std::vector<int> _Debut;
+
+    /// Nombre de voisins de chaque particule
+    std::vector<int> _Nb;
+};
+
+
+#endif
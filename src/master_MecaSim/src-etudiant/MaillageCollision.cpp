@@ -0,0 +1,445 @@
+/** \file MaillageCollision.cpp
+ \brief Construction de la BVH des maillages de collision et requetes des particules.
+ */
+
+#include <math.h>
+#include <iostream>
+#include <algorithm>
+
+#include "MaillageCollision.h"
+
+
+/**
+ * Point du triangle (a, b, c) le plus proche de p : selon la region ou se projette p
+ * (un sommet, une arete ou l interieur de la face).
+ */
+Vector PointPlusProcheTriangle(const Vector &p, const Vector &a, const Vector &b, const Vector &c)
+{
+    Vector ab = b - a, ac = c - a, ap = p - a;
+    float d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+        return a;
+
+    Vector bp = p - b;
+    float d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+        return b;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        return a + ab * (d1 / (d1 - d3));
+
+    Vector cp = p - c;
+    float d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+        return c;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        return a + ac * (d2 / (d2 - d6));
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    float somme = 1 / (va + vb + vc);
+    return a + ab * (vb * somme) + ac * (vc * somme);
+}
+
+
+/**
+ * Aire de la surface d une boite (a une constante pres).
+ */
+static float Surface(const Vector &min, const Vector &max)
+{
+    Vector d = max - min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+
+/**
+ * Carre de la distance du point p a la boite d un noeud (nulle a l interieur).
+ */
+static float Distance2Boite(const float min[3], const float max[3], const Vector &p)
+{
+    float dx = std::max(std::max(min[0] - p.x, p.x - max[0]), 0.f);
+    float dy = std::max(std::max(min[1] - p.y, p.y - max[1]), 0.f);
+    float dz = std::max(std::max(min[2] - p.z, p.z - max[2]), 0.f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+
+/**
+ * Intersection de la boite d un noeud avec le segment a + t d, t dans [0, tmax]
+ * (inv_d : inverses des composantes de d).
+ */
+static bool SegmentBoite(const float min[3], const float max[3], const Vector &a, const Vector &inv_d, float tmax)
+{
+    float t0x = (min[0] - a.x) * inv_d.x, t1x = (max[0] - a.x) * inv_d.x;
+    float t0y = (min[1] - a.y) * inv_d.y, t1y = (max[1] - a.y) * inv_d.y;
+    float t0z = (min[2] - a.z) * inv_d.z, t1z = (max[2] - a.z) * inv_d.z;
+
+    float entree = std::max(std::max(std::min(t0x, t1x), std::min(t0y, t1y)), std::max(std::min(t0z, t1z), 0.f));
+    float sortie = std::min(std::min(std::max(t0x, t1x), std::max(t0y, t1y)), std::min(std::max(t0z, t1z), tmax));
+    return entree <= sortie;
+}
+
+
+/**
+ * Construction de la BVH : chaque noeud est coupe selon le plan qui minimise la SAH, evaluee
+ * sur NB_INTERVALLES intervalles des centres des triangles selon chaque axe.
+ */
+void MaillageCollision::Construit(const std::vector<Vector> &sommets, const std::vector<int> &triangles)
+{
+    _Noeuds.clear();
+    _Triangles.clear();
+    _Profondeur = 0;
+
+    const int nb = (int)triangles.size() / 3;
+    if (nb == 0)
+        return;
+
+    std::vector<Vector> min(nb), max(nb), centres(nb);
+    std::vector<int> ordre(nb);
+    for (int t = 0; t < nb; t++)
+    {
+        const Vector &a = sommets[triangles[3 * t]];
+        const Vector &b = sommets[triangles[3 * t + 1]];
+        const Vector &c = sommets[triangles[3 * t + 2]];
+        min[t] = Vector(std::min(a.x, std::min(b.x, c.x)), std::min(a.y, std::min(b.y, c.y)), std::min(a.z, std::min(b.z, c.z)));
+        max[t] = Vector(std::max(a.x, std::max(b.x, c.x)), std::max(a.y, std::max(b.y, c.y)), std::max(a.z, std::max(b.z, c.z)));
+        centres[t] = (min[t] + max[t]) * 0.5f;
+        ordre[t] = t;
+    }
+
+    _Noeuds.reserve(2 * nb);
+    ConstruitNoeud(0, nb, 1, min, max, centres, ordre);
+
+    // triangles dans l ordre des feuilles
+    _Triangles.resize(nb);
+    for (int k = 0; k < nb; k++)
+    {
+        int t = ordre[k];
+        Triangle &triangle = _Triangles[k];
+        triangle.a = sommets[triangles[3 * t]];
+        triangle.ab = sommets[triangles[3 * t + 1]] - triangle.a;
+        triangle.ac = sommets[triangles[3 * t + 2]] - triangle.a;
+        Vector n = cross(triangle.ab, triangle.ac);
+        float l = length(n);
+        triangle.normale = l > 0 ? n / l : Vector(0, 1, 0);
+    }
+
+    std::cout << "Maillage de collision : " << nb << " triangles, BVH de " << _Noeuds.size()
+              << " noeuds (profondeur " << _Profondeur << ")" << std::endl;
+}
+
+
+/**
+ * Construction du noeud des triangles ordre[debut, fin) et de ses enfants ; renvoie son indice.
+ * Une feuille est creee pour au plus MAX_FEUILLE triangles, ou si aucune coupe n est plus
+ * avantageuse que la feuille ; si les centres sont confondus, la coupe se fait a la mediane.
+ */
+int MaillageCollision::ConstruitNoeud(int debut, int fin, int profondeur,
+                                      const std::vector<Vector> &min, const std::vector<Vector> &max,
+                                      const std::vector<Vector> &centres, std::vector<int> &ordre)
+{
+    _Profondeur = std::max(_Profondeur, profondeur);
+
+    Vector bmin = min[ordre[debut]], bmax = max[ordre[debut]];
+    Vector cmin = centres[ordre[debut]], cmax = cmin;
+    for (int k = debut + 1; k < fin; k++)
+    {
+        int t = ordre[k];
+        bmin = Vector(std::min(bmin.x, min[t].x), std::min(bmin.y, min[t].y), std::min(bmin.z, min[t].z));
+        bmax = Vector(std::max(bmax.x, max[t].x), std::max(bmax.y, max[t].y), std::max(bmax.z, max[t].z));
+        cmin = Vector(std::min(cmin.x, centres[t].x), std::min(cmin.y, centres[t].y), std::min(cmin.z, centres[t].z));
+        cmax = Vector(std::max(cmax.x, centres[t].x), std::max(cmax.y, centres[t].y), std::max(cmax.z, centres[t].z));
+    }
+
+    int indice = (int)_Noeuds.size();
+    Noeud noeud;
+    noeud.min[0] = bmin.x; noeud.min[1] = bmin.y; noeud.min[2] = bmin.z;
+    noeud.max[0] = bmax.x; noeud.max[1] = bmax.y; noeud.max[2] = bmax.z;
+    noeud.premier = debut;
+    noeud.nb = fin - debut;
+    _Noeuds.push_back(noeud);
+
+    const int nb = fin - debut;
+    if (nb <= MAX_FEUILLE || profondeur >= 60)
+        return indice;
+
+    /* Meilleure coupe selon la SAH : cout relatif (A_g N_g + A_d N_d) / A, a comparer a nb */
+    float cout_min = (float)nb;
+    int axe_min = -1, coupe_min = 0;
+    const float cmin_axe[3] = {cmin.x, cmin.y, cmin.z};
+    const float cmax_axe[3] = {cmax.x, cmax.y, cmax.z};
+    const float surface = Surface(bmin, bmax);
+
+    for (int axe = 0; axe < 3; axe++)
+    {
+        float etendue = cmax_axe[axe] - cmin_axe[axe];
+        if (etendue <= 0)
+            continue;
+        float echelle = NB_INTERVALLES / etendue;
+
+        int compte[NB_INTERVALLES] = {0};
+        Vector imin[NB_INTERVALLES], imax[NB_INTERVALLES];
+        for (int k = debut; k < fin; k++)
+        {
+            int t = ordre[k];
+            const float c[3] = {centres[t].x, centres[t].y, centres[t].z};
+            int i = std::min(NB_INTERVALLES - 1, (int)((c[axe] - cmin_axe[axe]) * echelle));
+            if (compte[i] == 0)
+            {
+                imin[i] = min[t];
+                imax[i] = max[t];
+            }
+            else
+            {
+                imin[i] = Vector(std::min(imin[i].x, min[t].x), std::min(imin[i].y, min[t].y), std::min(imin[i].z, min[t].z));
+                imax[i] = Vector(std::max(imax[i].x, max[t].x), std::max(imax[i].y, max[t].y), std::max(imax[i].z, max[t].z));
+            }
+            compte[i]++;
+        }
+
+        // balayage de droite a gauche : surfaces et nombres a droite de chaque coupe
+        float surface_droite[NB_INTERVALLES];
+        int nb_droite[NB_INTERVALLES];
+        Vector dmin(1e30f, 1e30f, 1e30f), dmax(-1e30f, -1e30f, -1e30f);
+        int n = 0;
+        for (int i = NB_INTERVALLES - 1; i > 0; i--)
+        {
+            if (compte[i])
+            {
+                dmin = Vector(std::min(dmin.x, imin[i].x), std::min(dmin.y, imin[i].y), std::min(dmin.z, imin[i].z));
+                dmax = Vector(std::max(dmax.x, imax[i].x), std::max(dmax.y, imax[i].y), std::max(dmax.z, imax[i].z));
+                n += compte[i];
+            }
+            surface_droite[i] = n ? Surface(dmin, dmax) : 0;
+            nb_droite[i] = n;
+        }
+
+        // balayage de gauche a droite : cout de la coupe entre les intervalles i - 1 et i
+        Vector gmin(1e30f, 1e30f, 1e30f), gmax(-1e30f, -1e30f, -1e30f);
+        n = 0;
+        for (int i = 1; i < NB_INTERVALLES; i++)
+        {
+            if (compte[i - 1])
+            {
+                gmin = Vector(std::min(gmin.x, imin[i - 1].x), std::min(gmin.y, imin[i - 1].y), std::min(gmin.z, imin[i - 1].z));
+                gmax = Vector(std::max(gmax.x, imax[i - 1].x), std::max(gmax.y, imax[i - 1].y), std::max(gmax.z, imax[i - 1].z));
+                n += compte[i - 1];
+            }
+            if (n == 0 || nb_droite[i] == 0)
+                continue;
+
+            float cout = 1 + (Surface(gmin, gmax) * n + surface_droite[i] * nb_droite[i]) / surface;
+            if (cout < cout_min)
+            {
+                cout_min = cout;
+                axe_min = axe;
+                coupe_min = i;
+            }
+        }
+    }
+
+    /* Partage des triangles */
+    int milieu;
+    if (axe_min >= 0)
+    {
+        float origine = cmin_axe[axe_min];
+        float echelle = NB_INTERVALLES / (cmax_axe[axe_min] - origine);
+        milieu = (int)(std::partition(ordre.begin() + debut, ordre.begin() + fin, [&](int t)
+        {
+            const float c[3] = {centres[t].x, centres[t].y, centres[t].z};
+            return std::min(NB_INTERVALLES - 1, (int)((c[axe_min] - origine) * echelle)) < coupe_min;
+        }) - ordre.begin());
+    }
+    else if (nb > 2 * MAX_FEUILLE)
+    {
+        // pas de coupe avantageuse mais trop de triangles pour une feuille : mediane selon le plus grand axe
+        Vector etendue = cmax - cmin;
+        int axe = (etendue.x >= etendue.y && etendue.x >= etendue.z) ? 0 : (etendue.y >= etendue.z ? 1 : 2);
+        milieu = (debut + fin) / 2;
+        std::nth_element(ordre.begin() + debut, ordre.begin() + milieu, ordre.begin() + fin, [&](int a, int b)
+        {
+            const float ca[3] = {centres[a].x, centres[a].y, centres[a].z};
+            const float cb[3] = {centres[b].x, centres[b].y, centres[b].z};
+            return ca[axe] < cb[axe];
+        });
+    }
+    else
+        return indice;
+
+    ConstruitNoeud(debut, milieu, profondeur + 1, min, max, centres, ordre);
+    int second = ConstruitNoeud(milieu, fin, profondeur + 1, min, max, centres, ordre);
+
+    _Noeuds[indice].premier = second;
+    _Noeuds[indice].nb = 0;
+    return indice;
+}
+
+
+/**
+ * Point le plus proche : parcours en profondeur d abord, enfant le plus proche en premier,
+ * les noeuds plus loin que le meilleur point trouve sont ignores.
+ */
+int MaillageCollision::PlusProche(const Vector &p, float rayon, Vector &point) const
+{
+    if (EstVide())
+        return -1;
+
+    float meilleure = rayon * rayon;
+    int resultat = -1;
+
+    int pile[128];
+    int taille = 0;
+    pile[taille++] = 0;
+
+    while (taille > 0)
+    {
+        const Noeud &noeud = _Noeuds[pile[--taille]];
+        if (Distance2Boite(noeud.min, noeud.max, p) >= meilleure)
+            continue;
+
+        if (noeud.nb > 0)
+        {
+            for (int t = noeud.premier; t < noeud.premier + noeud.nb; t++)
+            {
+                const Triangle &triangle = _Triangles[t];
+                Vector q = PointPlusProcheTriangle(p, triangle.a, triangle.a + triangle.ab, triangle.a + triangle.ac);
+                float d2 = length2(p - q);
+                if (d2 < meilleure)
+                {
+                    meilleure = d2;
+                    point = q;
+                    resultat = t;
+                }
+            }
+            continue;
+        }
+
+        int premier = int(&noeud - &_Noeuds[0]) + 1, second = noeud.premier;
+        float d_premier = Distance2Boite(_Noeuds[premier].min, _Noeuds[premier].max, p);
+        float d_second = Distance2Boite(_Noeuds[second].min, _Noeuds[second].max, p);
+        if (d_premier < d_second)
+            std::swap(premier, second);
+        pile[taille++] = premier;
+        pile[taille++] = second;
+    }
+
+    return resultat;
+}
+
+
+/**
+ * Premiere intersection du segment [a, b] avec les triangles (Moller-Trumbore, des deux cotes) ;
+ * le segment est raccourci a chaque intersection trouvee.
+ */
+int MaillageCollision::Intersection(const Vector &a, const Vector &b, float &t) const
+{
+    if (EstVide())
+        return -1;
+
+    Vector d = b - a;
+    Vector inv_d(d.x != 0 ? 1 / d.x : 1e30f, d.y != 0 ? 1 / d.y : 1e30f, d.z != 0 ? 1 / d.z : 1e30f);
+    float tmax = 1;
+    int resultat = -1;
+
+    int pile[128];
+    int taille = 0;
+    pile[taille++] = 0;
+
+    while (taille > 0)
+    {
+        const Noeud &noeud = _Noeuds[pile[--taille]];
+        if (!SegmentBoite(noeud.min, noeud.max, a, inv_d, tmax))
+            continue;
+
+        if (noeud.nb > 0)
+        {
+            for (int k = noeud.premier; k < noeud.premier + noeud.nb; k++)
+            {
+                const Triangle &triangle = _Triangles[k];
+                Vector pvec = cross(d, triangle.ac);
+                float det = dot(triangle.ab, pvec);
+                if (fabsf(det) < 1e-12f)
+                    continue;
+                float inv_det = 1 / det;
+
+                Vector tvec = a - triangle.a;
+                float u = dot(tvec, pvec) * inv_det;
+                if (u < 0 || u > 1)
+                    continue;
+                Vector qvec = cross(tvec, triangle.ab);
+                float v = dot(d, qvec) * inv_det;
+                if (v < 0 || u + v > 1)
+                    continue;
+
+                float s = dot(triangle.ac, qvec) * inv_det;
+                if (s >= 0 && s < tmax)
+                {
+                    tmax = s;
+                    resultat = k;
+                }
+            }
+            continue;
+        }
+
+        pile[taille++] = noeud.premier;
+        pile[taille++] = int(&noeud - &_Noeuds[0]) + 1;
+    }
+
+    t = tmax;
+    return resultat;
+}
+
+
+/**
+ * Contacts des particules : d abord la collision continue (le trajet de debut a fin traverse
+ * un triangle : la normale est orientee vers le point de depart), sinon la proximite (la
+ * particule est a moins de epaisseur du maillage). Chaque particule est traitee independamment.
+ */
+void MaillageCollision::Contacts(int nb, const float *debut_x, const float *debut_y, const float *debut_z,
+                                 const float *fin_x, const float *fin_y, const float *fin_z,
+                                 float epaisseur, ContactMaillage *contacts) const
+{
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < nb; i++)
+    {
+        Vector a(debut_x[i], debut_y[i], debut_z[i]);
+        Vector b(fin_x[i], fin_y[i], fin_z[i]);
+        ContactMaillage &contact = contacts[i];
+        contact.triangle = -1;
+
+        float t;
+        int triangle = Intersection(a, b, t);
+        if (triangle >= 0)
+        {
+            Vector n = _Triangles[triangle].normale;
+            if (dot(b - a, n) > 0)
+                n = -n;
+            Vector impact = a + (b - a) * t;
+            contact.normale = n;
+            contact.distance = dot(b - impact, n) - epaisseur;
+            contact.triangle = triangle;
+            continue;
+        }
+
+        Vector q;
+        triangle = PlusProche(b, epaisseur, q);
+        if (triangle >= 0)
+        {
+            Vector d = b - q;
+            float l = length(d);
+            Vector n = _Triangles[triangle].normale;
+            if (l > 1e-6f * epaisseur)
+                n = d / l;
+            else if (dot(a - b, n) < 0)
+                n = -n;
+            contact.normale = n;
+            contact.distance = l - epaisseur;
+            contact.triangle = triangle;
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/** \file MaillageCollision.h
+ \brief Collisions des particules avec des maillages triangules (ouverts ou fermes) :
+ hierarchie de volumes englobants (BVH) construite selon l heuristique des surfaces (SAH),
+ requetes de point le plus proche et de collision continue (trajet d une particule pendant un pas).
+ */
+
+#ifndef MAILLAGE_COLLISION_H
+#define MAILLAGE_COLLISION_H
+
+
+/** Librairies de base **/
+#include <vector>
+
+// Fichiers de gkit2light
+#include "vec.h"
+
+
+/*! Point du triangle (a, b, c) le plus proche de p */
+Vector PointPlusProcheTriangle(const Vector &p, const Vector &a, const Vector &b, const Vector &c);
+
+
+/**
+ * \brief Contact d une particule avec le maillage.
+ * normale : normale unitaire du cote de la particule ; distance : distance signee de la particule
+ * a la surface decalee de l epaisseur (negative en cas de contact) ; triangle : -1 sans contact.
+ */
+struct ContactMaillage
+{
+    Vector normale;
+    float distance;
+    int triangle;
+};
+
+
+/**
+ * \brief Maillage de collision et sa BVH.
+ * Les noeuds sont ranges en profondeur d abord : le premier enfant d un noeud interne le suit
+ * dans le tableau, l indice du second est conserve. Les triangles sont recopies dans l ordre
+ * des feuilles (sommet et deux aretes), pour un parcours sans indirection.
+ */
+class MaillageCollision
+{
+public:
+
+    /// Nombre maximal de triangles d une feuille
+    static const int MAX_FEUILLE = 4;
+
+    /// Nombre d intervalles pour l evaluation de la SAH selon chaque axe
+    static const int NB_INTERVALLES = 16;
+
+    /*! Constructeur : maillage vide */
+    MaillageCollision() : _Profondeur(0) {}
+
+    /*! Construction de la BVH sur les triangles (3 indices de sommets par triangle) */
+    void Construit(const std::vector<Vector> &sommets, const std::vector<int> &triangles);
+
+    /*! Indique si le maillage est vide */
+    bool EstVide() const { return _Noeuds.empty(); }
+
+    /*! Point le plus proche de p a une distance inferieure a rayon ; renvoie le triangle, ou -1 */
+    int PlusProche(const Vector &p, float rayon, Vector &point) const;
+
+    /*! Premiere intersection du segment [a, b] ; renvoie le triangle, ou -1, et la fraction t du segment */
+    int Intersection(const Vector &a, const Vector &b, float &t) const;
+
+    /*! Normale unitaire du triangle t (ordre de la BVH) */
+    Vector Normale(int t) const { return _Triangles[t].normale; }
+
+    /*! Contacts des particules allant de debut a fin pendant le pas (calcul parallele) */
+    void Contacts(int nb, const float *debut_x, const float *debut_y, const float *debut_z,
+                  const float *fin_x, const float *fin_y, const float *fin_z,
+                  float epaisseur, ContactMaillage *contacts) const;
+
+    /*! Nombre de triangles, de noeuds et profondeur de la BVH */
+    int NbTriangles() const { return (int)_Triangles.size(); }
+    int NbNoeuds() const { return (int)_Noeuds.size(); }
+    int Profondeur() const { return _Profondeur; }
+
+private:
+
+    /**
+     * \brief Noeud de la BVH (32 octets) : boite englobante, et premier triangle et nombre de
+     * triangles d une feuille, ou indice du second enfant d un noeud interne (nb = 0).
+     */
+    struct Noeud
+    {
+        float min[3];
+        int premier;
+        float max[3];
+        int nb;
+    };
+
+    /**
+     * \brief Triangle : sommet a, aretes ab et ac, normale unitaire.
+     */
+    struct Triangle
+    {
+        Vector a, ab, ac, normale;
+    };
+
+    /*! Construction du sous-arbre des triangles [debut, fin) de l ordre courant */
+    int ConstruitNoeud(int debut, int fin, int profondeur,
+                       const std::vector<Vector> &min, const std::vector<Vector> &max,
+                       const std::vector<Vector> &centres, std::vector<int> &ordre);
+
+    /// Noeuds de la BVH
+    std::vector<Noeud> _Noeuds;
+
+    /// Triangles dans l ordre des feuilles
+    std::vector<Triangle> _Triangles;
+
+    /// Profondeur de la BVH
+    int _Profondeur;
+};
+
+
+#endif
@@ -32,12 +32,18 @@
 
 /** Librairie de base **/
 #include <list>
+#include <vector>
 #include <string>
 #include <iostream>
 
 
 #include "vec.h"
+#include "Reprise.h"
+
+// Pas de maillage d affichage (ni OpenGL) pour la simulation sans fenetre
+#ifndef MECASIM_HEADLESS
 #include "draw.h"
+#endif
 
 
 
@@ -76,6 +82,12 @@ public:
     
     /*! Mise a jour du Mesh (pour affichage) */
     virtual void updateVertex() = 0;
+    
+    /*! Ecriture de l etat dans un fichier de reprise (faux si l objet ne sait pas le faire) */
+    virtual bool EcritReprise(EcritureReprise &fichier) const { return false; }
+    
+    /*! Lecture de l etat depuis un fichier de reprise (faux en cas d erreur) */
+    virtual bool LitReprise(LectureReprise &fichier) { return false; }
 	
 	/*! Destructeur */
 	virtual ~Noeud(){};
@@ -86,8 +98,10 @@ public:
     /// Nom du noeud
     std::string _name;
     
+#ifndef MECASIM_HEADLESS
     /// Declaration du Mesh (maillage pour l affichage)
     Mesh m_ObjetSimule;
+#endif
     
     /// Coordonnees du point d interaction
     Vector Coord_Point_Inter;
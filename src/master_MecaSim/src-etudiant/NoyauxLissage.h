@@ -0,0 +1,216 @@
+/** \file NoyauxLissage.h
+ \brief Noyaux de lissage SPH en 3D (poly6, spiky, viscosite, spline cubique, Wendland C2 et C4) :
+ normalisations constantes a la compilation, constantes calculees une fois par rayon h, et fonctions
+ en ligne (valeur, gradient, laplacien, chacun avec la normalisation de son noyau) parametres des passes
+ de densite et de forces.
+ */
+
+#ifndef NOYAUX_LISSAGE_H
+#define NOYAUX_LISSAGE_H
+
+
+/** Librairies de base **/
+#include <math.h>
+
+
+/// Pi pour les normalisations constantes a la compilation
+constexpr double PI_NOYAUX = 3.14159265358979323846;
+
+
+/**
+ * \brief Constantes d un jeu de noyaux pour un rayon h, avec q = r / h :
+ *  W(r) = sigma / h^3 f(q), grad W(r) = sigma / h^5 g(q) r (vecteur), laplacien W(r) = sigma / h^5 l(q),
+ * ou sigma est la normalisation en 3D (pour h = 1) du noyau evalue, Sigma() de chaque noyau : un meme
+ * noyau garde sa normalisation quel que soit son role dans le jeu (densite, gradient ou laplacien).
+ * w0 = W(0) du noyau de densite, contribution d une particule a sa propre densite (masse unitaire).
+ */
+struct ConstantesNoyau
+{
+    float h, h2, inv_h, inv_h2, inv_h3, inv_h5;
+    float w0;
+};
+
+
+/**
+ * \brief Noyau poly6 (Muller et al. 2003) : f(q) = (1 - q^2)^3 ; sans racine (q^2 seul).
+ */
+struct NoyauPoly6
+{
+    static constexpr float Sigma() { return (float)(315 / (64 * PI_NOYAUX)); }
+
+    static inline float W(float r2, const ConstantesNoyau &k)
+    {
+        float z = 1 - r2 * k.inv_h2;
+        return Sigma() * k.inv_h3 * z * z * z;
+    }
+
+    static inline float GradientSurR(float r2, const ConstantesNoyau &k)
+    {
+        float z = 1 - r2 * k.inv_h2;
+        return -6 * Sigma() * k.inv_h5 * z * z;
+    }
+
+    static inline float Laplacien(float r2, const ConstantesNoyau &k)
+    {
+        float q2 = r2 * k.inv_h2;
+        return -6 * Sigma() * k.inv_h5 * (1 - q2) * (3 - 7 * q2);
+    }
+};
+
+
+/**
+ * \brief Noyau spiky (Muller et al. 2003) : f(q) = (1 - q)^3, gradient non nul en 0 (pressions).
+ */
+struct NoyauSpiky
+{
+    static constexpr float Sigma() { return (float)(15 / PI_NOYAUX); }
+
+    static inline float W(float r2, const ConstantesNoyau &k)
+    {
+        float u = 1 - sqrtf(r2) * k.inv_h;
+        return Sigma() * k.inv_h3 * u * u * u;
+    }
+
+    static inline float GradientSurR(float r2, const ConstantesNoyau &k)
+    {
+        float q = sqrtf(r2) * k.inv_h;
+        return -3 * Sigma() * k.inv_h5 * (1 - q) * (1 - q) / q;
+    }
+};
+
+
+/**
+ * \brief Noyau de viscosite (Muller et al. 2003) : f(q) = -q^3 / 2 + q^2 + 1 / (2q) - 1,
+ * laplacien l(q) = 6 (1 - q) positif (viscosite dissipative).
+ */
+struct NoyauViscosite
+{
+    static constexpr float Sigma() { return (float)(15 / (2 * PI_NOYAUX)); }
+
+    static inline float W(float r2, const ConstantesNoyau &k)
+    {
+        float q = sqrtf(r2) * k.inv_h;
+        return Sigma() * k.inv_h3 * (-0.5f * q * q * q + q * q + 0.5f / q - 1);
+    }
+
+    static inline float GradientSurR(float r2, const ConstantesNoyau &k)
+    {
+        float q = sqrtf(r2) * k.inv_h;
+        return Sigma() * k.inv_h5 * (2 - 1.5f * q - 0.5f / (q * q * q));
+    }
+
+    static inline float Laplacien(float r2, const ConstantesNoyau &k)
+    {
+        return 6 * Sigma() * k.inv_h5 * (1 - sqrtf(r2) * k.inv_h);
+    }
+};
+
+
+/**
+ * \brief Spline cubique (Monaghan 1992, support h) : f(q) = 6 q^3 - 6 q^2 + 1 pour q <= 1/2,
+ * 2 (1 - q)^3 au dela.
+ */
+struct NoyauSplineCubique
+{
+    static constexpr float Sigma() { return (float)(8 / PI_NOYAUX); }
+
+    static inline float W(float r2, const ConstantesNoyau &k)
+    {
+        float q = sqrtf(r2) * k.inv_h;
+        float u = 1 - q;
+        return Sigma() * k.inv_h3 * ((q <= 0.5f) ? 6 * q * q * (q - 1) + 1 : 2 * u * u * u);
+    }
+
+    static inline float GradientSurR(float r2, const ConstantesNoyau &k)
+    {
+        float q = sqrtf(r2) * k.inv_h;
+        float u = 1 - q;
+        return Sigma() * k.inv_h5 * ((q <= 0.5f) ? 18 * q - 12 : -6 * u * u / q);
+    }
+};
+
+
+/**
+ * \brief Wendland C2 (3D) : f(q) = (1 - q)^4 (1 + 4q), gradient sans division par q.
+ */
+struct NoyauWendlandC2
+{
+    static constexpr float Sigma() { return (float)(21 / (2 * PI_NOYAUX)); }
+
+    static inline float W(float r2, const ConstantesNoyau &k)
+    {
+        float q = sqrtf(r2) * k.inv_h;
+        float u = 1 - q;
+        float u2 = u * u;
+        return Sigma() * k.inv_h3 * u2 * u2 * (1 + 4 * q);
+    }
+
+    static inline float GradientSurR(float r2, const ConstantesNoyau &k)
+    {
+        float u = 1 - sqrtf(r2) * k.inv_h;
+        return -20 * Sigma() * k.inv_h5 * u * u * u;
+    }
+};
+
+
+/**
+ * \brief Wendland C4 (3D) : f(q) = (1 - q)^6 (1 + 6q + 35/3 q^2).
+ */
+struct NoyauWendlandC4
+{
+    static constexpr float Sigma() { return (float)(495 / (32 * PI_NOYAUX)); }
+
+    static inline float W(float r2, const ConstantesNoyau &k)
+    {
+        float q = sqrtf(r2) * k.inv_h;
+        float u = 1 - q;
+        float u3 = u * u * u;
+        return Sigma() * k.inv_h3 * u3 * u3 * (1 + 6 * q + (35.f / 3) * q * q);
+    }
+
+    static inline float GradientSurR(float r2, const ConstantesNoyau &k)
+    {
+        float q = sqrtf(r2) * k.inv_h;
+        float u = 1 - q;
+        float u2 = u * u;
+        return (-56.f / 3) * Sigma() * k.inv_h5 * u2 * u2 * u * (1 + 5 * q);
+    }
+};
+
+
+/**
+ * \brief Jeu de noyaux d une simulation : noyau de densite D, noyau du gradient des pressions G,
+ * noyau du laplacien de la viscosite L.
+ */
+template <class D, class G, class L>
+struct JeuNoyaux
+{
+    typedef D Densite;
+    typedef G Gradient;
+    typedef L Laplacien;
+
+    /*! Constantes pour le rayon h (calculees une fois par rayon) */
+    static ConstantesNoyau Constantes(float h)
+    {
+        ConstantesNoyau k;
+        k.h = h;
+        k.h2 = h * h;
+        k.inv_h = 1 / h;
+        k.inv_h2 = 1 / (h * h);
+        k.inv_h3 = 1 / (h * h * h);
+        k.inv_h5 = 1 / (h * h * h * h * h);
+        k.w0 = D::W(0, k);
+        return k;
+    }
+};
+
+
+/// Jeux de noyaux : poly6 / spiky / viscosite (Muller et al. 2003), et noyaux a support compact
+/// usuels pour la densite et le gradient des pressions, avec le laplacien du noyau de viscosite
+typedef JeuNoyaux<NoyauPoly6, NoyauSpiky, NoyauViscosite> JeuPoly6;
+typedef JeuNoyaux<NoyauSplineCubique, NoyauSplineCubique, NoyauViscosite> JeuSplineCubique;
+typedef JeuNoyaux<NoyauWendlandC2, NoyauWendlandC2, NoyauViscosite> JeuWendlandC2;
+typedef JeuNoyaux<NoyauWendlandC4, NoyauWendlandC4, NoyauViscosite> JeuWendlandC4;
+
+
+#endif
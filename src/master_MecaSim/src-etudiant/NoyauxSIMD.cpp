@@ -0,0 +1,562 @@
+/** \file NoyauxSIMD.cpp
+ \brief Noyaux de calcul SPH par paires : versions scalaire, AVX2 (8 paires) et AVX-512 (16 paires).
+ Les versions vectorielles chargent les voisins par gather dans les tableaux SoA des particules ;
+ seule la version adaptee au processeur est appelee (choix a l execution).
+ Les versions specialisees par jeu de noyaux de lissage sont des boucles scalaires instanciees pour
+ chaque jeu (noyaux en ligne, constantes connues), vectorisees par le compilateur.
+ */
+
+#include <math.h>
+#include <string>
+
+#include "NoyauxSIMD.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NOYAUX_X86
+#include <immintrin.h>
+#endif
+
+
+/*************************************************************************/
+/* Version scalaire (portable)                                           */
+/*************************************************************************/
+
+/**
+ * Noyau de densite scalaire.
+ */
+static int densite_scalaire(int i, const int *voisins, int n, const DonneesDensite &d,
+                            int *voisins_h, float *w)
+{
+    float xi = d.px[i], yi = d.py[i], zi = d.pz[i];
+    int m = 0;
+
+    for (int k = 0; k < n; ++k)
+    {
+        int j = voisins[k];
+        float dx = xi - d.px[j];
+        float dy = yi - d.py[j];
+        float dz = zi - d.pz[j];
+        float r2 = dx * dx + dy * dy + dz * dz;
+        if (r2 < d.h2)
+        {
+            float z = d.h2 - r2;
+            voisins_h[m] = j;
+            w[m] = d.c * z * z * z;
+            m++;
+        }
+    }
+    return m;
+}
+
+/**
+ * Terme de force de la paire (i, j) : pression + viscosite.
+ */
+static inline void force_paire(int i, int j, const DonneesForce &d, float &tx, float &ty, float &tz)
+{
+    float dx = d.px[i] - d.px[j];
+    float dy = d.py[i] - d.py[j];
+    float dz = d.pz[i] - d.pz[j];
+    float r2 = dx * dx + dy * dy + dz * dz;
+
+    float q = sqrtf(r2) / d.h;
+    float tmp0 = d.c * (1 - q) / d.rho[i] / d.rho[j];
+    float press = tmp0 * d.c_press * (d.press[i] + d.press[j]) * (1 - q) / q;
+    float visc = tmp0 * d.c_mu;
+    tx = press * dx + visc * (d.vx[i] - d.vx[j]);
+    ty = press * dy + visc * (d.vy[i] - d.vy[j]);
+    tz = press * dz + visc * (d.vz[i] - d.vz[j]);
+}
+
+/**
+ * Noyau des gradients des noyaux d origine, commun aux trois versions (hors des boucles critiques) :
+ * gd = 24 m / (pi h^8) (h^2 - r^2)^2 (poly6), gp = 30 m / (pi h^4) (1 - q)^2 / q (spiky),
+ * avec c = m / (pi h^4).
+ */
+static int gradients_origine(int i, const int *voisins, int n, const DonneesForce &d,
+                             int *voisins_h, float *gd, float *gp)
+{
+    float xi = d.px[i], yi = d.py[i], zi = d.pz[i];
+    float inv_h2 = 1 / d.h2;
+    int m = 0;
+
+    for (int k = 0; k < n; ++k)
+    {
+        int j = voisins[k];
+        float dx = xi - d.px[j];
+        float dy = yi - d.py[j];
+        float dz = zi - d.pz[j];
+        float r2 = dx * dx + dy * dy + dz * dz;
+        if (r2 < d.h2)
+        {
+            float z = 1 - r2 * inv_h2;
+            float q = sqrtf(r2) / d.h;
+            voisins_h[m] = j;
+            gd[m] = 24 * d.c * z * z;
+            gp[m] = 30 * d.c * (1 - q) * (1 - q) / q;
+            m++;
+        }
+    }
+    return m;
+}
+
+/**
+ * Noyau des forces scalaire.
+ */
+static int force_scalaire(int i, const int *voisins, int n, const DonneesForce &d,
+                          int *voisins_h, float *tx, float *ty, float *tz)
+{
+    float xi = d.px[i], yi = d.py[i], zi = d.pz[i];
+    int m = 0;
+
+    for (int k = 0; k < n; ++k)
+    {
+        int j = voisins[k];
+        float dx = xi - d.px[j];
+        float dy = yi - d.py[j];
+        float dz = zi - d.pz[j];
+        if (dx * dx + dy * dy + dz * dz < d.h2)
+        {
+            voisins_h[m] = j;
+            force_paire(i, j, d, tx[m], ty[m], tz[m]);
+            m++;
+        }
+    }
+    return m;
+}
+
+
+#ifdef NOYAUX_X86
+
+/**
+ * Nombre de candidats en dessous duquel les noyaux des forces vectoriels appellent la version scalaire :
+ * les listes de voisins du pas ne contiennent que quelques voisins par particule (3 en moyenne a
+ * l espacement initial h / 1.4), un lot presque vide coute plus cher en gathers que la boucle scalaire.
+ */
+static const int SEUIL_AVX2 = 4;
+static const int SEUIL_AVX512 = 8;
+
+/*************************************************************************/
+/* Version AVX2 : 8 paires par instruction                               */
+/*************************************************************************/
+
+/**
+ * Carres des distances entre i et 8 voisins d indices idx.
+ */
+__attribute__((target("avx2,fma"))) static inline __m256
+distance2_avx2(__m256i idx, __m256 xi, __m256 yi, __m256 zi,
+               const float *px, const float *py, const float *pz)
+{
+    __m256 dx = _mm256_sub_ps(xi, _mm256_i32gather_ps(px, idx, 4));
+    __m256 dy = _mm256_sub_ps(yi, _mm256_i32gather_ps(py, idx, 4));
+    __m256 dz = _mm256_sub_ps(zi, _mm256_i32gather_ps(pz, idx, 4));
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+}
+
+/**
+ * Chargement de 8 indices a partir de k (lot complete avec l indice i au dela de n).
+ */
+__attribute__((target("avx2,fma"))) static inline __m256i
+charge_indices_avx2(const int *voisins, int k, int n, int i)
+{
+    if (k + 8 <= n)
+        return _mm256_loadu_si256((const __m256i *)(voisins + k));
+
+    int idx[8];
+    for (int l = 0; l < 8; ++l)
+        idx[l] = (k + l < n) ? voisins[k + l] : i;
+    return _mm256_loadu_si256((const __m256i *)idx);
+}
+
+/**
+ * Noyau de densite AVX2.
+ */
+__attribute__((target("avx2,fma"))) static int
+densite_avx2(int i, const int *voisins, int n, const DonneesDensite &d, int *voisins_h, float *w)
+{
+    __m256 xi = _mm256_set1_ps(d.px[i]);
+    __m256 yi = _mm256_set1_ps(d.py[i]);
+    __m256 zi = _mm256_set1_ps(d.pz[i]);
+    __m256 h2 = _mm256_set1_ps(d.h2);
+    __m256 c = _mm256_set1_ps(d.c);
+    int m = 0;
+
+    for (int k = 0; k < n; k += 8)
+    {
+        __m256i idx = charge_indices_avx2(voisins, k, n, i);
+        __m256 r2 = distance2_avx2(idx, xi, yi, zi, d.px, d.py, d.pz);
+        int dans = _mm256_movemask_ps(_mm256_cmp_ps(r2, h2, _CMP_LT_OQ));
+        if (k + 8 > n)
+            dans &= (1 << (n - k)) - 1;
+        if (dans == 0)
+            continue;
+
+        __m256 z = _mm256_sub_ps(h2, r2);
+        float res[8];
+        _mm256_storeu_ps(res, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(c, z), z), z));
+
+        // Compaction des voisins retenus
+        for (; dans != 0; dans &= dans - 1)
+        {
+            int l = __builtin_ctz(dans);
+            voisins_h[m] = voisins[k + l];
+            w[m] = res[l];
+            m++;
+        }
+    }
+    return m;
+}
+
+/**
+ * Noyau des forces AVX2 : filtrage et calcul des termes dans le meme lot de 8 candidats
+ * (les positions lues pour le filtrage servent au calcul), compaction des voisins retenus.
+ */
+__attribute__((target("avx2,fma"))) static int
+force_avx2(int i, const int *voisins, int n, const DonneesForce &d,
+           int *voisins_h, float *tx, float *ty, float *tz)
+{
+    if (n < SEUIL_AVX2)
+        return force_scalaire(i, voisins, n, d, voisins_h, tx, ty, tz);
+
+    __m256 xi = _mm256_set1_ps(d.px[i]), yi = _mm256_set1_ps(d.py[i]), zi = _mm256_set1_ps(d.pz[i]);
+    __m256 vxi = _mm256_set1_ps(d.vx[i]), vyi = _mm256_set1_ps(d.vy[i]), vzi = _mm256_set1_ps(d.vz[i]);
+    __m256 pressi = _mm256_set1_ps(d.press[i]);
+    __m256 h2 = _mm256_set1_ps(d.h2);
+    __m256 inv_h = _mm256_set1_ps(1 / d.h);
+    __m256 c_i = _mm256_set1_ps(d.c / d.rho[i]);
+    __m256 c_press = _mm256_set1_ps(d.c_press);
+    __m256 c_mu = _mm256_set1_ps(d.c_mu);
+    __m256 un = _mm256_set1_ps(1.f);
+    __m256 zero = _mm256_setzero_ps();
+    int m = 0;
+
+    for (int k = 0; k < n; k += 8)
+    {
+        __m256i idx = charge_indices_avx2(voisins, k, n, i);
+        __m256 dx = _mm256_sub_ps(xi, _mm256_i32gather_ps(d.px, idx, 4));
+        __m256 dy = _mm256_sub_ps(yi, _mm256_i32gather_ps(d.py, idx, 4));
+        __m256 dz = _mm256_sub_ps(zi, _mm256_i32gather_ps(d.pz, idx, 4));
+        __m256 r2 = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+        __m256 dedans = _mm256_cmp_ps(r2, h2, _CMP_LT_OQ);
+        int dans = _mm256_movemask_ps(dedans);
+        if (k + 8 > n)
+            dans &= (1 << (n - k)) - 1;
+        if (dans == 0)
+            continue;
+
+        // Lanes hors du rayon (dont i lui-meme en fin de lot) : rho_j = 1 et q = 1, termes finis et ignores
+        __m256 rhoj = _mm256_mask_i32gather_ps(un, d.rho, idx, dedans, 4);
+        __m256 pressj = _mm256_mask_i32gather_ps(zero, d.press, idx, dedans, 4);
+        __m256 q = _mm256_blendv_ps(un, _mm256_mul_ps(_mm256_sqrt_ps(r2), inv_h), dedans);
+        __m256 u = _mm256_sub_ps(un, q);
+        __m256 tmp0 = _mm256_div_ps(_mm256_mul_ps(c_i, u), rhoj);
+        __m256 press = _mm256_div_ps(_mm256_mul_ps(_mm256_mul_ps(tmp0, c_press), _mm256_mul_ps(_mm256_add_ps(pressi, pressj), u)), q);
+        __m256 visc = _mm256_mul_ps(tmp0, c_mu);
+
+        __m256 vdx = _mm256_sub_ps(vxi, _mm256_mask_i32gather_ps(zero, d.vx, idx, dedans, 4));
+        __m256 vdy = _mm256_sub_ps(vyi, _mm256_mask_i32gather_ps(zero, d.vy, idx, dedans, 4));
+        __m256 vdz = _mm256_sub_ps(vzi, _mm256_mask_i32gather_ps(zero, d.vz, idx, dedans, 4));
+
+        float res_x[8], res_y[8], res_z[8];
+        _mm256_storeu_ps(res_x, _mm256_fmadd_ps(visc, vdx, _mm256_mul_ps(press, dx)));
+        _mm256_storeu_ps(res_y, _mm256_fmadd_ps(visc, vdy, _mm256_mul_ps(press, dy)));
+        _mm256_storeu_ps(res_z, _mm256_fmadd_ps(visc, vdz, _mm256_mul_ps(press, dz)));
+
+        // Compaction des voisins retenus
+        for (; dans != 0; dans &= dans - 1)
+        {
+            int l = __builtin_ctz(dans);
+            voisins_h[m] = voisins[k + l];
+            tx[m] = res_x[l];
+            ty[m] = res_y[l];
+            tz[m] = res_z[l];
+            m++;
+        }
+    }
+    return m;
+}
+
+
+/*************************************************************************/
+/* Version AVX-512 : 16 paires par instruction                           */
+/*************************************************************************/
+
+/**
+ * Masque des lanes valides du lot commencant en k (sur n elements).
+ */
+static inline __mmask16 masque_lot(int k, int n)
+{
+    return (n - k >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - k)) - 1);
+}
+
+/**
+ * Noyau de densite AVX-512 (compaction des voisins retenus par compress).
+ */
+__attribute__((target("avx512f"))) static int
+densite_avx512(int i, const int *voisins, int n, const DonneesDensite &d, int *voisins_h, float *w)
+{
+    __m512 xi = _mm512_set1_ps(d.px[i]);
+    __m512 yi = _mm512_set1_ps(d.py[i]);
+    __m512 zi = _mm512_set1_ps(d.pz[i]);
+    __m512 h2 = _mm512_set1_ps(d.h2);
+    __m512 c = _mm512_set1_ps(d.c);
+    __m512 zero = _mm512_setzero_ps();
+    int m = 0;
+
+    for (int k = 0; k < n; k += 16)
+    {
+        __mmask16 lot = masque_lot(k, n);
+        __m512i idx = _mm512_maskz_loadu_epi32(lot, voisins + k);
+
+        __m512 dx = _mm512_sub_ps(xi, _mm512_mask_i32gather_ps(zero, lot, idx, d.px, 4));
+        __m512 dy = _mm512_sub_ps(yi, _mm512_mask_i32gather_ps(zero, lot, idx, d.py, 4));
+        __m512 dz = _mm512_sub_ps(zi, _mm512_mask_i32gather_ps(zero, lot, idx, d.pz, 4));
+        __m512 r2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz));
+        __mmask16 dans = _mm512_mask_cmp_ps_mask(lot, r2, h2, _CMP_LT_OQ);
+        if (dans == 0)
+            continue;
+
+        __m512 z = _mm512_sub_ps(h2, r2);
+        __m512 res = _mm512_mul_ps(_mm512_mul_ps(_mm512_mul_ps(c, z), z), z);
+
+        int nb = __builtin_popcount(dans);
+        __mmask16 sortie = masque_lot(0, nb);
+        _mm512_mask_storeu_epi32(voisins_h + m, sortie, _mm512_maskz_compress_epi32(dans, idx));
+        _mm512_mask_storeu_ps(w + m, sortie, _mm512_maskz_compress_ps(dans, res));
+        m += nb;
+    }
+    return m;
+}
+
+/**
+ * Noyau des forces AVX-512 : filtrage et calcul des termes dans le meme lot de 16 candidats
+ * (gathers masques sur les voisins retenus), compaction des resultats par compress.
+ */
+__attribute__((target("avx512f"))) static int
+force_avx512(int i, const int *voisins, int n, const DonneesForce &d,
+             int *voisins_h, float *tx, float *ty, float *tz)
+{
+    if (n < SEUIL_AVX512)
+        return force_scalaire(i, voisins, n, d, voisins_h, tx, ty, tz);
+
+    __m512 xi = _mm512_set1_ps(d.px[i]), yi = _mm512_set1_ps(d.py[i]), zi = _mm512_set1_ps(d.pz[i]);
+    __m512 vxi = _mm512_set1_ps(d.vx[i]), vyi = _mm512_set1_ps(d.vy[i]), vzi = _mm512_set1_ps(d.vz[i]);
+    __m512 pressi = _mm512_set1_ps(d.press[i]);
+    __m512 h2 = _mm512_set1_ps(d.h2);
+    __m512 inv_h = _mm512_set1_ps(1 / d.h);
+    __m512 c_i = _mm512_set1_ps(d.c / d.rho[i]);
+    __m512 c_press = _mm512_set1_ps(d.c_press);
+    __m512 c_mu = _mm512_set1_ps(d.c_mu);
+    __m512 un = _mm512_set1_ps(1.f);
+    __m512 zero = _mm512_setzero_ps();
+    int m = 0;
+
+    for (int k = 0; k < n; k += 16)
+    {
+        __mmask16 lot = masque_lot(k, n);
+        __m512i idx = _mm512_maskz_loadu_epi32(lot, voisins + k);
+
+        __m512 dx = _mm512_sub_ps(xi, _mm512_mask_i32gather_ps(zero, lot, idx, d.px, 4));
+        __m512 dy = _mm512_sub_ps(yi, _mm512_mask_i32gather_ps(zero, lot, idx, d.py, 4));
+        __m512 dz = _mm512_sub_ps(zi, _mm512_mask_i32gather_ps(zero, lot, idx, d.pz, 4));
+        __m512 r2 = _mm512_fmadd_ps(dz, dz, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx)));
+        __mmask16 dans = _mm512_mask_cmp_ps_mask(lot, r2, h2, _CMP_LT_OQ);
+        if (dans == 0)
+            continue;
+
+        // Lanes hors du rayon : rho_j = 1 et q = 1, termes finis et ignores par la compaction
+        __m512 rhoj = _mm512_mask_i32gather_ps(un, dans, idx, d.rho, 4);
+        __m512 pressj = _mm512_mask_i32gather_ps(zero, dans, idx, d.press, 4);
+        __m512 q = _mm512_mask_mul_ps(un, dans, _mm512_maskz_sqrt_ps(dans, r2), inv_h);
+        __m512 u = _mm512_sub_ps(un, q);
+        __m512 tmp0 = _mm512_div_ps(_mm512_mul_ps(c_i, u), rhoj);
+        __m512 press = _mm512_div_ps(_mm512_mul_ps(_mm512_mul_ps(tmp0, c_press), _mm512_mul_ps(_mm512_add_ps(pressi, pressj), u)), q);
+        __m512 visc = _mm512_mul_ps(tmp0, c_mu);
+
+        __m512 vdx = _mm512_sub_ps(vxi, _mm512_mask_i32gather_ps(zero, dans, idx, d.vx, 4));
+        __m512 vdy = _mm512_sub_ps(vyi, _mm512_mask_i32gather_ps(zero, dans, idx, d.vy, 4));
+        __m512 vdz = _mm512_sub_ps(vzi, _mm512_mask_i32gather_ps(zero, dans, idx, d.vz, 4));
+
+        // Compaction en registre puis ecriture des seules lanes retenues
+        int nb = __builtin_popcount(dans);
+        __mmask16 sortie = masque_lot(0, nb);
+        _mm512_mask_storeu_epi32(voisins_h + m, sortie, _mm512_maskz_compress_epi32(dans, idx));
+        _mm512_mask_storeu_ps(tx + m, sortie, _mm512_maskz_compress_ps(dans, _mm512_fmadd_ps(visc, vdx, _mm512_mul_ps(press, dx))));
+        _mm512_mask_storeu_ps(ty + m, sortie, _mm512_maskz_compress_ps(dans, _mm512_fmadd_ps(visc, vdy, _mm512_mul_ps(press, dy))));
+        _mm512_mask_storeu_ps(tz + m, sortie, _mm512_maskz_compress_ps(dans, _mm512_fmadd_ps(visc, vdz, _mm512_mul_ps(press, dz))));
+        m += nb;
+    }
+    return m;
+}
+
+#endif
+
+
+/*************************************************************************/
+/* Versions specialisees par jeu de noyaux de lissage                    */
+/*************************************************************************/
+
+/**
+ * Filtrage des candidats a distance r < rayon : indices retenus dans voisins_h, carres des distances
+ * dans r2 (tableaux de n elements) ; renvoie le nombre de voisins retenus.
+ */
+static inline int filtre_voisins(int i, const int *voisins, int n, const float *px, const float *py,
+                                 const float *pz, float rayon2, int *voisins_h, float *r2)
+{
+    float xi = px[i], yi = py[i], zi = pz[i];
+
+    // Distances de tous les candidats (boucle vectorisable), puis compaction en place
+#pragma omp simd
+    for (int k = 0; k < n; ++k)
+    {
+        int j = voisins[k];
+        float dx = xi - px[j], dy = yi - py[j], dz = zi - pz[j];
+        r2[k] = dx * dx + dy * dy + dz * dz;
+    }
+
+    int m = 0;
+    for (int k = 0; k < n; ++k)
+        if (r2[k] < rayon2)
+        {
+            voisins_h[m] = voisins[k];
+            r2[m] = r2[k];
+            m++;
+        }
+    return m;
+}
+
+/**
+ * Noyau de densite du jeu J : w[l] = m W_J(r) pour les voisins retenus.
+ */
+template <class J>
+static int densite_lissage(int i, const int *voisins, int n, const DonneesDensite &d, int *voisins_h, float *w)
+{
+    int m = filtre_voisins(i, voisins, n, d.px, d.py, d.pz, d.h2, voisins_h, w);
+    const ConstantesNoyau k = d.noyau;
+    const float c = d.c;
+
+#pragma omp simd
+    for (int l = 0; l < m; ++l)
+        w[l] = c * J::Densite::W(w[l], k);
+    return m;
+}
+
+/**
+ * Noyau des forces du jeu J : terme de paire
+ *  m / (rho_i rho_j) (-1/2 (p_i + p_j) grad W_G(r) - visco laplacien W_L(r) (v_i - v_j)).
+ */
+template <class J>
+static int force_lissage(int i, const int *voisins, int n, const DonneesForce &d,
+                         int *voisins_h, float *tx, float *ty, float *tz)
+{
+    int m = filtre_voisins(i, voisins, n, d.px, d.py, d.pz, d.h2, voisins_h, tx);
+    const ConstantesNoyau k = d.noyau;
+    const float xi = d.px[i], yi = d.py[i], zi = d.pz[i];
+    const float vxi = d.vx[i], vyi = d.vy[i], vzi = d.vz[i];
+    const float c_i = d.c / d.rho[i], press_i = d.press[i];
+    const float c_press = d.c_press, c_mu = d.c_mu;
+
+#pragma omp simd
+    for (int l = 0; l < m; ++l)
+    {
+        int j = voisins_h[l];
+        float r2 = tx[l];
+        float tmp0 = c_i / d.rho[j];
+        float press = tmp0 * c_press * (press_i + d.press[j]) * J::Gradient::GradientSurR(r2, k);
+        float visc = tmp0 * c_mu * J::Laplacien::Laplacien(r2, k);
+        tx[l] = press * (xi - d.px[j]) + visc * (vxi - d.vx[j]);
+        ty[l] = press * (yi - d.py[j]) + visc * (vyi - d.vy[j]);
+        tz[l] = press * (zi - d.pz[j]) + visc * (vzi - d.vz[j]);
+    }
+    return m;
+}
+
+/**
+ * Noyau des gradients du jeu J : gd = -m g_D(r), gp = -m g_G(r), ou grad W(r) = g(r) r.
+ */
+template <class J>
+static int gradients_lissage(int i, const int *voisins, int n, const DonneesForce &d,
+                             int *voisins_h, float *gd, float *gp)
+{
+    int m = filtre_voisins(i, voisins, n, d.px, d.py, d.pz, d.h2, voisins_h, gd);
+    const ConstantesNoyau k = d.noyau;
+    const float c = d.c;
+
+#pragma omp simd
+    for (int l = 0; l < m; ++l)
+    {
+        float r2 = gd[l];
+        gd[l] = -c * J::Densite::GradientSurR(r2, k);
+        gp[l] = -c * J::Gradient::GradientSurR(r2, k);
+    }
+    return m;
+}
+
+/**
+ * Noyaux du jeu J et constantes pour le rayon h.
+ */
+template <class J>
+static ConstantesNoyau constantes_lissage(float h)
+{
+    return J::Constantes(h);
+}
+
+static const NoyauxSPH NOYAUX_POLY6 = {"poly6", 1, densite_lissage<JeuPoly6>, force_lissage<JeuPoly6>,
+                                       gradients_lissage<JeuPoly6>, constantes_lissage<JeuPoly6>};
+static const NoyauxSPH NOYAUX_SPLINE_CUBIQUE = {"spline_cubique", 1, densite_lissage<JeuSplineCubique>,
+                                                force_lissage<JeuSplineCubique>, gradients_lissage<JeuSplineCubique>,
+                                                constantes_lissage<JeuSplineCubique>};
+static const NoyauxSPH NOYAUX_WENDLAND_C2 = {"wendland_c2", 1, densite_lissage<JeuWendlandC2>,
+                                            force_lissage<JeuWendlandC2>, gradients_lissage<JeuWendlandC2>,
+                                            constantes_lissage<JeuWendlandC2>};
+static const NoyauxSPH NOYAUX_WENDLAND_C4 = {"wendland_c4", 1, densite_lissage<JeuWendlandC4>,
+                                            force_lissage<JeuWendlandC4>, gradients_lissage<JeuWendlandC4>,
+                                            constantes_lissage<JeuWendlandC4>};
+
+/**
+ * Choix des noyaux specialises d un jeu de noyaux de lissage.
+ */
+const NoyauxSPH *ChoixNoyauxLissage(const std::string &jeu)
+{
+    if (jeu == "poly6")
+        return &NOYAUX_POLY6;
+    if (jeu == "spline_cubique")
+        return &NOYAUX_SPLINE_CUBIQUE;
+    if (jeu == "wendland_c2")
+        return &NOYAUX_WENDLAND_C2;
+    if (jeu == "wendland_c4")
+        return &NOYAUX_WENDLAND_C4;
+    return NULL;
+}
+
+
+/*************************************************************************/
+/* Choix de la version a l execution                                     */
+/*************************************************************************/
+
+static const NoyauxSPH NOYAUX_SCALAIRE = {"scalaire", 1, densite_scalaire, force_scalaire, gradients_origine, NULL};
+
+#ifdef NOYAUX_X86
+static const NoyauxSPH NOYAUX_AVX2 = {"avx2", 8, densite_avx2, force_avx2, gradients_origine, NULL};
+static const NoyauxSPH NOYAUX_AVX512 = {"avx512", 16, densite_avx512, force_avx512, gradients_origine, NULL};
+#endif
+
+/**
+ * Choix des noyaux selon le processeur.
+ * "auto" prend la version la plus large supportee ; une version demandee mais non supportee
+ * est remplacee par la meilleure version disponible en dessous.
+ */
+const NoyauxSPH &ChoixNoyauxSPH(const std::string &choix)
+{
+#ifdef NOYAUX_X86
+    __builtin_cpu_init();
+    bool avx512 = __builtin_cpu_supports("avx512f");
+    bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+    if ((choix == "auto" || choix == "avx512") && avx512)
+        return NOYAUX_AVX512;
+    if ((choix == "auto" || choix == "avx512" || choix == "avx2") && avx2)
+        return NOYAUX_AVX2;
+#endif
+
+    return NOYAUX_SCALAIRE;
+}
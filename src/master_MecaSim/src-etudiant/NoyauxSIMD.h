@@ -0,0 +1,127 @@
+/** \file NoyauxSIMD.h
+ \brief Noyaux de calcul SPH par paires (densite, forces) en versions scalaire, AVX2 et AVX-512,
+ avec choix de la version a l execution selon le processeur, et versions specialisees par jeu de
+ noyaux de lissage (NoyauxLissage.h).
+ */
+
+#ifndef NOYAUX_SIMD_H
+#define NOYAUX_SIMD_H
+
+
+/** Librairies de base **/
+#include <string>
+
+#include "NoyauxLissage.h"
+
+
+/**
+ * \brief Donnees lues par le noyau de densite.
+ */
+struct DonneesDensite
+{
+    /// Positions (structure de tableaux)
+    const float *px, *py, *pz;
+
+    /// Carre du rayon du noyau
+    float h2;
+
+    /// Constante du noyau : 4m / (pi h^8), ou la masse m avec un jeu de noyaux de lissage
+    float c;
+
+    /// Constantes du jeu de noyaux de lissage pour le rayon h
+    ConstantesNoyau noyau;
+};
+
+
+/**
+ * \brief Donnees lues par le noyau des forces d interaction.
+ */
+struct DonneesForce
+{
+    /// Positions (structure de tableaux)
+    const float *px, *py, *pz;
+
+    /// Vitesses (structure de tableaux)
+    const float *vx, *vy, *vz;
+
+    /// Densites
+    const float *rho;
+
+    /// Pressions (equation d etat)
+    const float *press;
+
+    /// Rayon du noyau et son carre
+    float h, h2;
+
+    /// Constantes : m / (pi h^4), 15, -40 visco ; avec un jeu de noyaux de lissage, m, -1/2, -visco
+    float c, c_press, c_mu;
+
+    /// Constantes du jeu de noyaux de lissage pour le rayon h
+    ConstantesNoyau noyau;
+};
+
+
+/**
+ * Noyau de densite : pour la particule i et ses n candidats voisins[k],
+ * ne garde que les m candidats a distance r < h (renvoie m) :
+ * voisins_h[l] est l indice du voisin et w[l] = c (h^2 - r^2)^3 sa contribution.
+ */
+typedef int (*FonctionNoyauDensite)(int i, const int *voisins, int n, const DonneesDensite &d,
+                                    int *voisins_h, float *w);
+
+/**
+ * Noyau des forces : pour la particule i et ses n candidats voisins[k],
+ * ne garde que les m candidats a distance r < h (renvoie m) :
+ * voisins_h[l] est l indice du voisin et (tx, ty, tz)[l] le terme de pression + viscosite de la paire.
+ * Les termes couteux (racine, divisions) ne sont calcules que pour les lots de candidats contenant
+ * des voisins retenus ; les listes courtes sont traitees par la boucle scalaire.
+ */
+typedef int (*FonctionNoyauForce)(int i, const int *voisins, int n, const DonneesForce &d,
+                                  int *voisins_h, float *tx, float *ty, float *tz);
+
+/**
+ * Noyau des gradients (solveurs de pression) : pour la particule i et ses n candidats voisins[k],
+ * ne garde que les m candidats a distance r < h (renvoie m) : voisins_h[l] est l indice du voisin,
+ * m grad W(r) = -gd[l] r pour le noyau de densite et -gp[l] r pour le noyau du gradient des pressions
+ * (terme de pression de la paire du noyau des forces : gp (p_i + p_j) / (2 rho_i rho_j) r).
+ * Seuls les positions, h, h2, c et les constantes du jeu de noyaux de d sont lus.
+ */
+typedef int (*FonctionNoyauGradients)(int i, const int *voisins, int n, const DonneesForce &d,
+                                      int *voisins_h, float *gd, float *gp);
+
+
+/**
+ * \brief Jeu de noyaux pour un jeu d instructions donne.
+ */
+struct NoyauxSPH
+{
+    /// Nom de la version (scalaire, avx2, avx512)
+    const char *nom;
+
+    /// Nombre de paires traitees par instruction
+    int largeur;
+
+    /// Noyau de densite
+    FonctionNoyauDensite densite;
+
+    /// Noyau des forces
+    FonctionNoyauForce force;
+
+    /// Noyau des gradients (densite et pressions) des solveurs de pression
+    FonctionNoyauGradients gradients;
+
+    /// Constantes du jeu de noyaux de lissage pour un rayon h (NULL pour les noyaux d origine,
+    /// dont les constantes sont calculees par les passes)
+    ConstantesNoyau (*constantes)(float h);
+};
+
+
+/*! Choix des noyaux : "auto" (meilleure version supportee par le processeur), "scalaire", "avx2" ou "avx512" */
+const NoyauxSPH &ChoixNoyauxSPH(const std::string &choix = "auto");
+
+/*! Noyaux specialises pour un jeu de noyaux de lissage : "poly6", "spline_cubique", "wendland_c2" ou
+    "wendland_c4" ; NULL pour un autre nom */
+const NoyauxSPH *ChoixNoyauxLissage(const std::string &jeu);
+
+
+#endif
@@ -31,16 +31,14 @@
 #include <math.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 
 // Fichiers de master_meca_sim
 #include "Noeuds.h"
 #include "ObjetSimule.h"
-#include "Viewer.h"
 
 #include "vec.h"
-#include "draw.h"
-#include "Viewer.h"
 
 
 
@@ -48,6 +46,7 @@
  * Constructeur de la class ObjetSimule.
  */
 ObjetSimule::ObjetSimule(std::string fich_param)
+    : _PeriodeTrajectoire(1), _PeriodeCleTrajectoire(32), _Trajectoire(NULL)
 {
     /** Recuperation des parametres du maillage mis dans le fichier **/
     Param_mesh(fich_param);
@@ -55,6 +54,15 @@ ObjetSimule::ObjetSimule(std::string fich_param)
 }
 
 
+/**
+ * Destructeur : les images de la trajectoire en attente et son index sont ecrits.
+ */
+ObjetSimule::~ObjetSimule()
+{
+    delete _Trajectoire;
+}
+
+
 /**
  * \brief Interaction avec l utilisateur.
  * Methode invoquee par le graphe de scene.
@@ -76,7 +84,7 @@ void ObjetSimule::Interaction(Vector MousePos)
  */
 void ObjetSimule::AffichagePos(int tps)
 {
-    /* Affichage des vecteurs par bloc */
+    /* Affichage des vecteurs par bloc, dans l ordre des identifiants persistants */
     for(int i=0; i<_Nb_Sommets; ++i)
     {
         // Affichage du temps
@@ -86,8 +94,87 @@ void ObjetSimule::AffichagePos(int tps)
         std::cout << " ; Vertex=" << i;
         
         // Affichage des coordonnees de la position
-        std::cout << " ; P=" << P[i] << std::endl;
+        std::cout << " ; P=" << _Particules.P[_Particules.Emplacement(i)] << std::endl;
         
     }//for_i
 }
 
+
+
+/**
+ * Valeurs d une grandeur (densite, norme de la vitesse) pour chaque particule,
+ * rangees par identifiant persistant comme le tableau P ; vide pour CHAMP_AUCUN.
+ */
+void ObjetSimule::ChampAffichage(ChampScalaire champ, std::vector<float> &valeurs) const
+{
+    if (champ == CHAMP_AUCUN)
+    {
+        valeurs.clear();
+        return;
+    }
+
+    int n = _Particules.size();
+    valeurs.resize(n);
+
+    for (int k = 0; k < n; ++k)
+    {
+        float v;
+        if (champ == CHAMP_DENSITE)
+            v = _Particules.rho[k];
+        else
+            v = length(_Particules.V[k]);
+        valeurs[_Particules.Id[k]] = v;
+    }
+}
+
+
+/**
+ * Bornes du domaine : boite englobante des particules (domaine de quantification de la trajectoire).
+ */
+void ObjetSimule::Domaine(Vector &pmin, Vector &pmax) const
+{
+    int n = _Particules.size();
+    if (n == 0)
+    {
+        pmin = pmax = Vector(0, 0, 0);
+        return;
+    }
+
+    pmin = pmax = _Particules.P[0];
+    for (int k = 1; k < n; ++k)
+    {
+        Vector p = _Particules.P[k];
+        pmin = Vector(std::min(pmin.x, p.x), std::min(pmin.y, p.y), std::min(pmin.z, p.z));
+        pmax = Vector(std::max(pmax.x, p.x), std::max(pmax.y, p.y), std::max(pmax.z, p.z));
+    }
+}
+
+
+/**
+ * Ajout des positions (dans l ordre des identifiants) a la trajectoire ; le fichier est cree
+ * a la premiere image, quand le nombre de particules et le domaine sont connus.
+ * L ecriture a lieu dans le thread de la trajectoire.
+ */
+void ObjetSimule::EnregistreTrajectoire(int tps, float temps)
+{
+    if (_Fich_Trajectoire.empty() || tps % _PeriodeTrajectoire != 0)
+        return;
+
+    if (_Trajectoire == NULL)
+    {
+        Vector pmin, pmax;
+        Domaine(pmin, pmax);
+
+        _Trajectoire = new EcritureTrajectoire();
+        _Trajectoire->Ouvre(_Fich_Trajectoire, _Particules.size(), pmin, pmax,
+                            _PeriodeTrajectoire, _PeriodeCleTrajectoire);
+    }
+
+    int n = _Particules.size();
+    _PositionsTrajectoire.resize(n);
+    for (int k = 0; k < n; ++k)
+        _PositionsTrajectoire[_Particules.Id[k]] = _Particules.P[k];
+
+    _Trajectoire->Ajoute(tps, temps, _PositionsTrajectoire);
+}
+
@@ -14,11 +14,12 @@
 
 // Fichiers de gkit2light
 #include "vec.h"
-#include "mesh.h"
 
 // Fichiers de master_meca_sim
 #include "Noeuds.h"
 #include "Properties.h"
+#include "ParticleStore.h"
+#include "Trajectoire.h"
 
 /**
  * \brief Texture determinee par valeurs a et b.
@@ -48,6 +49,18 @@ struct FacetTriangle
     int fk;
 };
 
+/**
+ * \brief Grandeur scalaire des particules utilisable pour l affichage (coloration).
+ */
+enum ChampScalaire
+{
+    CHAMP_AUCUN = 0,    //!< pas de grandeur (couleur unie)
+    CHAMP_DENSITE,      //!< densite
+    CHAMP_VITESSE,      //!< norme de la vitesse
+    NB_CHAMPS
+};
+
+
 /**
  * \brief Structure de donnees de base des objets simules.
  */
@@ -57,6 +70,9 @@ public:
     /*! Constructeur */
     ObjetSimule(std::string fich_param);
 
+    /*! Destructeur : fermeture de la trajectoire */
+    virtual ~ObjetSimule();
+
     /*! Lecture des parametres lies au maillage */
     void Param_mesh(std::string fich_param);
 
@@ -81,6 +97,20 @@ public:
     /*! Affichage des positions de chaque sommet */
     void AffichagePos(int tps);
 
+    /*! Valeurs d une grandeur pour chaque particule, dans l ordre des identifiants (comme P) */
+    void ChampAffichage(ChampScalaire champ, std::vector<float> &valeurs) const;
+
+    /*! Bornes du domaine de l objet (boite englobante des particules par defaut) */
+    virtual void Domaine(Vector &pmin, Vector &pmax) const;
+
+    /*! Ajout des positions a la trajectoire, toutes les _PeriodeTrajectoire iterations */
+    void EnregistreTrajectoire(int tps, float temps);
+
+    /// Etats des particules (positions, vitesses, accelerations, forces, masses, densites)
+    /// en structure de tableaux alignes.
+    /// Le tableau P du Noeud n est qu une copie des positions pour l affichage (cf updateVertex).
+    ParticleStore _Particules;
+
 protected:
     /// Fichier de donnees contenant les points
     std::string _Fich_Points;
@@ -91,23 +121,20 @@ protected:
     /// Interaction avec l utilisateur ou non
     std::string _Interaction;
 
-    /// valeur d'absorption de la vitesse en cas de collision:
-    /// 1=la particule repart aussi vite, 0=elle s'arrete
-    float _Friction = 1.0f;
-
-    /// Declaration du tableau des vitesses
-    std::vector<Vector> V;
+    /// Fichier de trajectoire (vide : pas d enregistrement)
+    std::string _Fich_Trajectoire;
 
-    /// Declaration du tableau des accelerations
-    std::vector<Vector> A;
+    /// Iterations entre deux images de la trajectoire, images entre deux images cles
+    int _PeriodeTrajectoire;
+    int _PeriodeCleTrajectoire;
 
-    /// Declaration du tableau des forces
-    std::vector<Vector> Force;
+    /// Ecriture de la trajectoire (creee a la premiere image) et positions par identifiant
+    EcritureTrajectoire *_Trajectoire;
+    std::vector<Vector> _PositionsTrajectoire;
 
-    /// Declaration du tableau des masses
-    std::vector<float> M;
-
-    std::vector<Vector> Vprec;
+    /// valeur d'absorption de la vitesse en cas de collision:
+    /// 1=la particule repart aussi vite, 0=elle s'arrete
+    float _Friction = 1.0f;
 };
 
 #endif
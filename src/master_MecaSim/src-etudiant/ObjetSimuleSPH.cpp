@@ -31,28 +31,38 @@
 #include <math.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 // Fichiers de master_meca_sim
 #include "Noeuds.h"
 #include "ObjetSimule.h"
 #include "ObjetSimuleSPH.h"
-#include "Viewer.h"
+#include "TriMorton.h"
+#include "Profilage.h"
 
 #include "vec.h"
-#include "draw.h"
-#include "Viewer.h"
 
 /**
  * Constructeur de la class ObjetSimuleSPH.
  */
 ObjetSimuleSPH::ObjetSimuleSPH(std::string fich_param)
-    : ObjetSimule(fich_param)
+    : ObjetSimule(fich_param), _ModePression(PRESSION_EQUATION_ETAT), _CoefPCISPH(0), _ProchainTri(0), _VerletValide(false),
+      _NbReconstructions(0), _Pas(0), _Temps(0), _TypeFrontiere(FRONTIERE_OBSTACLE), _EchelleFrontiere(1),
+      _TranslationFrontiere(0, 0, 0), _EchelleCollision(1), _TranslationCollision(0, 0, 0)
 {
 
     /** Recuperation des parametres de la methode sph mis dans le fichier **/
     Param_sph(fich_param);
 }
 
+/**
+ * Destructeur.
+ */
+ObjetSimuleSPH::~ObjetSimuleSPH()
+{
+    delete _SolveurExpl;
+}
+
 /**
  * Pour creer particules a l interieur d une boite englobant le fluide.
  */
@@ -66,6 +76,10 @@ int box_indicator(float x, float y, float z)
  */
 void ObjetSimuleSPH::initObjetSimule()
 {
+    /* Frontiere de forme quelconque et maillage de collision */
+    initFrontiere();
+    initMaillageCollision();
+    
     /* Initialisation des etats des particules */
     float hh = h /1.4;
 
@@ -85,13 +99,7 @@ void ObjetSimuleSPH::initObjetSimule()
                 if (box_indicator(x, y, z))
                 {
                     // Initialisation de ses donnees
-                    P.push_back(Vector(x, y, z));
-                    V.push_back(Vector(0.0, 0.0, 0.0));
-                    Vprec.push_back(Vector(0.0, 0.0, 0.0));
-                    A.push_back(Vector(0.0, 0.0, 0.0));
-                    Force.push_back(Vector(0.0, 0.0, 0.0));
-                    rho.push_back(0.0);
-                    M.push_back(1);
+                    _Particules.push_back(Vector(x, y, z), 1);
 
                     // Compte les points qui tombent dans la région indiquee
                     ++_Nb_Sommets;
@@ -100,7 +108,19 @@ void ObjetSimuleSPH::initObjetSimule()
         }
     }
 
+    initEtatParticules();
+}
+
+/**
+ * Initialisation de l etat des particules creees (positions dans _Particules, masses egales a 1) :
+ * densites, masses telles que la densite moyenne soit rho0, puis premier pas du schema d integration.
+ */
+void ObjetSimuleSPH::initEtatParticules()
+{
     /* Calcul de la densite */
+    InitNoyaux();
+    PreparationVoisins(0);
+    Reinitialisation();
     CalculDensite();
 
     /* Initialisation des masses */
@@ -108,6 +128,8 @@ void ObjetSimuleSPH::initObjetSimule()
     // en considerant que toutes les particules ont une masse egale a 1
     float rho2s = 0;
     float rhos = 0;
+    TableauAligne &rho = _Particules.rho;
+    TableauAligne &M = _Particules.M;
 
     for (int i = 0; i < _Nb_Sommets; ++i)
     {
@@ -119,11 +141,82 @@ void ObjetSimuleSPH::initObjetSimule()
     for (int i = 0; i < _Nb_Sommets; ++i)
         M[i] *= (rho0 * rhos / rho2s);
 
-    _SolveurExpl->CalculPremierPas(_Nb_Sommets, A, V, Vprec, P);
+    // Coefficient de PCISPH pour les masses calculees
+    InitNoyaux();
+
+    _SolveurExpl->CalculPremierPas(_Nb_Sommets, _Particules);
+
+    /* Positions pour l affichage */
+    updateVertex();
+
     /** Message pour la fin de la creation du maillage **/
     std::cout << "SPH build ..." << std::endl;
 }
 
+/**
+ * Constantes du jeu de noyaux de lissage, calculees une fois pour le rayon h
+ * (a la creation des particules et a la reprise) ; rien avec les noyaux d origine.
+ * Avec PCISPH, coefficient de correction des pressions pour h, rho0 et la masse des particules
+ * (calcul par dichotomie sur un reseau de reference, hors des pas de temps).
+ */
+void ObjetSimuleSPH::InitNoyaux()
+{
+    if (_Noyaux->constantes != NULL)
+        _ConstantesNoyau = _Noyaux->constantes(h);
+
+    if (_ModePression == PRESSION_PCISPH && _Nb_Sommets > 0)
+        _CoefPCISPH = CoefPCISPH();
+}
+
+/**
+ * Frontiere de forme quelconque : lecture du maillage, transformation (echelle puis translation)
+ * et construction du champ de distance, avec une marge de deux cellules autour du maillage.
+ */
+void ObjetSimuleSPH::initFrontiere()
+{
+    _SommetsFrontiere.clear();
+    _TrianglesFrontiere.clear();
+    _Frontiere = ChampDistance();
+    
+    if (_Fich_Frontiere.empty())
+        return;
+    
+    if (!ChampDistance::LectureMaillage(_Fich_Frontiere, _SommetsFrontiere, _TrianglesFrontiere))
+    {
+        std::cout << "Frontiere : " << _Fich_Frontiere << " ignoree (maillage illisible ou vide)" << std::endl;
+        return;
+    }
+    
+    for (size_t s = 0; s < _SommetsFrontiere.size(); s++)
+        _SommetsFrontiere[s] = _SommetsFrontiere[s] * _EchelleFrontiere + _TranslationFrontiere;
+    
+    _Frontiere.Construit(_SommetsFrontiere, _TrianglesFrontiere, _PasFrontiere, 2 * _PasFrontiere, _TypeFrontiere);
+}
+
+/**
+ * Maillage de collision : lecture, transformation (echelle puis translation) et construction de la BVH.
+ */
+void ObjetSimuleSPH::initMaillageCollision()
+{
+    _SommetsCollision.clear();
+    _TrianglesCollision.clear();
+    _MaillageCollision = MaillageCollision();
+    
+    if (_Fich_Collision.empty())
+        return;
+    
+    if (!ChampDistance::LectureMaillage(_Fich_Collision, _SommetsCollision, _TrianglesCollision))
+    {
+        std::cout << "Maillage de collision : " << _Fich_Collision << " ignore (maillage illisible ou vide)" << std::endl;
+        return;
+    }
+    
+    for (size_t s = 0; s < _SommetsCollision.size(); s++)
+        _SommetsCollision[s] = _SommetsCollision[s] * _EchelleCollision + _TranslationCollision;
+    
+    _MaillageCollision.Construit(_SommetsCollision, _TrianglesCollision);
+}
+
 /**
  * Creation du maillage (pour affichage) du fluide SPH.
  */
@@ -134,37 +227,385 @@ void ObjetSimuleSPH::initMeshObjet()
 }
 
 /**
- * Mise a jour du Mesh (pour affichage) de l objet en fonction des nouvelles positions calculees.
+ * Energies des particules, pour comparer la derive des schemas d integration :
+ * cinetique 1/2 m |V|^2, potentielle de pesanteur -m g.P, et interne de l equation d etat
+ * p = bulk (rho - rho0) : e(rho) = integrale de p / rho^2 = bulk (ln(rho / rho0) + rho0 / rho - 1)
+ * par unite de masse. Les densites sont celles du dernier calcul (debut du pas).
+ */
+void ObjetSimuleSPH::Energies(const Vector &gravite, double &cinetique, double &potentielle, double &interne) const
+{
+    const float *px = _Particules.P.x.data(), *py = _Particules.P.y.data(), *pz = _Particules.P.z.data();
+    const float *vx = _Particules.V.x.data(), *vy = _Particules.V.y.data(), *vz = _Particules.V.z.data();
+    const float *m = _Particules.M.data(), *rho = _Particules.rho.data();
+    double ec = 0, ep = 0, ei = 0;
+
+#pragma omp parallel for reduction(+ : ec, ep, ei)
+    for (int i = 0; i < _Nb_Sommets; ++i)
+    {
+        ec += 0.5 * m[i] * (vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+        ep -= m[i] * (gravite.x * px[i] + gravite.y * py[i] + gravite.z * pz[i]);
+        if (rho[i] > 0)
+            ei += m[i] * bulk * (log(rho[i] / rho0) + rho0 / rho[i] - 1);
+    }
+
+    cinetique = ec;
+    potentielle = ep;
+    interne = ei;
+}
+
+/**
+ * Mise a jour des positions affichees en fonction des nouvelles positions calculees.
  */
 void ObjetSimuleSPH::updateVertex()
 {
-    // Rien car on utilise une sphere + translation par rapport aux positions P[i] des particules
-    // Pas de Mesh a mettre a jour
+    // Pas de Mesh a mettre a jour : on utilise une sphere + translation par rapport aux positions P[i] des particules
+    // Copie des positions (structure de tableaux) dans le tableau P du noeud
+    // P est indexe par identifiant persistant : l affichage ne voit pas les reordonnancements
+    P.resize(_Nb_Sommets);
+    for (int k = 0; k < _Nb_Sommets; ++k)
+        P[_Particules.Id[k]] = _Particules.P[k];
 }
 
 
+/**
+ * Preparation de la recherche des voisins pour le pas de temps Tps.
+ * Sans listes de Verlet : grille de cellules de taille h reconstruite a chaque pas,
+ * et reordonnancement de Morton periodique.
+ * Avec listes de Verlet : les listes de rayon h + skin restent valides tant qu aucune particule
+ * ne s est deplacee de plus de skin / 2 (deux particules ne peuvent alors pas s etre rapprochees
+ * de plus de skin) ; sinon la grille et les listes sont reconstruites, et le reordonnancement
+ * de Morton, qui invalide les listes, n a lieu qu a ces reconstructions.
+ */
+void ObjetSimuleSPH::PreparationVoisins(int Tps)
+{
+    if (!_Verlet)
+    {
+        _Grille.Construction(_Nb_Sommets, _Particules.P, h);
+
+        if (_PeriodeTri > 0 && Tps % _PeriodeTri == 0)
+            ReordonneParticules();
+        return;
+    }
+
+    if (_VerletValide && DeplacementMax2() <= 0.25f * _Skin * _Skin)
+        return;
+
+    _Grille.Construction(_Nb_Sommets, _Particules.P, TailleCellule());
+
+    if (_PeriodeTri > 0 && Tps >= _ProchainTri)
+    {
+        ReordonneParticules();
+        _ProchainTri = Tps + _PeriodeTri;
+    }
+
+    ConstructionListesVerlet();
+}
 
 
 /**
- * Simulation de l objet.
+ * Reordonnancement des particules selon le code de Morton de leur cellule (grille construite).
+ * Les particules proches dans l espace deviennent proches en memoire : les acces aux voisins
+ * restent dans les memes lignes de cache au fil du melange du fluide.
+ * La grille est reconstruite pour les nouveaux indices.
  */
-void ObjetSimuleSPH::Simulation(Vector gravite, float viscosite, int Tps)
+void ObjetSimuleSPH::ReordonneParticules()
+{
+    std::vector<unsigned int> codes;
+    std::vector<int> perm;
+
+    _Grille.CodesMorton(codes);
+    TriRadixParallele(codes, 30, perm);
+    _Particules.Permute(perm);
+
+    _Grille.Construction(_Nb_Sommets, _Particules.P, TailleCellule());
+    _VerletValide = false;
+}
+
+
+/**
+ * Carre du plus grand deplacement d une particule depuis la construction des listes de Verlet.
+ */
+float ObjetSimuleSPH::DeplacementMax2() const
+{
+    const float *px = _Particules.P.x.data(), *py = _Particules.P.y.data(), *pz = _Particules.P.z.data();
+    const float *qx = _PositionsVerlet.x.data(), *qy = _PositionsVerlet.y.data(), *qz = _PositionsVerlet.z.data();
+    float d2max = 0;
+
+#pragma omp parallel for simd reduction(max : d2max)
+    for (int i = 0; i < _Nb_Sommets; ++i)
+    {
+        float dx = px[i] - qx[i], dy = py[i] - qy[i], dz = pz[i] - qz[i];
+        d2max = std::max(d2max, dx * dx + dy * dy + dz * dz);
+    }
+
+    return d2max;
+}
+
+
+/**
+ * Affichage des statistiques des listes de Verlet : nombre de reconstructions,
+ * nombre de paires et memoire occupee par les listes et les positions de reference.
+ */
+void ObjetSimuleSPH::RapportVerlet(int Tps) const
+{
+    size_t octets = _ListesVerlet.Memoire() + _Voisins.Memoire()
+                    + 3 * _PositionsVerlet.x.capacity() * sizeof(float);
+
+    std::cout << "Verlet [T=" << Tps << "] : " << _NbReconstructions << " reconstructions ; "
+              << _ListesVerlet.NbPaires() << " paires (h + skin) ; "
+              << octets / (1024.0 * 1024.0) << " Mo" << std::endl;
+}
+
+
+/**
+ * Un pas de temps de la simulation, de duree au plus duree_max en mode pas adaptatif.
+ * Etapes : grille des voisins (listes de Verlet, reordonnancement), reinitialisation, densites (+ listes de voisins),
+ * (divergence nulle de DFSPH), pressions, forces, pas de temps, correction des pressions (solveur incompressible),
+ * integration, collisions.
+ * Renvoie la duree du pas effectue.
+ */
+float ObjetSimuleSPH::PasDeTemps(Vector gravite, float viscosite, float duree_max)
 {
+    /* Grille des voisins (et listes de Verlet, reordonnancement periodique) */
+    {
+        PROFIL_PHASE(PHASE_VOISINS);
+        PreparationVoisins(_Pas);
+    }
+
+    /* Reinitialisation des densites et des forces, puis densites aux positions courantes */
+    {
+        PROFIL_PHASE(PHASE_DENSITE);
+        Reinitialisation();
+        CalculDensite();
+        if (_ModePression == PRESSION_DFSPH)
+            CalculFacteursDFSPH();
+    }
+
+    /* Calcul des pressions (nulles avec un solveur incompressible : viscosite seule dans les forces),
+       et avec DFSPH, vitesses rendues a divergence nulle avant le calcul des forces */
+    {
+        PROFIL_PHASE(PHASE_PRESSION);
+        if (_ModePression == PRESSION_DFSPH)
+            CorrectionDivergenceDFSPH();
+        CalculPression();
+    }
+
     /* Calcul des interactions entre particules */
-    CalculInteraction(viscosite);
-    /* Calcul des accelerations (avec ajout de la gravite aux forces) */
-    //std::cout << "Accel.... " << std::endl;
-    _SolveurExpl->CalculAccel_ForceGravite(gravite, _Nb_Sommets, A, Force, M);
+    {
+        PROFIL_PHASE(PHASE_INTERACTION);
+        CalculInteraction(viscosite);
+    }
 
-    /* Calcul des vitesses et positions au temps t */
-    //std::cout << "Vit.... " << std::endl;
-    _SolveurExpl->Solve(viscosite, _Nb_Sommets, Tps, A, V, Vprec, P);
+    /* Pas de temps stable pour les vitesses et accelerations (forces et gravite) courantes */
+    {
+        PROFIL_PHASE(PHASE_ACCELERATION);
+        // vitesse du son c = sqrt(bulk / rho0) (nulle en incompressible), viscosite cinematique nu = mu / rho0
+        if (_SolveurExpl->_Adaptatif)
+            _SolveurExpl->CalculPasAdaptatif(h, VitesseSon(), viscosite / rho0, duree_max, gravite,
+                                             _Nb_Sommets, _Particules);
+    }
+
+    /* Solveur incompressible : pressions corrigees pour le pas de temps choisi, ajoutees aux forces */
+    if (_ModePression != PRESSION_EQUATION_ETAT)
+    {
+        PROFIL_PHASE(PHASE_PRESSION);
+        if (_ModePression == PRESSION_PCISPH)
+            CorrectionPCISPH(gravite);
+        else if (_ModePression == PRESSION_IISPH)
+            CorrectionIISPH(gravite);
+        else
+            CorrectionDensiteDFSPH(gravite);
+    }
+
+    /* Calcul des accelerations, des vitesses et positions au temps t, et des rebonds sur les murs
+       en une seule passe sur les particules */
+    {
+        PROFIL_PHASE(PHASE_SOLVE);
+        //std::cout << "Vit.... " << std::endl;
+        _SolveurExpl->Solve(gravite, MursIntegration(), _Nb_Sommets, _Particules);
+    }
 
     /* Gestion des collisions  */
     // Reponse : rebond
     // Penser au Translate de l objet dans la scene pour trouver plan coherent
-    Collision();
+    {
+        PROFIL_PHASE(PHASE_COLLISION);
+        Collision();
+    }
+
+    ++_Pas;
+    _Temps += _SolveurExpl->_delta_t;
+    return _SolveurExpl->_delta_t;
+}
+
+
+/**
+ * Simulation de l objet : une image.
+ * Pas de temps fixe : une image correspond a un pas de temps.
+ * Pas de temps adaptatif : une image correspond a une duree simulee fixe (dt_image),
+ * decoupee en autant de sous-pas que necessaire ; l animation affichee ne depend donc
+ * pas du nombre de sous-pas.
+ */
+void ObjetSimuleSPH::Simulation(Vector gravite, float viscosite, int Tps)
+{
+    if (_Verlet && Tps % 100 == 0)
+        RapportVerlet(Tps);
+
+    if (!_SolveurExpl->_Adaptatif)
+    {
+        PasDeTemps(gravite, viscosite, _SolveurExpl->_delta_t);
+        if (Tps % 100 == 0)
+            RapportPression();
+        EnregistreTrajectoire(Tps, _Temps);
+        return;
+    }
+
+    int nb_sous_pas = 0;
+    float reste = _DureeImage;
+    while (reste > 0)
+    {
+        reste -= PasDeTemps(gravite, viscosite, reste);
+        ++nb_sous_pas;
+    }
+
+    if (Tps % 100 == 0)
+    {
+        std::cout << "Image " << Tps << " : t = " << _Temps << " s ; " << nb_sous_pas
+                  << " sous-pas ; dt = " << _SolveurExpl->_delta_t << std::endl;
+        RapportPression();
+    }
+
+    EnregistreTrajectoire(Tps, _Temps);
 
     // Affichage des positions
     // AffichagePos(Tps);
 }
+
+
+/// Tableaux de flottants des particules, dans l ordre du fichier de reprise
+static const char *NOMS_TABLEAUX_REPRISE[] = {
+    "P.x", "P.y", "P.z", "V.x", "V.y", "V.z", "Vprec.x", "Vprec.y", "Vprec.z",
+    "A.x", "A.y", "A.z", "Force.x", "Force.y", "Force.z", "M", "rho"};
+static const int NB_TABLEAUX_REPRISE = sizeof(NOMS_TABLEAUX_REPRISE) / sizeof(NOMS_TABLEAUX_REPRISE[0]);
+
+/**
+ * Tableaux de flottants des particules, dans l ordre de NOMS_TABLEAUX_REPRISE.
+ */
+static void tableaux_reprise(ParticleStore &p, TableauAligne *tableaux[])
+{
+    ChampVectoriel *champs[] = {&p.P, &p.V, &p.Vprec, &p.A, &p.Force};
+    for (int c = 0; c < 5; ++c)
+    {
+        tableaux[3 * c] = &champs[c]->x;
+        tableaux[3 * c + 1] = &champs[c]->y;
+        tableaux[3 * c + 2] = &champs[c]->z;
+    }
+    tableaux[15] = &p.M;
+    tableaux[16] = &p.rho;
+}
+
+
+/**
+ * Ecriture de l etat dans un fichier de reprise : grandeurs scalaires, puis chaque tableau
+ * des particules d un seul bloc, dans l ordre de stockage courant, avec les identifiants persistants.
+ */
+bool ObjetSimuleSPH::EcritReprise(EcritureReprise &fichier) const
+{
+    EnteteObjetReprise entete;
+    memset(&entete, 0, sizeof(entete));
+    strncpy(entete.type, "sph", sizeof(entete.type) - 1);
+    entete.nb_particules = _Nb_Sommets;
+    entete.nb_tableaux = NB_TABLEAUX_REPRISE + 1;
+    entete.pas = _Pas;
+    entete.temps = _Temps;
+    entete.h = h;
+    entete.rho0 = rho0;
+    entete.bulk = bulk;
+    entete.dt = _SolveurExpl->_delta_t;
+    entete.dt_prec = _SolveurExpl->_dt_prec;
+    fichier.Objet(entete);
+
+    TableauAligne *tableaux[NB_TABLEAUX_REPRISE];
+    tableaux_reprise(const_cast<ParticleStore &>(_Particules), tableaux);
+
+    for (int t = 0; t < NB_TABLEAUX_REPRISE; ++t)
+        fichier.Tableau(NOMS_TABLEAUX_REPRISE[t], tableaux[t]->data(), _Nb_Sommets * sizeof(float));
+
+    std::vector<int32_t> id(_Particules.Id.begin(), _Particules.Id.end());
+    fichier.Tableau("Id", id.data(), _Nb_Sommets * sizeof(int32_t));
+
+    return true;
+}
+
+
+/**
+ * Lecture de l etat depuis un fichier de reprise. Les tableaux sont copies depuis le fichier
+ * projete en memoire ; h, rho0, bulk et les pas de temps du fichier remplacent ceux des parametres.
+ * La grille et les listes de voisins sont reconstruites au pas suivant.
+ */
+bool ObjetSimuleSPH::LitReprise(LectureReprise &fichier)
+{
+    const EnteteObjetReprise *entete = fichier.Objet();
+    if (entete == NULL)
+        return false;
+
+    if (strncmp(entete->type, "sph", sizeof(entete->type)) != 0 || entete->nb_tableaux != NB_TABLEAUX_REPRISE + 1)
+    {
+        std::cout << "Reprise : l objet du fichier n est pas un objet sph" << std::endl;
+        return false;
+    }
+
+    int n = entete->nb_particules;
+    if (n < 0)
+        return false;
+
+    _Particules.resize(n);
+
+    TableauAligne *tableaux[NB_TABLEAUX_REPRISE];
+    tableaux_reprise(_Particules, tableaux);
+
+    for (int t = 0; t < NB_TABLEAUX_REPRISE; ++t)
+    {
+        const void *donnees = fichier.Tableau(NOMS_TABLEAUX_REPRISE[t], n * sizeof(float));
+        if (donnees == NULL)
+            return false;
+        memcpy(tableaux[t]->data(), donnees, n * sizeof(float));
+    }
+
+    const int32_t *id = (const int32_t *)fichier.Tableau("Id", n * sizeof(int32_t));
+    if (id == NULL)
+        return false;
+
+    // Les identifiants doivent etre une permutation de 0..n-1
+    std::vector<bool> vu(n, false);
+    for (int k = 0; k < n; ++k)
+    {
+        if (id[k] < 0 || id[k] >= n || vu[id[k]])
+        {
+            std::cout << "Reprise : identifiants des particules invalides" << std::endl;
+            return false;
+        }
+        vu[id[k]] = true;
+        _Particules.Id[k] = id[k];
+    }
+    _Particules.MiseAJourEmplacements();
+
+    _Nb_Sommets = n;
+    h = entete->h;
+    rho0 = entete->rho0;
+    bulk = entete->bulk;
+    InitNoyaux();
+    _SolveurExpl->_delta_t = entete->dt;
+    _SolveurExpl->_dt_prec = entete->dt_prec;
+    _Pas = entete->pas;
+    _Temps = entete->temps;
+
+    // Grille et listes de Verlet reconstruites au prochain pas
+    _VerletValide = false;
+    _ProchainTri = 0;
+
+    updateVertex();
+
+    std::cout << "Reprise : " << n << " particules, " << _Pas << " pas, t = " << _Temps << " s" << std::endl;
+    return true;
+}
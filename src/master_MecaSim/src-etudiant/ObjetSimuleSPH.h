@@ -17,12 +17,91 @@
 
 // Fichiers de gkit2light
 #include "vec.h"
-#include "mesh.h"
 
 // Fichiers de master_meca_sim
 #include "Noeuds.h"
 #include "Properties.h"
 #include "SolveurExpl.h"
+#include "GrilleSPH.h"
+#include "NoyauxSIMD.h"
+#include "ListeVoisins.h"
+#include "ChampDistance.h"
+#include "MaillageCollision.h"
+
+
+/// Calcul des pressions : equation d etat (fluide faiblement compressible) ou solveur incompressible
+enum ModePression
+{
+    PRESSION_EQUATION_ETAT = 0,
+    PRESSION_PCISPH = 1,
+    PRESSION_DFSPH = 2,
+    PRESSION_IISPH = 3
+};
+
+
+/**
+ * \brief Iterations et residus (erreurs de densite relatives) d un solveur de pression iteratif :
+ * valeurs du dernier pas, et cumul depuis le dernier rapport.
+ */
+struct StatistiquesSolveur
+{
+    /// Iterations et residu du dernier pas
+    int iterations;
+    float residu;
+
+    /// Cumul : nombre de pas, somme et maximum des iterations, somme des residus
+    long nb_pas, somme_iterations;
+    int max_iterations;
+    double somme_residus;
+
+    /*! Constructeur */
+    StatistiquesSolveur() : iterations(0), residu(0) { Reinitialise(); }
+
+    /*! Ajout d un pas */
+    void Ajoute(int iter, float res)
+    {
+        iterations = iter;
+        residu = res;
+        ++nb_pas;
+        somme_iterations += iter;
+        if (iter > max_iterations)
+            max_iterations = iter;
+        somme_residus += res;
+    }
+
+    /*! Remise a zero du cumul */
+    void Reinitialise()
+    {
+        nb_pas = somme_iterations = 0;
+        max_iterations = 0;
+        somme_residus = 0;
+    }
+};
+
+
+/**
+ * \brief Tableaux de travail d un thread pour les noyaux de calcul par paires.
+ */
+struct TamponPaires
+{
+    /// Sorties des noyaux (poids, termes de paire) et indices des voisins retenus
+    TableauAligne w, tx, ty, tz;
+    std::vector<int> voisins_h;
+
+    /*! Agrandissement des tableaux a n elements au moins */
+    void Reserve(int n)
+    {
+        if ((int)w.size() < n)
+        {
+            w.resize(n);
+            tx.resize(n);
+            ty.resize(n);
+            tz.resize(n);
+            voisins_h.resize(n);
+        }
+    }
+};
+
 
 /**
  * \brief Structure de donnees pour la methode SPH.
@@ -34,39 +113,225 @@ public:
     /*! Constructeur */
     ObjetSimuleSPH(std::string fich_param);
     
+    /*! Destructeur */
+    ~ObjetSimuleSPH();
+    
     /*!  Lecture des parametres de l execution relatifs a la methode SPH */
     void Param_sph(std::string Fichier_Param);
 
     /*! Initialisation a partir des fichiers de donnees */
     void initObjetSimule();
     
+    /*! Densites, masses et premier pas des particules creees */
+    void initEtatParticules();
+    
+    /*! Constantes du jeu de noyaux de lissage et coefficient de PCISPH pour h, rho0 et les masses courants */
+    void InitNoyaux();
+    
     /*! Creation du maillage (pour affichage) de l objet simule */
     void initMeshObjet();
     
-    /*! Calcul des densites des particules */
+    /*! Reinitialisation des densites et des forces avant un pas de temps */
+    void Reinitialisation();
+    
+    /*! Calcul des densites des particules (et des listes de voisins) */
     void CalculDensite();
     
+    /*! Calcul des pressions (equation d etat, ou pressions nulles avant un solveur incompressible) */
+    void CalculPression();
+    
     /*! Calcul des forces d interaction entre particules */
     void CalculInteraction(float viscosite);
     
-    /*! Simulation de l objet */
+    /*! Somme des termes des paires de voisins (noyau des forces) dans forces */
+    void SommeForcesPaires(const DonneesForce &d, ChampVectoriel &forces);
+    
+    /*! Vitesse du son du critere CFL : sqrt(bulk / rho0), nulle pour un solveur incompressible */
+    float VitesseSon() const;
+    
+    /*! Tableaux de travail des noyaux par paires pour chaque thread (_Tampons) */
+    void PreparationTampons();
+    
+    /*! Densites aux positions predites, sur les listes de voisins du pas */
+    void CalculDensitePredite();
+    
+    /*! Donnees des noyaux des forces et des gradients aux positions courantes (hors densites et pressions) */
+    void DonneesPaires(DonneesForce &d) const;
+    
+    /*! Accelerations dues aux seules pressions press (terme de pression des forces multiplie par facteur) */
+    void CalculAccelPression(const float *press, const float *rho, float facteur, ChampVectoriel &accel);
+    
+    /*! Sommes des gradients des noyaux de densite et des pressions, et de leurs produits (DFSPH et IISPH) */
+    void SommesGradients(ChampVectoriel &densite, ChampVectoriel &pression, float *produits);
+    
+    /*! Facteurs alpha de DFSPH (inverse de la diagonale du systeme de pression, a rho_i pres) */
+    void CalculFacteursDFSPH();
+    
+    /*! Coefficients d_ii et a_ii d IISPH pour un deplacement coef par unite d acceleration */
+    void CalculCoefficientsIISPH(float coef);
+    
+    /*! Derivees particulaires des densites div_i = \sum_j m (v_i - v_j) . grad W_ij pour les vitesses v */
+    void CalculDivergence(const ChampVectoriel &v, float *div);
+    
+    /*! Coefficient de correction des pressions de PCISPH, pour un deplacement unitaire par unite d acceleration */
+    float CoefPCISPH() const;
+    
+    /*! Prediction-correction des pressions de PCISPH pour le pas courant, ajoutees aux forces */
+    void CorrectionPCISPH(Vector gravite);
+    
+    /*! Solveur de divergence nulle de DFSPH : correction des vitesses V au debut du pas */
+    void CorrectionDivergenceDFSPH();
+    
+    /*! Solveur de densite constante de DFSPH pour le pas courant, accelerations ajoutees aux forces */
+    void CorrectionDensiteDFSPH(Vector gravite);
+    
+    /*! Iterations de correction communes aux deux solveurs de DFSPH (renvoie le nombre d iterations) */
+    int IterationsDFSPH(ChampVectoriel &v, float dt, bool densite, float tolerance, TableauAligne &kappa, float &residu);
+    
+    /*! Pressions d IISPH (Jacobi relaxe) pour le pas courant, ajoutees aux forces */
+    void CorrectionIISPH(Vector gravite);
+    
+    /*! Affichage des iterations et residus des solveurs de pression depuis le dernier rapport */
+    void RapportPression();
+    
+    /*! Taille des cellules de la grille : h, ou h + skin en mode listes de Verlet */
+    float TailleCellule() const { return _Verlet ? h + _Skin : h; }
+    
+    /*! Grille (et listes de Verlet) pour le pas de temps Tps */
+    void PreparationVoisins(int Tps);
+    
+    /*! Reordonnancement des particules selon le code de Morton de leur cellule */
+    void ReordonneParticules();
+    
+    /*! Construction des listes de Verlet (rayon h + skin) sur la grille courante */
+    void ConstructionListesVerlet();
+    
+    /*! Carre du plus grand deplacement d une particule depuis la construction des listes de Verlet */
+    float DeplacementMax2() const;
+    
+    /*! Affichage des statistiques des listes de Verlet (reconstructions, memoire) */
+    void RapportVerlet(int Tps) const;
+    
+    /*! Un pas de temps (de duree au plus duree_max en mode adaptatif), renvoie sa duree */
+    float PasDeTemps(Vector gravite, float viscosite, float duree_max);
+    
+    /*! Simulation de l objet (une image) */
     void Simulation(Vector gravite, float viscosite, int Tps);
     
     /*! Traitement des collisions */
     void damp_reflect(int which, float barrier, int indice_part);
+    
+    /*! Traitement d une collision avec une frontiere de normale quelconque (distance < 0 : penetration) */
+    void damp_reflect(const Vector &normale, float distance, int indice_part);
+    
+    /*! Lecture du maillage de la frontiere et construction de son champ de distance */
+    void initFrontiere();
+    
+    /*! Lecture du maillage de collision et construction de sa BVH */
+    void initMaillageCollision();
+    
+    /*! Collisions avec le maillage de collision (trajets des particules pendant le pas) */
+    void CollisionMaillage();
   
     /*! Gestion des collisions  */
     void Collision();
+
+    /*! Indique si les murs du domaine sont utilises (pas de frontiere conteneur) */
+    bool AvecMurs() const { return _TypeFrontiere != FRONTIERE_CONTENEUR || _Frontiere.EstVide(); }
     
-    /*! Mise a jour du Mesh (pour affichage) de l objet en fonction des nouvelles positions calculees */
+    /*! Murs a traiter pendant l integration, ou NULL s ils sont traites par Collision() */
+    const MursDomaine *MursIntegration() const;
+
+    /*! Bornes du domaine (murs des collisions) */
+    void Domaine(Vector &pmin, Vector &pmax) const;
+    
+    /*! Energies cinetique, potentielle de pesanteur et interne (equation d etat) des particules */
+    void Energies(const Vector &gravite, double &cinetique, double &potentielle, double &interne) const;
+    
+    /*! Mise a jour des positions affichees (tableau P) a partir des positions calculees */
     void updateVertex();
 
+    /*! Ecriture de l etat (tableaux des particules, h, rho0, bulk, pas de temps) dans un fichier de reprise */
+    bool EcritReprise(EcritureReprise &fichier) const;
+
+    /*! Lecture de l etat depuis un fichier de reprise (remplace les particules creees par initObjetSimule) */
+    bool LitReprise(LectureReprise &fichier);
+
     
-    /// SolveurExpl : schema d integration semi-implicite 
+    /// SolveurExpl : schema d integration explicite (cle Integration du fichier de parametres)
     SolveurExpl *_SolveurExpl;
     
-    /// Declaration du tableau des densites
-    std::vector<float> rho;
+    /// Grille de recherche des voisins (cellules de taille h)
+    GrilleSPH _Grille;
+    
+    /// Listes des voisins construites par la passe de densite, reutilisees par la passe des forces
+    ListeVoisins _Voisins;
+    
+    /// Tableaux de travail des noyaux par paires, un par thread (conserves d un pas a l autre)
+    std::vector<TamponPaires> _Tampons;
+    
+    /// Pressions des particules
+    TableauAligne _Pression;
+    
+    /// Calcul des pressions : equation d etat, PCISPH, DFSPH ou IISPH (cle pression)
+    ModePression _ModePression;
+    
+    /// Erreur de densite relative moyenne toleree par le solveur incompressible
+    float _TolerancePression;
+    
+    /// Variation de densite relative moyenne par pas toleree par le solveur de divergence (DFSPH)
+    float _ToleranceDivergence;
+    
+    /// Nombres minimal et maximal d iterations du solveur incompressible par pas
+    int _IterMinPression, _IterMaxPression;
+    
+    /// Positions predites sans les accelerations de pression, et avec
+    ChampVectoriel _PredictionSansPression, _PositionsPredites;
+    
+    /// Accelerations de pression du solveur incompressible
+    ChampVectoriel _AccelPression;
+    
+    /// Densites aux positions predites
+    TableauAligne _DensitesPredites;
+    
+    /// Facteurs alpha de DFSPH, derivees des densites et vitesses predites
+    TableauAligne _Alpha, _Divergence;
+    ChampVectoriel _VitessesPredites;
+    
+    /// Raideurs de DFSPH du pas (densite et divergence)
+    TableauAligne _KappaDensite, _KappaDivergence;
+    
+    /// Raideurs du solveur de divergence du pas precedent, indexees par identifiant persistant (demarrage a chaud)
+    TableauAligne _KappaDivergencePrec;
+    
+    /// Densites unitaires (termes de paire de DFSPH calcules par le noyau des forces)
+    TableauAligne _DensitesUnites;
+    
+    /// Coefficients d IISPH : deplacement d_ii de i par sa propre pression, et diagonale a_ii du systeme
+    ChampVectoriel _Dii;
+    TableauAligne _Aii;
+    
+    /// Termes p_i / rho_i^2 des pressions d IISPH (noyau des forces)
+    TableauAligne _PressionsReduites;
+    
+    /// Pressions d IISPH du pas precedent, indexees par identifiant persistant (demarrage a chaud)
+    TableauAligne _PressionPrec;
+    
+    /// Facteur de relaxation des Jacobi de DFSPH et d IISPH
+    float _Relaxation;
+    
+    /// Coefficient de correction des pressions de PCISPH (CoefPCISPH), calcule par InitNoyaux
+    float _CoefPCISPH;
+    
+    /// Iterations et residus du solveur incompressible (densite) et du solveur de divergence (DFSPH)
+    StatistiquesSolveur _StatsPression, _StatsDivergence;
+    
+    /// Noyaux de calcul par paires (scalaire, AVX2 ou AVX-512) choisis a l execution,
+    /// ou noyaux specialises d un jeu de noyaux de lissage (cle noyau)
+    const NoyauxSPH *_Noyaux;
+    
+    /// Constantes du jeu de noyaux de lissage pour le rayon h
+    ConstantesNoyau _ConstantesNoyau;
     
     /// Taille d une particule
     float h;
@@ -76,6 +341,80 @@ public:
     
     /// Module de Bulk (de compressibilite)
     float bulk;
+    
+    /// Periode (en pas de temps) du reordonnancement de Morton, 0 pour le desactiver
+    int _PeriodeTri;
+    
+    /// Pas de temps du prochain reordonnancement de Morton
+    int _ProchainTri;
+    
+    /// Mode listes de Verlet : listes de rayon h + skin reconstruites seulement si necessaire
+    bool _Verlet;
+    
+    /// Epaisseur de la couche supplementaire des listes de Verlet
+    float _Skin;
+    
+    /// Listes de Verlet (demi-listes des paires a distance < h + skin)
+    ListeVoisins _ListesVerlet;
+    
+    /// Positions des particules lors de la construction des listes de Verlet
+    ChampVectoriel _PositionsVerlet;
+    
+    /// Indique si les listes de Verlet correspondent aux particules courantes
+    bool _VerletValide;
+    
+    /// Nombre de reconstructions des listes de Verlet
+    int _NbReconstructions;
+    
+    /// Nombre de pas de temps effectues
+    int _Pas;
+    
+    /// Temps simule
+    float _Temps;
+    
+    /// Duree simulee par image en mode pas de temps adaptatif
+    float _DureeImage;
+    
+    /// Fichier du maillage de la frontiere de forme quelconque (vide : boite du domaine seule)
+    std::string _Fich_Frontiere;
+    
+    /// Obstacle (dans la boite du domaine) ou conteneur (a la place de la boite)
+    TypeFrontiere _TypeFrontiere;
+    
+    /// Echelle et translation appliquees au maillage de la frontiere
+    float _EchelleFrontiere;
+    Vector _TranslationFrontiere;
+    
+    /// Espacement des noeuds du champ de distance
+    float _PasFrontiere;
+    
+    /// Sommets et triangles de la frontiere (apres transformation), pour l affichage
+    std::vector<Vector> _SommetsFrontiere;
+    std::vector<int> _TrianglesFrontiere;
+    
+    /// Champ de distance signee de la frontiere
+    ChampDistance _Frontiere;
+    
+    /// Fichier du maillage de collision (vide : aucun)
+    std::string _Fich_Collision;
+    
+    /// Echelle et translation appliquees au maillage de collision
+    float _EchelleCollision;
+    Vector _TranslationCollision;
+    
+    /// Distance minimale entre les particules et le maillage de collision
+    float _EpaisseurCollision;
+    
+    /// Sommets et triangles du maillage de collision (apres transformation), pour l affichage
+    std::vector<Vector> _SommetsCollision;
+    std::vector<int> _TrianglesCollision;
+    
+    /// Maillage de collision et sa BVH
+    MaillageCollision _MaillageCollision;
+    
+    /// Positions des particules au debut du pas et contacts avec le maillage de collision
+    ChampVectoriel _DebutPas;
+    std::vector<ContactMaillage> _Contacts;
 
 
 
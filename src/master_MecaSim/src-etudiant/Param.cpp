@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <sstream>
 #include <string.h> 
+#include <algorithm>
 
 
 /** Fichiers de l application **/
@@ -36,6 +37,7 @@
 #include "ObjetSimule.h"
 #include "ObjetSimuleSPH.h"
 #include "Matrix.h"
+#include "Profilage.h"
 
 
 /**
@@ -92,6 +94,17 @@ void Scene::Param(std::string Fichier_Param)
 
         GET_PARAM(typeObjet, _type_objet[i-1]);
     }
+    
+    /* Mesure du temps de chaque phase de la simulation : yes pour l activer */
+    std::string profilage = "no";
+    GET_PARAM("profilage", profilage);
+    if (profilage == "yes")
+        Profilage::Active(true);
+    
+    /* Simulation dans un thread separe de l affichage : no pour calculer une iteration par image */
+    std::string asynchrone = "yes";
+    GET_PARAM("asynchrone", asynchrone);
+    _Asynchrone = (asynchrone == "yes");
 	
 }
 
@@ -116,6 +129,16 @@ void ObjetSimule::Param_mesh(std::string Fichier_Param)
     
 	// Interaction avec l utilisateur ou non
 	GET_PARAM("interaction", _Interaction);
+	
+	/* Enregistrement de la trajectoire : fichier, periode (en iterations), une image cle
+	   toutes les trajectoire_cle images (1 : pas de codage differentiel) */
+	if (Prop["trajectoire"] != "")
+		GET_PARAM("trajectoire", _Fich_Trajectoire);
+	if (Prop["trajectoire_periode"] != "")
+		GET_PARAM("trajectoire_periode", _PeriodeTrajectoire);
+	if (Prop["trajectoire_cle"] != "")
+		GET_PARAM("trajectoire_cle", _PeriodeCleTrajectoire);
+	_PeriodeTrajectoire = std::max(_PeriodeTrajectoire, 1);
 
     
 }//void
@@ -133,14 +156,93 @@ void ObjetSimuleSPH::Param_sph(std::string Fichier_Param)
     /* Chargement du fichier */
     Prop.load(Fichier_Param);
     
-    /// Choix du solveur
-    _SolveurExpl = new SolveurExpl();
+    /* Calcul des pressions : equation_etat (par defaut), pcisph, dfsph ou iisph (incompressibles), erreur
+       de densite relative moyenne toleree (par defaut 1 %), variation de densite relative par pas toleree
+       par le solveur de divergence de DFSPH (par defaut 1 %), nombres minimal et maximal d iterations,
+       facteur de relaxation des Jacobi de DFSPH et d IISPH (par defaut 0.5) */
+    std::string pression = "equation_etat";
+    GET_PARAM("pression", pression);
+    if (pression == "pcisph")
+        _ModePression = PRESSION_PCISPH;
+    else if (pression == "dfsph")
+        _ModePression = PRESSION_DFSPH;
+    else if (pression == "iisph")
+        _ModePression = PRESSION_IISPH;
+    else
+    {
+        if (pression != "equation_etat")
+            std::cout << "Calcul des pressions " << pression << " inconnu, utilisation de l equation d etat" << std::endl;
+        _ModePression = PRESSION_EQUATION_ETAT;
+    }
+    
+    _TolerancePression = 0.01f;
+    if (Prop["pression_tolerance"] != "")
+        GET_PARAM("pression_tolerance", _TolerancePression);
+    _ToleranceDivergence = 0.01f;
+    if (Prop["pression_tolerance_divergence"] != "")
+        GET_PARAM("pression_tolerance_divergence", _ToleranceDivergence);
+    _IterMinPression = 3;
+    if (Prop["pression_iter_min"] != "")
+        GET_PARAM("pression_iter_min", _IterMinPression);
+    _IterMaxPression = 50;
+    if (Prop["pression_iter_max"] != "")
+        GET_PARAM("pression_iter_max", _IterMaxPression);
+    _Relaxation = 0.5f;
+    if (Prop["pression_relaxation"] != "")
+        GET_PARAM("pression_relaxation", _Relaxation);
+    
+    if (_ModePression != PRESSION_EQUATION_ETAT)
+        std::cout << "Solveur de pression " << pression << " : tolerance = " << _TolerancePression
+        << " ; iterations dans [" << _IterMinPression << ", " << _IterMaxPression << "]" << std::endl;
+    
+    /// Choix du solveur : euler_symplectique, saute_mouton (ou explicite) ou verlet_vitesse
+    /// (DFSPH corrige les vitesses d un pas d Euler symplectique)
+    std::string integration = "saute_mouton";
+    GET_PARAM("integration", integration);
+    if (_ModePression == PRESSION_DFSPH && integration != "euler_symplectique")
+    {
+        std::cout << "DFSPH : schema d integration " << integration << " remplace par euler_symplectique" << std::endl;
+        integration = "euler_symplectique";
+    }
+    _SolveurExpl = SolveurExpl::Cree(integration);
+    if (_SolveurExpl == NULL)
+    {
+        std::cout << "Schema d integration " << integration << " inconnu, utilisation du saute-mouton" << std::endl;
+        _SolveurExpl = SolveurExpl::Cree("saute_mouton");
+    }
     
-    std::cout << "Utilisation du schema d integration d'Euler semi-implicite"
+    std::cout << "Utilisation du schema d integration " << _SolveurExpl->Nom()
     << std::endl;
     
-    /* Intervalle de temps */
+    /* Intervalle de temps (pas fixe, ou pas initial en mode adaptatif) */
     GET_PARAM("dt", _SolveurExpl->_delta_t);
+    _SolveurExpl->_dt_prec = _SolveurExpl->_delta_t;
+    
+    /* Pas de temps adaptatif : yes pour l activer, coefficients de securite et bornes optionnels */
+    std::string adaptatif = "no";
+    GET_PARAM("dt_adaptatif", adaptatif);
+    _SolveurExpl->_Adaptatif = (adaptatif == "yes");
+    
+    if (Prop["cfl"] != "")
+        GET_PARAM("cfl", _SolveurExpl->_CoefCFL);
+    if (Prop["coef_force"] != "")
+        GET_PARAM("coef_force", _SolveurExpl->_CoefForce);
+    if (Prop["coef_visco"] != "")
+        GET_PARAM("coef_visco", _SolveurExpl->_CoefViscosite);
+    if (Prop["dt_min"] != "")
+        GET_PARAM("dt_min", _SolveurExpl->_dt_min);
+    if (Prop["dt_max"] != "")
+        GET_PARAM("dt_max", _SolveurExpl->_dt_max);
+    
+    /* Duree simulee par image en mode adaptatif (par defaut 1/60 s) */
+    _DureeImage = 1.f / 60;
+    if (Prop["dt_image"] != "")
+        GET_PARAM("dt_image", _DureeImage);
+    
+    if (_SolveurExpl->_Adaptatif)
+        std::cout << "Pas de temps adaptatif : cfl = " << _SolveurExpl->_CoefCFL
+        << " ; dt dans [" << _SolveurExpl->_dt_min << ", " << _SolveurExpl->_dt_max << "]"
+        << " ; duree par image = " << _DureeImage << std::endl;
     
     /* Densite de reference */
     GET_PARAM("rho0", rho0);
@@ -151,4 +253,89 @@ void ObjetSimuleSPH::Param_sph(std::string Fichier_Param)
     /* Taille des particules */
     GET_PARAM("h", h);
     
+    /* Periode du reordonnancement des particules selon la courbe de Morton (0 : jamais) */
+    _PeriodeTri = 25;
+    if (Prop["tri_morton"] != "")
+        GET_PARAM("tri_morton", _PeriodeTri);
+    
+    /* Listes de Verlet : yes pour les activer, epaisseur skin (par defaut 0.2 h) */
+    std::string verlet = "no";
+    GET_PARAM("verlet", verlet);
+    _Verlet = (verlet == "yes");
+    
+    _Skin = 0.2f * h;
+    if (Prop["skin"] != "")
+        GET_PARAM("skin", _Skin);
+    
+    if (_Verlet)
+        std::cout << "Listes de Verlet : skin = " << _Skin << std::endl;
+    
+    /* Version des noyaux de calcul : auto (par defaut), scalaire, avx2 ou avx512 */
+    std::string simd = "auto";
+    GET_PARAM("simd", simd);
+    _Noyaux = &ChoixNoyauxSPH(simd);
+    
+    /* Jeu de noyaux de lissage : bindel (par defaut, noyaux d origine des versions SIMD), poly6
+       (poly6, spiky et viscosite), spline_cubique, wendland_c2 ou wendland_c4 (le laplacien de la
+       viscosite est celui du noyau de viscosite) ; les solveurs incompressibles gardent ceux d origine */
+    std::string jeu = "bindel";
+    GET_PARAM("noyau", jeu);
+    if (jeu != "bindel")
+    {
+        const NoyauxSPH *lissage = ChoixNoyauxLissage(jeu);
+        if (lissage == NULL)
+            std::cout << "Jeu de noyaux " << jeu << " inconnu, utilisation des noyaux d origine" << std::endl;
+        else if (_ModePression != PRESSION_EQUATION_ETAT)
+            std::cout << "Jeu de noyaux " << jeu << " sans effet avec un solveur incompressible" << std::endl;
+        else
+            _Noyaux = lissage;
+    }
+    
+    if (_Noyaux->constantes != NULL)
+        std::cout << "Noyaux de calcul SPH : " << _Noyaux->nom << " (boucles specialisees)" << std::endl;
+    else
+        std::cout << "Noyaux de calcul SPH : " << _Noyaux->nom
+        << " (" << _Noyaux->largeur << " paires par instruction)" << std::endl;
+    
+    /* Frontiere de forme quelconque : maillage ferme (.obj, ou faceset.eti avec points.eti dans le
+       meme dossier), obstacle (fluide a l exterieur, dans la boite du domaine) ou conteneur (fluide
+       a l interieur, remplace la boite), echelle et translation du maillage, espacement des noeuds
+       du champ de distance (par defaut h) */
+    GET_PARAM("frontiere", _Fich_Frontiere);
+    
+    std::string type_frontiere = "obstacle";
+    GET_PARAM("frontiere_type", type_frontiere);
+    _TypeFrontiere = (type_frontiere == "conteneur") ? FRONTIERE_CONTENEUR : FRONTIERE_OBSTACLE;
+    
+    if (Prop["frontiere_echelle"] != "")
+        GET_PARAM("frontiere_echelle", _EchelleFrontiere);
+    if (Prop["frontiere_x"] != "")
+        GET_PARAM("frontiere_x", _TranslationFrontiere.x);
+    if (Prop["frontiere_y"] != "")
+        GET_PARAM("frontiere_y", _TranslationFrontiere.y);
+    if (Prop["frontiere_z"] != "")
+        GET_PARAM("frontiere_z", _TranslationFrontiere.z);
+    
+    _PasFrontiere = h;
+    if (Prop["frontiere_pas"] != "")
+        GET_PARAM("frontiere_pas", _PasFrontiere);
+    
+    /* Maillage de collision (ouvert ou ferme : .obj, ou faceset.eti avec points.eti dans le meme
+       dossier), echelle et translation, epaisseur de la couche evitee par les particules
+       (par defaut h / 4) */
+    GET_PARAM("collision_maillage", _Fich_Collision);
+    
+    if (Prop["collision_echelle"] != "")
+        GET_PARAM("collision_echelle", _EchelleCollision);
+    if (Prop["collision_x"] != "")
+        GET_PARAM("collision_x", _TranslationCollision.x);
+    if (Prop["collision_y"] != "")
+        GET_PARAM("collision_y", _TranslationCollision.y);
+    if (Prop["collision_z"] != "")
+        GET_PARAM("collision_z", _TranslationCollision.z);
+    
+    _EpaisseurCollision = 0.25f * h;
+    if (Prop["collision_epaisseur"] != "")
+        GET_PARAM("collision_epaisseur", _EpaisseurCollision);
+    
 }
@@ -0,0 +1,121 @@
+/** \file ParticleStore.cpp
+ \brief Stockage des etats des particules en structure de tableaux.
+ */
+
+#include <algorithm>
+
+#include "vec.h"
+#include "ParticleStore.h"
+
+
+/**
+ * Mise a zero de tous les vecteurs du champ.
+ */
+void ChampVectoriel::zero()
+{
+    std::fill(x.begin(), x.end(), 0.f);
+    std::fill(y.begin(), y.end(), 0.f);
+    std::fill(z.begin(), z.end(), 0.f);
+}
+
+
+/**
+ * Redimensionnement de tous les champs des particules.
+ */
+void ParticleStore::resize(int n)
+{
+    P.resize(n);
+    V.resize(n);
+    Vprec.resize(n);
+    A.resize(n);
+    Force.resize(n);
+    M.resize(n, 0.f);
+    rho.resize(n, 0.f);
+
+    // Les nouvelles particules recoivent les identifiants suivants
+    int n0 = (int)Id.size();
+    Id.resize(n);
+    _Emplacement.resize(n);
+    for (int k = n0; k < n; ++k)
+        Id[k] = _Emplacement[k] = k;
+
+    // Apres une reduction, la numerotation repart de l ordre courant
+    if (n < n0)
+        for (int k = 0; k < n; ++k)
+            Id[k] = _Emplacement[k] = k;
+}
+
+
+/**
+ * Ajout d une particule au repos (vitesses, acceleration, force et densite nulles).
+ */
+void ParticleStore::push_back(const Vector &p, float m)
+{
+    P.push_back(p);
+    V.push_back(Vector(0, 0, 0));
+    Vprec.push_back(Vector(0, 0, 0));
+    A.push_back(Vector(0, 0, 0));
+    Force.push_back(Vector(0, 0, 0));
+    M.push_back(m);
+    rho.push_back(0.f);
+
+    int n = (int)Id.size();
+    Id.push_back(n);
+    _Emplacement.push_back(n);
+}
+
+
+/**
+ * Regroupement d un tableau selon perm (tableau temporaire fourni par l appelant).
+ */
+template <class Tableau>
+static void permute_tableau(Tableau &t, const std::vector<int> &perm, Tableau &tmp)
+{
+    int n = (int)perm.size();
+    tmp.resize(n);
+
+#pragma omp parallel for
+    for (int k = 0; k < n; ++k)
+        tmp[k] = t[perm[k]];
+
+    t.swap(tmp);
+}
+
+
+/**
+ * Reordonnancement de tous les champs des particules : la particule a l emplacement perm[k]
+ * passe a l emplacement k. Les identifiants suivent leurs particules et la table inverse
+ * est mise a jour, de sorte que Emplacement(id) designe toujours la meme particule.
+ */
+void ParticleStore::Permute(const std::vector<int> &perm)
+{
+    TableauAligne tmp;
+    ChampVectoriel *champs[] = {&P, &V, &Vprec, &A, &Force};
+
+    for (int c = 0; c < 5; ++c)
+    {
+        permute_tableau(champs[c]->x, perm, tmp);
+        permute_tableau(champs[c]->y, perm, tmp);
+        permute_tableau(champs[c]->z, perm, tmp);
+    }
+
+    permute_tableau(M, perm, tmp);
+    permute_tableau(rho, perm, tmp);
+
+    std::vector<int> tmp_id;
+    permute_tableau(Id, perm, tmp_id);
+
+    MiseAJourEmplacements();
+}
+
+
+/**
+ * Table inverse des identifiants : Emplacement(Id[k]) = k.
+ */
+void ParticleStore::MiseAJourEmplacements()
+{
+    int n = (int)Id.size();
+    _Emplacement.resize(n);
+    for (int k = 0; k < n; ++k)
+        _Emplacement[Id[k]] = k;
+}
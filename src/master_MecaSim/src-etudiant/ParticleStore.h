@@ -0,0 +1,206 @@
+/** \file ParticleStore.h
+ \brief Stockage des etats des particules en structure de tableaux (SoA)
+ avec des tableaux alignes sur 64 octets.
+ */
+
+#ifndef PARTICLE_STORE_H
+#define PARTICLE_STORE_H
+
+
+/** Librairies de base **/
+#include <stdlib.h>
+#include <stddef.h>
+#include <vector>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Fichiers de gkit2light
+#include "vec.h"
+
+
+/// Alignement des tableaux (une ligne de cache, un registre AVX-512)
+const size_t ALIGNEMENT_TABLEAUX = 64;
+
+
+/**
+ * \brief Allocateur renvoyant des blocs memoire alignes sur ALIGNEMENT octets.
+ */
+template <class T, size_t ALIGNEMENT>
+class AllocateurAligne
+{
+public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind
+    {
+        typedef AllocateurAligne<U, ALIGNEMENT> other;
+    };
+
+    AllocateurAligne() {}
+
+    template <class U>
+    AllocateurAligne(const AllocateurAligne<U, ALIGNEMENT> &) {}
+
+    T *allocate(size_t n)
+    {
+        if (n == 0)
+            return NULL;
+
+        void *p = NULL;
+#ifdef _WIN32
+        p = _aligned_malloc(n * sizeof(T), ALIGNEMENT);
+#else
+        if (posix_memalign(&p, ALIGNEMENT, n * sizeof(T)) != 0)
+            p = NULL;
+#endif
+        if (p == NULL)
+            throw std::bad_alloc();
+        return static_cast<T *>(p);
+    }
+
+    void deallocate(T *p, size_t)
+    {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+    }
+
+    template <class U>
+    bool operator==(const AllocateurAligne<U, ALIGNEMENT> &) const { return true; }
+
+    template <class U>
+    bool operator!=(const AllocateurAligne<U, ALIGNEMENT> &) const { return false; }
+};
+
+
+/// Tableau de flottants aligne
+typedef std::vector<float, AllocateurAligne<float, ALIGNEMENT_TABLEAUX> > TableauAligne;
+
+
+/**
+ * \brief Champ vectoriel stocke en trois tableaux alignes x[], y[], z[].
+ */
+struct ChampVectoriel
+{
+    /// Composantes selon x
+    TableauAligne x;
+
+    /// Composantes selon y
+    TableauAligne y;
+
+    /// Composantes selon z
+    TableauAligne z;
+
+    /*! Lecture du vecteur i */
+    Vector operator[](int i) const { return Vector(x[i], y[i], z[i]); }
+
+    /*! Ecriture du vecteur i */
+    void set(int i, const Vector &v)
+    {
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+
+    /*! Ajout d un vecteur en fin de tableau */
+    void push_back(const Vector &v)
+    {
+        x.push_back(v.x);
+        y.push_back(v.y);
+        z.push_back(v.z);
+    }
+
+    /*! Redimensionnement (les nouveaux vecteurs sont nuls) */
+    void resize(int n)
+    {
+        x.resize(n, 0.f);
+        y.resize(n, 0.f);
+        z.resize(n, 0.f);
+    }
+
+    /*! Mise a zero de tous les vecteurs */
+    void zero();
+
+    /*! Nombre de vecteurs */
+    int size() const { return (int)x.size(); }
+};
+
+
+/**
+ * \brief Etats de toutes les particules d un objet simule, en structure de tableaux.
+ * Chaque composante de chaque champ est un tableau contigu et aligne :
+ * les boucles sur les particules sont a pas unitaire et vectorisables.
+ */
+class ParticleStore
+{
+public:
+
+    /*! Constructeur */
+    ParticleStore() {}
+
+    /*! Nombre de particules */
+    int size() const { return (int)M.size(); }
+
+    /*! Redimensionnement de tous les champs */
+    void resize(int n);
+
+    /*! Suppression de toutes les particules */
+    void clear() { resize(0); }
+
+    /*! Ajout d une particule au repos en position p et de masse m */
+    void push_back(const Vector &p, float m);
+
+    /*! Reordonnancement de tous les champs : la particule perm[k] passe a l emplacement k */
+    void Permute(const std::vector<int> &perm);
+
+    /*! Emplacement courant de la particule d identifiant id */
+    int Emplacement(int id) const { return _Emplacement[id]; }
+
+    /*! Reconstruction de la table inverse apres une modification directe de Id */
+    void MiseAJourEmplacements();
+
+
+    /// Positions
+    ChampVectoriel P;
+
+    /// Vitesses
+    ChampVectoriel V;
+
+    /// Vitesses au demi pas de temps precedent
+    ChampVectoriel Vprec;
+
+    /// Accelerations initiales (premier pas) ; ensuite calculees a la volee dans SolveurExpl::Solve
+    ChampVectoriel A;
+
+    /// Forces
+    ChampVectoriel Force;
+
+    /// Masses
+    TableauAligne M;
+
+    /// Densites
+    TableauAligne rho;
+
+    /// Identifiant persistant (ordre de creation) de la particule a chaque emplacement
+    std::vector<int> Id;
+
+private:
+
+    /// Emplacement de chaque identifiant (table inverse de Id)
+    std::vector<int> _Emplacement;
+};
+
+
+#endif
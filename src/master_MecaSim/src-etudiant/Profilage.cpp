@@ -0,0 +1,186 @@
+/** \file Profilage.cpp
+ \brief Mesure du temps passe dans chaque phase de la simulation.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <omp.h>
+
+#include "Profilage.h"
+
+
+/// Noms des phases
+const char *NOMS_PHASES[NB_PHASES] = {
+    "voisins", "densite", "pression", "interaction", "acceleration", "solve", "collision", "iteration"};
+
+/// Mesures inactives par defaut
+std::atomic<bool> Profilage::s_Actif(false);
+
+
+/**
+ * Instance unique du profilage.
+ */
+Profilage &Profilage::Instance()
+{
+    static Profilage profilage;
+    return profilage;
+}
+
+
+/**
+ * Constructeur : compteurs a zero pour chaque thread possible, historiques vides.
+ */
+Profilage::Profilage()
+    : _NbIterations(0)
+{
+    _Threads.resize(omp_get_max_threads());
+    memset(_Threads.data(), 0, _Threads.size() * sizeof(CompteursThread));
+
+    for (int p = 0; p < NB_PHASES; ++p)
+    {
+        _Historique[p].assign(FENETRE, 0.f);
+        _Total[p] = 0;
+        _Appels[p] = 0;
+    }
+}
+
+
+/**
+ * Ajout d une duree aux compteurs du thread courant.
+ */
+void Profilage::Ajoute(int phase, long long ns)
+{
+    int t = omp_get_thread_num();
+    if (t >= (int)_Threads.size())
+        return;
+
+    _Threads[t].ns[phase] += ns;
+    _Threads[t].appels[phase]++;
+}
+
+
+/**
+ * Fin d une iteration : la duree de chaque phase (somme sur les threads) est rangee
+ * dans l historique, meme si elle est nulle, pour que les historiques restent alignes.
+ */
+void Profilage::FinIteration()
+{
+    if (!EstActif())
+        return;
+
+    int position = (int)(_NbIterations % FENETRE);
+
+    for (int p = 0; p < NB_PHASES; ++p)
+    {
+        long long ns = 0;
+        int appels = 0;
+        for (unsigned int t = 0; t < _Threads.size(); ++t)
+        {
+            ns += _Threads[t].ns[p];
+            appels += _Threads[t].appels[p];
+            _Threads[t].ns[p] = 0;
+            _Threads[t].appels[p] = 0;
+        }
+
+        float ms = (float)(ns * 1e-6);
+        _Historique[p][position] = ms;
+        _Total[p] += ms;
+        _Appels[p] += appels;
+    }
+
+    ++_NbIterations;
+}
+
+
+/**
+ * Statistiques d une phase sur la fenetre glissante (moyenne, centiles, maximum)
+ * et depuis le debut (total, nombre de mesures).
+ */
+StatistiquesPhase Profilage::Statistiques(int phase) const
+{
+    StatistiquesPhase s;
+    s.moyenne = s.p50 = s.p95 = s.p99 = s.max = 0;
+    s.total = _Total[phase];
+    s.appels = _Appels[phase];
+
+    int n = (int)std::min<long>(_NbIterations, FENETRE);
+    if (n == 0)
+        return s;
+
+    std::vector<float> tri(_Historique[phase].begin(), _Historique[phase].begin() + n);
+    std::sort(tri.begin(), tri.end());
+
+    double somme = 0;
+    for (int k = 0; k < n; ++k)
+        somme += tri[k];
+
+    s.moyenne = somme / n;
+    s.p50 = tri[(int)(0.50 * (n - 1) + 0.5)];
+    s.p95 = tri[(int)(0.95 * (n - 1) + 0.5)];
+    s.p99 = tri[(int)(0.99 * (n - 1) + 0.5)];
+    s.max = tri[n - 1];
+    return s;
+}
+
+
+/**
+ * Ecriture des statistiques au format CSV : une ligne par phase.
+ */
+bool Profilage::EcritCSV(const std::string &fichier) const
+{
+    FILE *f = fopen(fichier.c_str(), "w");
+    if (f == NULL)
+        return false;
+
+    fprintf(f, "phase,moyenne_ms,p50_ms,p95_ms,p99_ms,max_ms,total_ms,appels\n");
+    for (int p = 0; p < NB_PHASES; ++p)
+    {
+        StatistiquesPhase s = Statistiques(p);
+        fprintf(f, "%s,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%ld\n",
+                NOMS_PHASES[p], s.moyenne, s.p50, s.p95, s.p99, s.max, s.total, s.appels);
+    }
+
+    fclose(f);
+    return true;
+}
+
+
+/**
+ * Ecriture des statistiques au format JSON.
+ */
+bool Profilage::EcritJSON(const std::string &fichier) const
+{
+    FILE *f = fopen(fichier.c_str(), "w");
+    if (f == NULL)
+        return false;
+
+    fprintf(f, "{\n  \"iterations\": %ld,\n  \"fenetre\": %d,\n  \"phases\": [\n",
+            _NbIterations, (int)std::min<long>(_NbIterations, FENETRE));
+    for (int p = 0; p < NB_PHASES; ++p)
+    {
+        StatistiquesPhase s = Statistiques(p);
+        fprintf(f, "    {\"phase\": \"%s\", \"moyenne_ms\": %.6f, \"p50_ms\": %.6f, \"p95_ms\": %.6f, "
+                   "\"p99_ms\": %.6f, \"max_ms\": %.6f, \"total_ms\": %.3f, \"appels\": %ld}%s\n",
+                NOMS_PHASES[p], s.moyenne, s.p50, s.p95, s.p99, s.max, s.total, s.appels,
+                p + 1 < NB_PHASES ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+
+    fclose(f);
+    return true;
+}
+
+
+/**
+ * Ecriture des statistiques, au format deduit de l extension du fichier.
+ */
+bool Profilage::Ecrit(const std::string &fichier) const
+{
+    size_t n = fichier.size();
+    if (n >= 5 && fichier.compare(n - 5, 5, ".json") == 0)
+        return EcritJSON(fichier);
+    return EcritCSV(fichier);
+}
@@ -0,0 +1,186 @@
+/** \file Profilage.h
+ \brief Mesure du temps passe dans chaque phase de la simulation : chronometres de portee,
+ compteurs par thread, moyennes glissantes et centiles sur les dernieres iterations.
+ */
+
+#ifndef PROFILAGE_H
+#define PROFILAGE_H
+
+
+/** Librairies de base **/
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+
+/**
+ * \brief Phases d une iteration de la simulation.
+ */
+enum PhaseSimulation
+{
+    PHASE_VOISINS = 0,      //!< grille, listes de Verlet, reordonnancement
+    PHASE_DENSITE,          //!< reinitialisation et densites
+    PHASE_PRESSION,         //!< equation d etat, ou correction du solveur incompressible
+    PHASE_INTERACTION,      //!< forces entre particules
+    PHASE_ACCELERATION,     //!< pas de temps adaptatif (les accelerations sont calculees dans solve)
+    PHASE_SOLVE,            //!< accelerations, vitesses, positions et murs (une passe)
+    PHASE_COLLISION,        //!< collisions
+    PHASE_ITERATION,        //!< iteration complete de la scene
+    NB_PHASES
+};
+
+/// Noms des phases (affichage et fichiers)
+extern const char *NOMS_PHASES[NB_PHASES];
+
+
+/**
+ * \brief Statistiques d une phase.
+ */
+struct StatistiquesPhase
+{
+    /// Moyenne sur la fenetre glissante (ms par iteration)
+    double moyenne;
+
+    /// Centiles 50, 95 et 99 sur la fenetre glissante (ms)
+    double p50, p95, p99;
+
+    /// Maximum sur la fenetre glissante (ms)
+    double max;
+
+    /// Temps total depuis le debut (ms)
+    double total;
+
+    /// Nombre total de mesures
+    long appels;
+};
+
+
+/**
+ * \brief Profilage de la simulation (instance unique).
+ * Chaque chronometre ajoute sa duree aux compteurs du thread qui l execute (pas de
+ * synchronisation) ; FinIteration() fusionne les compteurs des threads et range la duree
+ * de chaque phase dans un historique circulaire des FENETRE dernieres iterations.
+ * Desactive, un chronometre ne coute qu un test ; compile avec MECASIM_SANS_PROFILAGE,
+ * il disparait.
+ */
+class Profilage
+{
+public:
+
+    /// Nombre d iterations de la fenetre glissante
+    static const int FENETRE = 256;
+
+    /*! Instance unique */
+    static Profilage &Instance();
+
+    /*! Activation / desactivation des mesures */
+    static void Active(bool actif) { s_Actif.store(actif, std::memory_order_relaxed); }
+
+    /*! Indique si les mesures sont actives */
+    static bool EstActif() { return s_Actif.load(std::memory_order_relaxed); }
+
+    /*! Ajout d une duree (en ns) a la phase, dans les compteurs du thread courant */
+    void Ajoute(int phase, long long ns);
+
+    /*! Fin d une iteration : fusion des compteurs des threads dans l historique */
+    void FinIteration();
+
+    /*! Statistiques d une phase */
+    StatistiquesPhase Statistiques(int phase) const;
+
+    /*! Nombre d iterations mesurees */
+    long NbIterations() const { return _NbIterations; }
+
+    /*! Ecriture des statistiques au format CSV */
+    bool EcritCSV(const std::string &fichier) const;
+
+    /*! Ecriture des statistiques au format JSON */
+    bool EcritJSON(const std::string &fichier) const;
+
+    /*! Ecriture au format JSON si le nom finit par .json, CSV sinon */
+    bool Ecrit(const std::string &fichier) const;
+
+
+private:
+
+    /*! Constructeur */
+    Profilage();
+
+    /**
+     * \brief Compteurs d un thread, sur des lignes de cache distinctes de celles des autres threads.
+     */
+    struct CompteursThread
+    {
+        long long ns[NB_PHASES];
+        int appels[NB_PHASES];
+        char remplissage[64];
+    };
+
+    /// Mesures actives (modifiable depuis le thread d affichage pendant la simulation)
+    static std::atomic<bool> s_Actif;
+
+    /// Compteurs de chaque thread pour l iteration en cours
+    std::vector<CompteursThread> _Threads;
+
+    /// Historique circulaire des durees (ms) de chaque phase
+    std::vector<float> _Historique[NB_PHASES];
+
+    /// Temps total (ms) de chaque phase
+    double _Total[NB_PHASES];
+
+    /// Nombre total de mesures de chaque phase
+    long _Appels[NB_PHASES];
+
+    /// Nombre d iterations mesurees
+    long _NbIterations;
+};
+
+
+/**
+ * \brief Chronometre de portee : mesure la duree entre sa construction et sa destruction.
+ */
+class ChronoPhase
+{
+public:
+
+    /*! Debut de la mesure */
+    explicit ChronoPhase(int phase)
+        : _Phase(phase), _Actif(Profilage::EstActif())
+    {
+        if (_Actif)
+            _Debut = std::chrono::steady_clock::now();
+    }
+
+    /*! Fin de la mesure */
+    ~ChronoPhase()
+    {
+        if (_Actif)
+            Profilage::Instance().Ajoute(_Phase, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                     std::chrono::steady_clock::now() - _Debut).count());
+    }
+
+private:
+
+    /// Phase mesuree
+    int _Phase;
+
+    /// Mesure active (etat du profilage a la construction)
+    bool _Actif;
+
+    /// Instant de debut
+    std::chrono::steady_clock::time_point _Debut;
+};
+
+
+/// Mesure de la duree de la portee courante pour la phase donnee
+#ifdef MECASIM_SANS_PROFILAGE
+#define PROFIL_PHASE(phase)
+#else
+#define PROFIL_CONCAT_(a, b) a##b
+#define PROFIL_CONCAT(a, b) PROFIL_CONCAT_(a, b)
+#define PROFIL_PHASE(phase) ChronoPhase PROFIL_CONCAT(chrono_phase_, __LINE__)(phase)
+#endif
+
+
+#endif
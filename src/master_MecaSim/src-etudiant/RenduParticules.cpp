@@ -0,0 +1,281 @@
+/** \file RenduParticules.cpp
+ \brief Affichage des particules : spheres instanciees, imposteurs ou points.
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include "glcore.h"
+#include "window.h"
+#include "program.h"
+#include "uniforms.h"
+
+#include "RenduParticules.h"
+
+
+/// Attributs par instance (ou par sommet en GL_POINTS) des shaders de particules
+const GLuint ATTRIBUT_CENTRE = 4;
+const GLuint ATTRIBUT_VALEUR = 5;
+
+
+/**
+ * Constructeur : aucun objet openGL (il faut un contexte, cf init).
+ */
+RenduParticules::RenduParticules()
+    : _Couleur(0, 0, 1), _Mode(RENDU_SPHERES), _Rayon(0.05f), _TaillePoint(3.f),
+      _Vao(0), _VaoPoints(0), _Program(0), _ProgramPoints(0),
+      _BufferSommets(0), _BufferIndices(0), _BufferCentres(0), _BufferValeurs(0),
+      _CapaciteCentres(0), _CapaciteValeurs(0), _Primitives(GL_TRIANGLES), _NbIndices(0)
+{
+}
+
+
+/**
+ * Creation des vertex arrays :
+ * - spheres : positions et indices de la sphere (attribut 0), centres (attribut 4) et valeurs (attribut 5)
+ *   avec un diviseur de 1 (une valeur par instance) ;
+ * - points : les memes buffers de centres et de valeurs, lus une fois par sommet.
+ * Le rayon des imposteurs est celui du maillage de la sphere (centree en 0).
+ */
+int RenduParticules::init(const Mesh &sphere)
+{
+    _Primitives = sphere.primitives();
+    if (sphere.vertex_count() > 0)
+        _Rayon = length(Vector(sphere.positions()[0]));
+
+    _NbIndices = sphere.index_count() > 0 ? sphere.index_count() : sphere.vertex_count();
+
+    glGenVertexArrays(1, &_Vao);
+    glBindVertexArray(_Vao);
+
+    glGenBuffers(1, &_BufferSommets);
+    glBindBuffer(GL_ARRAY_BUFFER, _BufferSommets);
+    glBufferData(GL_ARRAY_BUFFER, sphere.vertex_buffer_size(), sphere.vertex_buffer(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+
+    if (sphere.index_count() > 0)
+    {
+        glGenBuffers(1, &_BufferIndices);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _BufferIndices);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere.index_buffer_size(), sphere.index_buffer(), GL_STATIC_DRAW);
+    }
+
+    glGenBuffers(1, &_BufferCentres);
+    glBindBuffer(GL_ARRAY_BUFFER, _BufferCentres);
+    glVertexAttribPointer(ATTRIBUT_CENTRE, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glVertexAttribDivisor(ATTRIBUT_CENTRE, 1);
+    glEnableVertexAttribArray(ATTRIBUT_CENTRE);
+
+    glGenBuffers(1, &_BufferValeurs);
+    glBindBuffer(GL_ARRAY_BUFFER, _BufferValeurs);
+    glVertexAttribPointer(ATTRIBUT_VALEUR, 1, GL_FLOAT, GL_FALSE, 0, 0);
+    glVertexAttribDivisor(ATTRIBUT_VALEUR, 1);
+    glDisableVertexAttribArray(ATTRIBUT_VALEUR);
+    glVertexAttrib1f(ATTRIBUT_VALEUR, 0);
+
+    glGenVertexArrays(1, &_VaoPoints);
+    glBindVertexArray(_VaoPoints);
+
+    glBindBuffer(GL_ARRAY_BUFFER, _BufferCentres);
+    glVertexAttribPointer(ATTRIBUT_CENTRE, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(ATTRIBUT_CENTRE);
+
+    glBindBuffer(GL_ARRAY_BUFFER, _BufferValeurs);
+    glVertexAttribPointer(ATTRIBUT_VALEUR, 1, GL_FLOAT, GL_FALSE, 0, 0);
+    glDisableVertexAttribArray(ATTRIBUT_VALEUR);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    _Program = read_program(smart_path("data/shaders/particules_instances.glsl"));
+    _ProgramPoints = read_program(smart_path("data/shaders/particules_imposteurs.glsl"));
+
+    // identifiants des uniforms, une fois pour toutes : pas de recherche par nom a chaque image
+    glUseProgram(_Program);
+    _UniformsSpheres = uniforms(_Program);
+    _vpMatrix = program_uniform_handle<Transform>(_Program, "vpMatrix");
+
+    glUseProgram(_ProgramPoints);
+    _UniformsPoints = uniforms(_ProgramPoints);
+    _projectionMatrix = program_uniform_handle<Transform>(_ProgramPoints, "projectionMatrix");
+    _projectionInvMatrix = program_uniform_handle<Transform>(_ProgramPoints, "projectionInvMatrix");
+    _viewport = program_uniform_handle<vec4>(_ProgramPoints, "viewport");
+    _imposteur = program_uniform_handle<int>(_ProgramPoints, "imposteur");
+    _rayon = program_uniform_handle<float>(_ProgramPoints, "rayon");
+    _taille_point = program_uniform_handle<float>(_ProgramPoints, "taille_point");
+    glUseProgram(0);
+
+    int erreurs = program_print_errors(_Program);
+    erreurs += program_print_errors(_ProgramPoints);
+    return erreurs;
+}
+
+
+/**
+ * Destruction des objets openGL.
+ */
+void RenduParticules::release()
+{
+    release_program(_Program);
+    release_program(_ProgramPoints);
+    glDeleteBuffers(1, &_BufferSommets);
+    glDeleteBuffers(1, &_BufferIndices);
+    glDeleteBuffers(1, &_BufferCentres);
+    glDeleteBuffers(1, &_BufferValeurs);
+    glDeleteVertexArrays(1, &_Vao);
+    glDeleteVertexArrays(1, &_VaoPoints);
+
+    _Program = _ProgramPoints = _Vao = _VaoPoints = 0;
+    _BufferSommets = _BufferIndices = _BufferCentres = _BufferValeurs = 0;
+    _CapaciteCentres = _CapaciteValeurs = 0;
+}
+
+
+/**
+ * Recuperation des uniforms communs aux deux shaders.
+ */
+RenduParticules::UniformsParticules RenduParticules::uniforms(GLuint program)
+{
+    UniformsParticules u;
+    u.viewMatrix = program_uniform_handle<Transform>(program, "viewMatrix");
+    u.mesh_color = program_uniform_handle<Color>(program, "mesh_color");
+    u.use_valeur = program_uniform_handle<int>(program, "use_valeur");
+    u.valeur_min = program_uniform_handle<float>(program, "valeur_min");
+    u.valeur_max = program_uniform_handle<float>(program, "valeur_max");
+    u.light = program_uniform_handle<Point>(program, "light");
+    u.light_color = program_uniform_handle<Color>(program, "light_color");
+    return u;
+}
+
+
+/**
+ * Affectation des uniforms communs : couleur, palette et lumiere (dans le repere camera).
+ */
+void RenduParticules::uniforms(const UniformsParticules &u, bool use_valeur, float vmin, float vmax,
+                               const Transform &view, const Point &light, const Color &light_color) const
+{
+    program_uniform(u.viewMatrix, view);
+    program_uniform(u.mesh_color, _Couleur);
+    program_uniform(u.use_valeur, use_valeur ? 1 : 0);
+    program_uniform(u.valeur_min, vmin);
+    program_uniform(u.valeur_max, vmax);
+    program_uniform(u.light, view(light));
+    program_uniform(u.light_color, light_color);
+}
+
+
+/**
+ * Transfert dans un buffer d instances. Le contenu precedent est abandonne (glBufferData sans donnees)
+ * pour ne pas attendre la fin du dessin de l image precedente ; le buffer est agrandi par blocs.
+ */
+void RenduParticules::transfert(GLuint buffer, size_t &capacite, size_t taille, const void *donnees)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    if (taille > capacite)
+        capacite = taille + taille / 2;
+
+    glBufferData(GL_ARRAY_BUFFER, capacite, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, taille, donnees);
+}
+
+
+/**
+ * Dessin de toutes les particules en un seul appel, selon le mode d affichage.
+ * valeurs est utilise s il a autant d elements que centres (couleur unie sinon) ;
+ * la palette couvre alors l intervalle [min, max] des valeurs.
+ */
+void RenduParticules::draw(const std::vector<Vector> &centres, const std::vector<float> &valeurs,
+                           const Transform &view, const Transform &projection,
+                           const Point &light, const Color &light_color)
+{
+    if (_Program == 0 || centres.empty())
+        return;
+
+    GLsizei nb_instances = (GLsizei)centres.size();
+    bool use_valeur = (valeurs.size() == centres.size());
+
+    transfert(_BufferCentres, _CapaciteCentres, centres.size() * sizeof(Vector), centres.data());
+
+    float vmin = 0, vmax = 1;
+    if (use_valeur)
+    {
+        transfert(_BufferValeurs, _CapaciteValeurs, valeurs.size() * sizeof(float), valeurs.data());
+
+        vmin = vmax = valeurs[0];
+        for (unsigned int i = 1; i < valeurs.size(); ++i)
+        {
+            vmin = std::min(vmin, valeurs[i]);
+            vmax = std::max(vmax, valeurs[i]);
+        }
+    }
+
+    if (_Mode != RENDU_SPHERES)
+    {
+        draw_points(nb_instances, use_valeur, vmin, vmax, view, projection, light, light_color);
+        return;
+    }
+
+    glBindVertexArray(_Vao);
+    if (use_valeur)
+        glEnableVertexAttribArray(ATTRIBUT_VALEUR);
+    else
+        glDisableVertexAttribArray(ATTRIBUT_VALEUR);
+
+    glUseProgram(_Program);
+    program_uniform(_vpMatrix, projection * view);
+    uniforms(_UniformsSpheres, use_valeur, vmin, vmax, view, light, light_color);
+
+    // les bandes de la sphere sont separees par l indice ~0u (cf Mesh::restart_strip)
+    glPrimitiveRestartIndex(~0u);
+    glEnable(GL_PRIMITIVE_RESTART);
+
+    if (_BufferIndices)
+        glDrawElementsInstanced(_Primitives, _NbIndices, GL_UNSIGNED_INT, 0, nb_instances);
+    else
+        glDrawArraysInstanced(_Primitives, 0, _NbIndices, nb_instances);
+
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Dessin des particules en GL_POINTS, un sommet par particule.
+ * Imposteurs : la taille du point couvre la projection de la sphere et le fragment shader
+ * lance un rayon depuis la camera (il a besoin de l inverse de la projection et du viewport).
+ * Points : taille fixe en pixels.
+ */
+void RenduParticules::draw_points(GLsizei nb_points, bool use_valeur, float vmin, float vmax,
+                                  const Transform &view, const Transform &projection,
+                                  const Point &light, const Color &light_color)
+{
+    if (_ProgramPoints == 0)
+        return;
+
+    glBindVertexArray(_VaoPoints);
+    if (use_valeur)
+        glEnableVertexAttribArray(ATTRIBUT_VALEUR);
+    else
+        glDisableVertexAttribArray(ATTRIBUT_VALEUR);
+    glVertexAttrib1f(ATTRIBUT_VALEUR, 0);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glUseProgram(_ProgramPoints);
+    program_uniform(_projectionMatrix, projection);
+    program_uniform(_projectionInvMatrix, projection.inverse());
+    program_uniform(_viewport, vec4((float)viewport[0], (float)viewport[1], (float)viewport[2], (float)viewport[3]));
+    program_uniform(_imposteur, _Mode == RENDU_IMPOSTEURS ? 1 : 0);
+    program_uniform(_rayon, _Rayon);
+    program_uniform(_taille_point, _TaillePoint);
+    uniforms(_UniformsPoints, use_valeur, vmin, vmax, view, light, light_color);
+
+    // taille des points calculee par le vertex shader
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glDrawArrays(GL_POINTS, 0, nb_points);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+
+    glBindVertexArray(0);
+}
@@ -0,0 +1,141 @@
+/** \file RenduParticules.h
+ \brief Affichage des particules en un seul appel de dessin : spheres instanciees,
+ imposteurs (spheres lancees par rayon dans des GL_POINTS) ou simples points.
+ */
+
+#ifndef RENDU_PARTICULES_H
+#define RENDU_PARTICULES_H
+
+
+/** Librairies de base **/
+#include <vector>
+
+// Fichiers de gkit2light
+#include "glcore.h"
+#include "vec.h"
+#include "mat.h"
+#include "color.h"
+#include "mesh.h"
+#include "uniforms.h"
+
+
+/**
+ * \brief Mode d affichage des particules.
+ */
+enum ModeRendu
+{
+    RENDU_SPHERES = 0,      //!< maillage de sphere instancie (quelques centaines de sommets par particule)
+    RENDU_IMPOSTEURS,       //!< un sommet par particule, sphere lancee par rayon dans le fragment shader
+    RENDU_POINTS,           //!< un sommet par particule, point de taille fixe sans eclairage
+    NB_MODES_RENDU
+};
+
+
+/**
+ * \brief Affichage des particules.
+ * Mode RENDU_SPHERES :
+ * Les sommets et les indices de la sphere sont copies une fois dans un vertex array ;
+ * les centres des particules (et la valeur servant a la coloration) sont transferes a chaque image
+ * dans des buffers d instances, puis toutes les spheres sont dessinees par un seul glDrawElementsInstanced.
+ * Modes RENDU_IMPOSTEURS et RENDU_POINTS : les memes buffers servent de sommets a un glDrawArrays(GL_POINTS) ;
+ * les imposteurs calculent l intersection du rayon de vue et de la sphere, et ecrivent la profondeur du point
+ * touche pour se melanger correctement avec le reste de la scene.
+ */
+class RenduParticules
+{
+public:
+
+    /*! Constructeur (les objets openGL sont crees par init) */
+    RenduParticules();
+
+    /*! Creation des vertex arrays et des shaders a partir du maillage de la sphere */
+    int init(const Mesh &sphere);
+
+    /*! Destruction des objets openGL */
+    void release();
+
+    /*! Dessin des particules centrees en centres[i], colorees selon valeurs[i] si valeurs n est pas vide */
+    void draw(const std::vector<Vector> &centres, const std::vector<float> &valeurs,
+              const Transform &view, const Transform &projection,
+              const Point &light, const Color &light_color);
+
+
+    /// Couleur unie des spheres
+    Color _Couleur;
+
+    /// Mode d affichage
+    ModeRendu _Mode;
+
+    /// Rayon des imposteurs (rayon du maillage de la sphere par defaut)
+    float _Rayon;
+
+    /// Taille (pixels) des points en mode RENDU_POINTS
+    float _TaillePoint;
+
+
+protected:
+
+    /*! Transfert de donnees dans un buffer d instances, agrandi si necessaire */
+    void transfert(GLuint buffer, size_t &capacite, size_t taille, const void *donnees);
+
+    /**
+     * \brief Uniforms communs aux deux shaders, recuperes une fois apres la creation des programs.
+     */
+    struct UniformsParticules
+    {
+        UniformHandle<Transform> viewMatrix;
+        UniformHandle<Color> mesh_color;
+        UniformHandle<int> use_valeur;
+        UniformHandle<float> valeur_min, valeur_max;
+        UniformHandle<Point> light;
+        UniformHandle<Color> light_color;
+    };
+
+    /*! Recuperation des uniforms communs d un program */
+    static UniformsParticules uniforms(GLuint program);
+
+    /*! Affectation des uniforms communs (le program doit etre selectionne) */
+    void uniforms(const UniformsParticules &u, bool use_valeur, float vmin, float vmax,
+                  const Transform &view, const Point &light, const Color &light_color) const;
+
+    /*! Dessin en GL_POINTS (imposteurs ou points) */
+    void draw_points(GLsizei nb_points, bool use_valeur, float vmin, float vmax,
+                     const Transform &view, const Transform &projection,
+                     const Point &light, const Color &light_color);
+
+    /// Vertex array : sommets de la sphere + attributs par instance
+    GLuint _Vao;
+
+    /// Vertex array des modes GL_POINTS : centres et valeurs par sommet
+    GLuint _VaoPoints;
+
+    /// Shader d affichage instancie
+    GLuint _Program;
+
+    /// Shader des imposteurs et des points
+    GLuint _ProgramPoints;
+
+    /// Uniforms des deux shaders
+    UniformsParticules _UniformsSpheres, _UniformsPoints;
+    UniformHandle<Transform> _vpMatrix;
+    UniformHandle<Transform> _projectionMatrix, _projectionInvMatrix;
+    UniformHandle<vec4> _viewport;
+    UniformHandle<int> _imposteur;
+    UniformHandle<float> _rayon, _taille_point;
+
+    /// Buffer des sommets et des indices de la sphere
+    GLuint _BufferSommets, _BufferIndices;
+
+    /// Buffers par instance : centres et valeurs
+    GLuint _BufferCentres, _BufferValeurs;
+
+    /// Capacite (octets) des buffers par instance
+    size_t _CapaciteCentres, _CapaciteValeurs;
+
+    /// Primitives et nombre d indices de la sphere
+    GLenum _Primitives;
+    GLsizei _NbIndices;
+};
+
+
+#endif
@@ -0,0 +1,300 @@
+/** \file Reprise.cpp
+ \brief Ecriture et lecture des fichiers de reprise.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "Reprise.h"
+
+
+/**
+ * Destructeur : un fichier non ferme (erreur, interruption) est supprime,
+ * la reprise precedente reste intacte.
+ */
+EcritureReprise::~EcritureReprise()
+{
+    if (_Fichier)
+    {
+        fclose(_Fichier);
+        remove(_NomTemporaire.c_str());
+    }
+}
+
+
+/**
+ * Ouverture du fichier temporaire et ecriture de l entete.
+ */
+bool EcritureReprise::Ouvre(const std::string &fichier, int nb_objets, int iteration)
+{
+    _Nom = fichier;
+    _NomTemporaire = fichier + ".tmp";
+    _Position = 0;
+    _Erreur = false;
+
+    _Fichier = fopen(_NomTemporaire.c_str(), "wb");
+    if (_Fichier == NULL)
+    {
+        std::cout << "Reprise : impossible de creer " << _NomTemporaire << std::endl;
+        return false;
+    }
+
+    EnteteReprise entete;
+    memset(&entete, 0, sizeof(entete));
+    memcpy(entete.magie, MAGIE_REPRISE, sizeof(entete.magie));
+    entete.version = VERSION_REPRISE;
+    entete.boutisme = BOUTISME_REPRISE;
+    entete.nb_objets = nb_objets;
+    entete.iteration = iteration;
+
+    Ecrit(&entete, sizeof(entete));
+    return !_Erreur;
+}
+
+
+/**
+ * Ecriture d un bloc et suivi de la position.
+ */
+void EcritureReprise::Ecrit(const void *donnees, size_t octets)
+{
+    if (_Fichier == NULL || octets == 0)
+        return;
+
+    if (fwrite(donnees, 1, octets, _Fichier) != octets)
+        _Erreur = true;
+    _Position += octets;
+}
+
+
+/**
+ * Ecriture de l entete d un objet.
+ */
+void EcritureReprise::Objet(const EnteteObjetReprise &entete)
+{
+    Ecrit(&entete, sizeof(entete));
+}
+
+
+/**
+ * Ecriture d un tableau : descripteur, bourrage, puis les donnees d un seul bloc.
+ */
+void EcritureReprise::Tableau(const char *nom, const void *donnees, size_t octets)
+{
+    DescripteurTableau descripteur;
+    memset(&descripteur, 0, sizeof(descripteur));
+    strncpy(descripteur.nom, nom, sizeof(descripteur.nom) - 1);
+    descripteur.octets = octets;
+    Ecrit(&descripteur, sizeof(descripteur));
+
+    static const char zeros[ALIGNEMENT_REPRISE] = {0};
+    size_t reste = _Position % ALIGNEMENT_REPRISE;
+    if (reste)
+        Ecrit(zeros, ALIGNEMENT_REPRISE - reste);
+
+    Ecrit(donnees, octets);
+}
+
+
+/**
+ * Fermeture : le fichier temporaire remplace le fichier final seulement si tout a ete ecrit.
+ */
+bool EcritureReprise::Ferme()
+{
+    if (_Fichier == NULL)
+        return false;
+
+    if (fflush(_Fichier) != 0)
+        _Erreur = true;
+    if (fclose(_Fichier) != 0)
+        _Erreur = true;
+    _Fichier = NULL;
+
+    if (_Erreur)
+    {
+        std::cout << "Reprise : erreur d ecriture de " << _NomTemporaire << std::endl;
+        remove(_NomTemporaire.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    // rename ne remplace pas un fichier existant sous Windows
+    remove(_Nom.c_str());
+#endif
+    if (rename(_NomTemporaire.c_str(), _Nom.c_str()) != 0)
+    {
+        std::cout << "Reprise : impossible de renommer " << _NomTemporaire << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Destructeur.
+ */
+LectureReprise::~LectureReprise()
+{
+    Ferme();
+}
+
+
+/**
+ * Fin de la projection du fichier.
+ */
+void LectureReprise::Ferme()
+{
+#ifndef _WIN32
+    if (_Donnees)
+        munmap((void *)_Donnees, _Taille);
+#else
+    _Contenu.clear();
+#endif
+    _Donnees = NULL;
+    _Taille = 0;
+    _Position = 0;
+}
+
+
+/**
+ * Projection du fichier en memoire (lecture seule) et verification de l entete :
+ * identification, version du format et boutisme.
+ */
+bool LectureReprise::Ouvre(const std::string &fichier)
+{
+    Ferme();
+
+#ifndef _WIN32
+    int fd = open(fichier.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cout << "Reprise : impossible d ouvrir " << fichier << std::endl;
+        return false;
+    }
+
+    struct stat infos;
+    if (fstat(fd, &infos) != 0 || infos.st_size < (off_t)sizeof(EnteteReprise))
+    {
+        std::cout << "Reprise : fichier " << fichier << " vide ou illisible" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    void *p = mmap(NULL, infos.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        std::cout << "Reprise : impossible de projeter " << fichier << std::endl;
+        return false;
+    }
+
+    // lecture sequentielle des tableaux
+    madvise(p, infos.st_size, MADV_SEQUENTIAL);
+
+    _Donnees = (const char *)p;
+    _Taille = infos.st_size;
+#else
+    std::ifstream in(fichier.c_str(), std::ios::binary);
+    std::stringstream contenu;
+    contenu << in.rdbuf();
+    _Contenu = contenu.str();
+    if (_Contenu.size() < sizeof(EnteteReprise))
+    {
+        std::cout << "Reprise : fichier " << fichier << " vide ou illisible" << std::endl;
+        return false;
+    }
+    _Donnees = _Contenu.data();
+    _Taille = _Contenu.size();
+#endif
+
+    const EnteteReprise &entete = Entete();
+    if (memcmp(entete.magie, MAGIE_REPRISE, sizeof(entete.magie)) != 0)
+    {
+        std::cout << "Reprise : " << fichier << " n est pas un fichier de reprise" << std::endl;
+        Ferme();
+        return false;
+    }
+    if (entete.boutisme != BOUTISME_REPRISE)
+    {
+        std::cout << "Reprise : " << fichier << " a ete ecrit sur une machine de boutisme different" << std::endl;
+        Ferme();
+        return false;
+    }
+    if (entete.version != VERSION_REPRISE)
+    {
+        std::cout << "Reprise : version " << entete.version << " de " << fichier
+                  << " non supportee (version attendue : " << VERSION_REPRISE << ")" << std::endl;
+        Ferme();
+        return false;
+    }
+
+    _Position = sizeof(EnteteReprise);
+    return true;
+}
+
+
+/**
+ * Bloc suivant du fichier.
+ */
+const char *LectureReprise::Lit(size_t octets)
+{
+    if (_Donnees == NULL || octets > _Taille - _Position)
+        return NULL;
+
+    const char *p = _Donnees + _Position;
+    _Position += octets;
+    return p;
+}
+
+
+/**
+ * Entete de l objet suivant.
+ */
+const EnteteObjetReprise *LectureReprise::Objet()
+{
+    const EnteteObjetReprise *entete = (const EnteteObjetReprise *)Lit(sizeof(EnteteObjetReprise));
+    if (entete == NULL)
+        std::cout << "Reprise : fichier tronque (entete d objet)" << std::endl;
+    return entete;
+}
+
+
+/**
+ * Tableau suivant : le nom et la taille doivent correspondre a ceux attendus.
+ */
+const void *LectureReprise::Tableau(const char *nom, size_t octets)
+{
+    const DescripteurTableau *descripteur = (const DescripteurTableau *)Lit(sizeof(DescripteurTableau));
+    if (descripteur == NULL)
+    {
+        std::cout << "Reprise : fichier tronque (tableau " << nom << ")" << std::endl;
+        return NULL;
+    }
+
+    if (strncmp(descripteur->nom, nom, sizeof(descripteur->nom)) != 0 || descripteur->octets != octets)
+    {
+        std::cout << "Reprise : tableau " << nom << " attendu (" << octets << " octets), "
+                  << std::string(descripteur->nom, strnlen(descripteur->nom, sizeof(descripteur->nom)))
+                  << " trouve (" << descripteur->octets << " octets)" << std::endl;
+        return NULL;
+    }
+
+    size_t reste = _Position % ALIGNEMENT_REPRISE;
+    if (reste && Lit(ALIGNEMENT_REPRISE - reste) == NULL)
+        return NULL;
+
+    const void *donnees = Lit(octets);
+    if (donnees == NULL)
+        std::cout << "Reprise : fichier tronque (donnees du tableau " << nom << ")" << std::endl;
+    return donnees;
+}
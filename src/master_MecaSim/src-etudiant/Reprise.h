@@ -0,0 +1,163 @@
+/** \file Reprise.h
+ \brief Fichiers de reprise : sauvegarde binaire de l etat de la simulation et rechargement
+ (projection en memoire du fichier) pour poursuivre un calcul ou repartir d un etat etabli.
+ */
+
+#ifndef REPRISE_H
+#define REPRISE_H
+
+
+/** Librairies de base **/
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+
+/// Identification d un fichier de reprise
+const char MAGIE_REPRISE[8] = {'M', 'E', 'C', 'A', 'S', 'I', 'M', 'R'};
+
+/// Version du format ; a incrementer a chaque modification des structures ci-dessous
+const uint32_t VERSION_REPRISE = 1;
+
+/// Valeur ecrite pour detecter un fichier produit par une machine d un autre boutisme
+const uint32_t BOUTISME_REPRISE = 0x01020304;
+
+/// Alignement (octets) du debut des donnees de chaque tableau dans le fichier
+const size_t ALIGNEMENT_REPRISE = 64;
+
+
+/**
+ * \brief Entete du fichier.
+ * Format : EnteteReprise, puis pour chaque objet un EnteteObjetReprise suivi de ses nb_tableaux
+ * tableaux (DescripteurTableau, bourrage jusqu a un multiple de ALIGNEMENT_REPRISE, donnees brutes).
+ */
+struct EnteteReprise
+{
+    char magie[8];
+    uint32_t version;
+    uint32_t boutisme;
+    uint32_t nb_objets;
+    int32_t iteration;          //!< iterations de la scene deja calculees
+};
+
+/**
+ * \brief Entete d un objet : type, nombre de particules et grandeurs scalaires de l etat.
+ */
+struct EnteteObjetReprise
+{
+    char type[16];              //!< "sph"
+    int32_t nb_particules;
+    int32_t nb_tableaux;
+    int32_t pas;                //!< pas de temps effectues
+    float temps;                //!< temps simule
+    float h, rho0, bulk;
+    float dt, dt_prec;          //!< pas de temps courant et precedent du solveur
+};
+
+/**
+ * \brief Description d un tableau : nom et taille des donnees en octets.
+ */
+struct DescripteurTableau
+{
+    char nom[16];
+    uint64_t octets;
+};
+
+
+/**
+ * \brief Ecriture d un fichier de reprise.
+ * Chaque tableau est ecrit d un seul bloc ; le fichier est d abord ecrit sous un nom temporaire
+ * puis renomme, pour qu une interruption pendant l ecriture ne detruise pas la reprise precedente.
+ */
+class EcritureReprise
+{
+public:
+
+    /*! Constructeur */
+    EcritureReprise() : _Fichier(NULL), _Position(0), _Erreur(false) {}
+
+    /*! Destructeur : abandon du fichier temporaire s il n a pas ete ferme */
+    ~EcritureReprise();
+
+    /*! Ouverture et ecriture de l entete */
+    bool Ouvre(const std::string &fichier, int nb_objets, int iteration);
+
+    /*! Ecriture de l entete d un objet */
+    void Objet(const EnteteObjetReprise &entete);
+
+    /*! Ecriture d un tableau */
+    void Tableau(const char *nom, const void *donnees, size_t octets);
+
+    /*! Fermeture et remplacement du fichier final ; renvoie faux en cas d erreur d ecriture */
+    bool Ferme();
+
+private:
+
+    /*! Ecriture d un bloc */
+    void Ecrit(const void *donnees, size_t octets);
+
+    /// Fichier temporaire en cours d ecriture
+    FILE *_Fichier;
+
+    /// Noms du fichier final et du fichier temporaire
+    std::string _Nom, _NomTemporaire;
+
+    /// Octets deja ecrits
+    size_t _Position;
+
+    /// Erreur d ecriture
+    bool _Erreur;
+};
+
+
+/**
+ * \brief Lecture d un fichier de reprise projete en memoire (mmap).
+ * Les entetes et les tableaux sont lus dans l ordre d ecriture ; les pointeurs renvoyes
+ * designent directement le fichier projete et restent valides jusqu a la destruction.
+ */
+class LectureReprise
+{
+public:
+
+    /*! Constructeur */
+    LectureReprise() : _Donnees(NULL), _Taille(0), _Position(0) {}
+
+    /*! Destructeur : fin de la projection */
+    ~LectureReprise();
+
+    /*! Projection du fichier et verification de l entete */
+    bool Ouvre(const std::string &fichier);
+
+    /*! Entete du fichier */
+    const EnteteReprise &Entete() const { return *(const EnteteReprise *)_Donnees; }
+
+    /*! Entete de l objet suivant (NULL si le fichier est tronque) */
+    const EnteteObjetReprise *Objet();
+
+    /*! Donnees du tableau suivant, s il porte ce nom et a cette taille (NULL sinon) */
+    const void *Tableau(const char *nom, size_t octets);
+
+private:
+
+    /*! Lecture d un bloc de taille octets a la position courante (NULL si le fichier est tronque) */
+    const char *Lit(size_t octets);
+
+    /*! Liberation de la projection */
+    void Ferme();
+
+    /// Fichier projete
+    const char *_Donnees;
+    size_t _Taille;
+
+    /// Position de lecture
+    size_t _Position;
+
+#ifdef _WIN32
+    /// Sous Windows, le fichier est lu en memoire
+    std::string _Contenu;
+#endif
+};
+
+
+#endif
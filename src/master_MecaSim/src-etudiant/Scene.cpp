@@ -37,6 +37,7 @@ Appel des differentes fonctions sur l'ensemble des noeuds du graphe de scene.
 /** Fichiers de l application **/
 #include "Noeuds.h"
 #include "Scene.h"
+#include "Profilage.h"
 
 
 
@@ -57,6 +58,19 @@ Scene::Scene(std::string Fichier_Param, int NbObj)
 
 
 
+/**
+ * Destructeur : les enfants attaches a la scene sont detruits avec elle
+ * (fermeture des fichiers de trajectoire).
+ */
+Scene::~Scene()
+{
+	ListeNoeuds::iterator e;
+	for(e=_enfants.begin(); e!=_enfants.end(); e++)
+		delete *e;
+	_enfants.clear();
+}
+
+
 /**
 * Ajoute un enfant dans le graphe de scene. 
  */
@@ -148,12 +162,19 @@ void Scene::Simulation(int Tps)
 {
 	//std::cout << "----------------- Scene::Simulation()-------------" << std::endl;
     
-	ListeNoeuds::iterator e;
-	
-	for(e=_enfants.begin(); e!=_enfants.end(); e++)
 	{
-		(*e)->Simulation(_g, _visco, Tps);
+		PROFIL_PHASE(PHASE_ITERATION);
+		
+		ListeNoeuds::iterator e;
+		
+		for(e=_enfants.begin(); e!=_enfants.end(); e++)
+		{
+			(*e)->Simulation(_g, _visco, Tps);
+		}
 	}
+	
+	// Duree de chaque phase pour cette iteration
+	Profilage::Instance().FinIteration();
 }
 
 
@@ -209,3 +230,55 @@ void Scene::setVisco(float visco)
 	// Viscosite du milieu
 	_visco = visco;
 }
+
+
+/**
+ * Ecriture de l etat de chacun des enfants dans un fichier de reprise.
+ */
+bool Scene::Sauvegarde(const std::string &fichier, int Tps) const
+{
+	EcritureReprise f;
+	if (!f.Ouvre(fichier, (int)_enfants.size(), Tps))
+		return false;
+	
+	ListeNoeuds::const_iterator e;
+	for(e=_enfants.begin(); e!=_enfants.end(); e++)
+	{
+		if (!(*e)->EcritReprise(f))
+		{
+			std::cout << "Reprise : l objet " << (*e)->getName() << " ne peut pas etre sauvegarde" << std::endl;
+			return false;
+		}
+	}
+	
+	return f.Ferme();
+}
+
+
+/**
+ * Lecture de l etat de chacun des enfants depuis un fichier de reprise :
+ * meme nombre d objets, dans le meme ordre, que lors de la sauvegarde.
+ */
+bool Scene::Reprise(const std::string &fichier, int &Tps)
+{
+	LectureReprise f;
+	if (!f.Ouvre(fichier))
+		return false;
+	
+	if (f.Entete().nb_objets != _enfants.size())
+	{
+		std::cout << "Reprise : " << f.Entete().nb_objets << " objets dans " << fichier
+				  << ", " << _enfants.size() << " dans la scene" << std::endl;
+		return false;
+	}
+	
+	ListeNoeuds::iterator e;
+	for(e=_enfants.begin(); e!=_enfants.end(); e++)
+	{
+		if (!(*e)->LitReprise(f))
+			return false;
+	}
+	
+	Tps = f.Entete().iteration;
+	return true;
+}
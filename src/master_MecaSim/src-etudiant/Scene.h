@@ -89,9 +89,15 @@ public:
 	
 	/*! Interation de l utilisateur avec chacun des enfants */
 	void Interaction(Vector MousePos);
+	
+	/*! Ecriture de l etat de tous les enfants dans un fichier de reprise, apres Tps iterations */
+	bool Sauvegarde(const std::string &fichier, int Tps) const;
+	
+	/*! Lecture de l etat de tous les enfants ; Tps recoit le nombre d iterations deja calculees */
+	bool Reprise(const std::string &fichier, int &Tps);
 		
-	/*! Destructeur */
-	virtual ~Scene(){};
+	/*! Destructeur : destruction des enfants */
+	virtual ~Scene();
 	
 	
 public:
@@ -108,6 +114,9 @@ public:
 	/// Nombre d iterations de la boucle de simulation 
 	int _nb_iter;
     
+    /// Simulation dans un thread separe de l affichage (cf SimulationAsynchrone)
+    bool _Asynchrone;
+    
     /// Type d objet simule
     std::string _type_objet[NB_OBJ_MAX];
     
@@ -0,0 +1,132 @@
+/** \file SimulationAsynchrone.cpp
+ \brief Simulation de la scene dans un thread separe de l affichage.
+ */
+
+#include <iostream>
+
+#include "SimulationAsynchrone.h"
+
+
+/**
+ * Constructeur : l etat initial est publie pour que la premiere image affichee soit valide.
+ */
+SimulationAsynchrone::SimulationAsynchrone(Scene *scene)
+    : _Scene(scene), _Arret(false), _Coloration(CHAMP_AUCUN), _Deplacement(0, 0, 0), _Tps(0)
+{
+    Capture(*_Scene, CHAMP_AUCUN, 0, _Images.Ecriture());
+    _Images.Publie();
+}
+
+
+/**
+ * Destructeur.
+ */
+SimulationAsynchrone::~SimulationAsynchrone()
+{
+    Arret();
+}
+
+
+/**
+ * Lancement du thread de simulation.
+ */
+void SimulationAsynchrone::Demarre()
+{
+    if (_Thread.joinable())
+        return;
+
+    _Arret.store(false);
+    _Thread = std::thread(&SimulationAsynchrone::Boucle, this);
+}
+
+
+/**
+ * Arret du thread : l iteration en cours se termine.
+ */
+void SimulationAsynchrone::Arret()
+{
+    _Arret.store(true);
+    if (_Thread.joinable())
+        _Thread.join();
+}
+
+
+/**
+ * Accumulation des deplacements du point d interaction demandes par le viewer.
+ */
+void SimulationAsynchrone::Interaction(const Vector &MousePos)
+{
+    std::lock_guard<std::mutex> verrou(_MutexInteraction);
+    _Deplacement = _Deplacement + MousePos;
+}
+
+
+/**
+ * Copie de l etat de la scene : positions de chaque enfant (cf updateVertex),
+ * grandeur de coloration des ObjetSimule, et statistiques du profilage s il est actif.
+ */
+void SimulationAsynchrone::Capture(Scene &scene, ChampScalaire champ, int iteration, ImageSimulation &image)
+{
+    image.objets.resize(scene._enfants.size());
+    image.iteration = iteration;
+
+    int i = 0;
+    ListeNoeuds::iterator e;
+    for (e = scene._enfants.begin(); e != scene._enfants.end(); e++, i++)
+    {
+        image.objets[i].P = (*e)->P;
+
+        ObjetSimule *objet = dynamic_cast<ObjetSimule *>(*e);
+        if (objet)
+            objet->ChampAffichage(champ, image.objets[i].valeurs);
+        else
+            image.objets[i].valeurs.clear();
+    }
+
+    image.profilage = Profilage::EstActif();
+    if (image.profilage)
+    {
+        Profilage &profil = Profilage::Instance();
+        image.nb_iterations_profil = profil.NbIterations();
+        for (int p = 0; p < NB_PHASES; p++)
+            image.phases[p] = profil.Statistiques(p);
+    }
+}
+
+
+/**
+ * Boucle du thread : iterations de la scene jusqu a l arret ou au nombre d iterations
+ * du fichier de parametres, publication d une image apres chacune.
+ */
+void SimulationAsynchrone::Boucle()
+{
+    while (!_Arret.load(std::memory_order_relaxed) && _Tps < _Scene->_nb_iter)
+    {
+        Vector deplacement;
+        {
+            std::lock_guard<std::mutex> verrou(_MutexInteraction);
+            deplacement = _Deplacement;
+            _Deplacement = Vector(0, 0, 0);
+        }
+
+        /// Interaction avec l utilisateur
+        _Scene->Interaction(deplacement);
+
+        /// Calcul de l animation
+        _Scene->Simulation(_Tps);
+
+        /// Mise a jour des positions affichees
+        ListeNoeuds::iterator e;
+        for (e = _Scene->_enfants.begin(); e != _Scene->_enfants.end(); e++)
+            (*e)->updateVertex();
+
+        /// Le temps qui passe...
+        _Tps = _Tps + 1;
+
+        Capture(*_Scene, ChampScalaire(_Coloration.load(std::memory_order_relaxed)), _Tps, _Images.Ecriture());
+        _Images.Publie();
+    }
+
+    if (_Tps >= _Scene->_nb_iter)
+        std::cout << "Simulation terminee : " << _Tps << " iterations" << std::endl;
+}
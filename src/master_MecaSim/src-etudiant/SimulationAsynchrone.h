@@ -0,0 +1,122 @@
+/** \file SimulationAsynchrone.h
+ \brief Simulation de la scene dans un thread separe de l affichage.
+ */
+
+#ifndef SIMULATION_ASYNCHRONE_H
+#define SIMULATION_ASYNCHRONE_H
+
+
+/** Librairies de base **/
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// Fichiers de gkit2light
+#include "vec.h"
+
+// Fichiers de master_meca_sim
+#include "Scene.h"
+#include "ObjetSimule.h"
+#include "Profilage.h"
+#include "TripleBuffer.h"
+
+
+/**
+ * \brief Etat d un objet de la scene a la fin d une iteration : ce dont l affichage a besoin.
+ */
+struct ImageObjet
+{
+    /// Positions des particules (par identifiant persistant, comme Noeud::P)
+    std::vector<Vector> P;
+
+    /// Valeurs de la grandeur choisie pour la coloration (vide : couleur unie)
+    std::vector<float> valeurs;
+};
+
+
+/**
+ * \brief Etat de la scene a la fin d une iteration.
+ */
+struct ImageSimulation
+{
+    ImageSimulation() : iteration(0), profilage(false), nb_iterations_profil(0) {}
+
+    /// Un etat par enfant de la scene, dans l ordre de Scene::_enfants
+    std::vector<ImageObjet> objets;
+
+    /// Nombre d iterations calculees
+    int iteration;
+
+    /// Statistiques du profilage (si profilage est vrai)
+    bool profilage;
+    long nb_iterations_profil;
+    StatistiquesPhase phases[NB_PHASES];
+};
+
+
+/**
+ * \brief Simulation de la scene dans son propre thread.
+ * Le thread enchaine les iterations sans attendre l affichage ; a la fin de chacune, il copie
+ * les positions (et la grandeur de coloration) dans un triple tampon. Le viewer lit sans verrou
+ * l image la plus recente : un affichage lent ne ralentit pas la simulation, et une iteration lente
+ * ne bloque pas l affichage, qui redessine la derniere image terminee.
+ */
+class SimulationAsynchrone
+{
+public:
+
+    /*! Constructeur : l etat initial de la scene est publie, le thread n est pas lance */
+    SimulationAsynchrone(Scene *scene);
+
+    /*! Destructeur : arret du thread */
+    ~SimulationAsynchrone();
+
+    /*! Lancement du thread de simulation */
+    void Demarre();
+
+    /*! Arret du thread de simulation (a la fin de l iteration en cours) */
+    void Arret();
+
+    /*! Derniere image publiee (thread d affichage uniquement) */
+    const ImageSimulation &Lecture() { return _Images.Lecture(); }
+
+    /*! Grandeur utilisee pour colorer les particules des prochaines images */
+    void Coloration(ChampScalaire champ) { _Coloration.store(champ, std::memory_order_relaxed); }
+
+    /*! Deplacement du point d interaction, applique avant la prochaine iteration */
+    void Interaction(const Vector &MousePos);
+
+    /*! Copie de l etat de la scene dans une image */
+    static void Capture(Scene &scene, ChampScalaire champ, int iteration, ImageSimulation &image);
+
+private:
+
+    /*! Boucle du thread de simulation */
+    void Boucle();
+
+    /// Scene simulee (modifiee uniquement par le thread de simulation une fois lance)
+    Scene *_Scene;
+
+    /// Thread de simulation
+    std::thread _Thread;
+
+    /// Demande d arret
+    std::atomic<bool> _Arret;
+
+    /// Grandeur de coloration choisie par le viewer
+    std::atomic<int> _Coloration;
+
+    /// Deplacements du point d interaction accumules depuis la derniere iteration
+    std::mutex _MutexInteraction;
+    Vector _Deplacement;
+
+    /// Images publiees par la simulation
+    TripleBuffer<ImageSimulation> _Images;
+
+    /// Le temps
+    int _Tps;
+};
+
+
+#endif
@@ -29,68 +29,396 @@
 #include <math.h>
 #include <vector>
 #include <iostream>
+#include <algorithm>
 
 #include "vec.h"
 #include "ObjetSimule.h"
-#include "Viewer.h"
 #include "SolveurExpl.h"
 
 using namespace std;
 
 /**
- * Calcul de l acceleration des particules
- * avec ajout de la gravite aux forces des particules
- * et ajout de la force due au vent sur une des particules du maillage
- * et reinitialisation des forces.
+ * Rebonds sur les murs des particules [debut, fin) d un bloc qui vient d etre integre :
+ * boucle scalaire sur des donnees encore dans le cache, ou seules les particules sorties
+ * du domaine (rares, branche bien predite) appellent RebondMurs.
  */
-void SolveurExpl::CalculAccel_ForceGravite(Vector g,
-                                           int nb_som,
-                                           std::vector<Vector> &A,
-                                           std::vector<Vector> &Force,
-                                           std::vector<float> &M)
+static void RebondMursBloc(const MursDomaine &murs, int debut, int fin, ParticleStore &part)
 {
+    float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+
+    const float xmin = murs[0][0], xmax = murs[0][1];
+    const float ymin = murs[1][0], ymax = murs[1][1];
+    const float zmin = murs[2][0], zmax = murs[2][1];
+
+    for (int i = debut; i < fin; i++)
+        if (px[i] < xmin || px[i] > xmax || py[i] < ymin || py[i] > ymax || pz[i] < zmin || pz[i] > zmax)
+            RebondMurs(murs, px[i], py[i], pz[i], vx[i], vy[i], vz[i], wx[i], wy[i], wz[i]);
+}
+
+/**
+ * Calcul du pas de temps stable a partir de l etat courant (forces calculees, acceleration
+ * F + g, les forces etant deja divisees par la masse volumique) :
+ *  dt_cfl   = coef_cfl h / (c + |v|max)   (une particule parcourt moins d une fraction de h,
+ *                                         une onde de pression aussi),
+ *  dt_force = coef_force sqrt(h / |a|max),
+ *  dt_visco = coef_visco h^2 / nu.
+ * Le minimum est borne par [dt_min, dt_max], puis par la duree restante duree_max :
+ * si cette duree est inferieure a deux pas, elle est partagee en deux pas egaux
+ * (pas de dernier pas minuscule).
+ */
+float SolveurExpl::CalculPasAdaptatif(float h, float c_son, float nu, float duree_max, Vector g,
+                                      int nb_som, const ParticleStore &part)
+{
+    const float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    const float *fx = part.Force.x.data(), *fy = part.Force.y.data(), *fz = part.Force.z.data();
+    float v2max = 0, a2max = 0;
+
+#pragma omp parallel for simd reduction(max : v2max, a2max)
     for (int i = 0; i < nb_som; ++i)
     {
-        // On a calcule dans Force[i] : fij / rho_i
-        // Il ne reste qu'à ajouter le vecteur g de la gravité
-        A[i] = Force[i] + g;
-        Force[i] = Vector();
+        const float ax = fx[i] + g.x, ay = fy[i] + g.y, az = fz[i] + g.z;
+        v2max = std::max(v2max, vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+        a2max = std::max(a2max, ax * ax + ay * ay + az * az);
     }
 
-} //void
+    float dt = _dt_max;
+    dt = std::min(dt, _CoefCFL * h / (c_son + sqrtf(v2max)));
+    if (a2max > 0)
+        dt = std::min(dt, _CoefForce * sqrtf(h / sqrtf(a2max)));
+    if (nu > 0)
+        dt = std::min(dt, _CoefViscosite * h * h / nu);
+    dt = std::max(dt, _dt_min);
+
+    if (duree_max <= dt)
+        dt = duree_max;
+    else if (duree_max < 2 * dt)
+        dt = duree_max / 2;
+
+    _delta_t = dt;
+    return dt;
+}
 
-void SolveurExpl::CalculPremierPas(
+/**
+ * Creation du schema d integration : explicite (historique) est le saute-mouton.
+ */
+SolveurExpl *SolveurExpl::Cree(const std::string &integration)
+{
+    if (integration == "euler_symplectique")
+        return new SolveurEulerSymplectique();
+    if (integration == "saute_mouton" || integration == "explicite")
+        return new SolveurSauteMouton();
+    if (integration == "verlet_vitesse")
+        return new SolveurVerletVitesse();
+    return NULL;
+}
+
+/*! Premier pas d Euler symplectique : meme formule que le pas courant, avec les accelerations A. */
+void SolveurEulerSymplectique::CalculPremierPas(
     int nb_som,
-    std::vector<Vector> &A,
-    std::vector<Vector> &V,
-    std::vector<Vector> &Vprec,
-    std::vector<Vector> &P)
+    ParticleStore &part)
 {
+    const float dt = _delta_t;
+    const float *ax = part.A.x.data(), *ay = part.A.y.data(), *az = part.A.z.data();
+    float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+
+#pragma omp parallel for simd
     for (int i = 0; i < nb_som; i++)
     {
-        Vprec[i] = Vprec[i] + A[i] * _delta_t / 2;
-        V[i] = V[i] + A[i] * _delta_t;
-        P[i] = P[i] + Vprec[i] * _delta_t;
+        vx[i] = vx[i] + ax[i] * dt;
+        vy[i] = vy[i] + ay[i] * dt;
+        vz[i] = vz[i] + az[i] * dt;
+        wx[i] = vx[i];
+        wy[i] = vy[i];
+        wz[i] = vz[i];
+        px[i] = px[i] + dt * vx[i];
+        py[i] = py[i] + dt * vy[i];
+        pz[i] = pz[i] + dt * vz[i];
     }
+
+    _dt_prec = dt;
 }
+
 /*! Calcul des vitesses et positions : 
- *  Formule d Euler semi-implicite :
+ *  Formule d Euler symplectique (semi-implicite) :
  *  x'(t+dt) = x'(t) + dt x"(t)
  *  x(t+dt) = x(t) + dt x'(t+dt)
+ *  La vitesse de deplacement Vprec est la nouvelle vitesse.
  */
-void SolveurExpl::Solve(float visco,
-                        int nb_som,
-                        int Tps,
-                        std::vector<Vector> &A,
-                        std::vector<Vector> &V,
-                        std::vector<Vector> &VPrec,
-                        std::vector<Vector> &P)
+void SolveurEulerSymplectique::Solve(Vector g,
+                                    const MursDomaine *murs,
+                                    int nb_som,
+                                    ParticleStore &part)
 {
+    const float dt = _delta_t;
+    const float *fx = part.Force.x.data(), *fy = part.Force.y.data(), *fz = part.Force.z.data();
+    float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+
 #pragma omp parallel for
+    for (int bloc = 0; bloc < nb_som; bloc += TAILLE_BLOC)
+    {
+        const int fin = std::min(bloc + TAILLE_BLOC, nb_som);
+
+#pragma omp simd
+        for (int i = bloc; i < fin; i++)
+        {
+            // acceleration : on a calcule dans Force[i] fij / rho_i, on ajoute la gravite
+            const float ax = fx[i] + g.x, ay = fy[i] + g.y, az = fz[i] + g.z;
+            vx[i] = vx[i] + ax * dt;
+            vy[i] = vy[i] + ay * dt;
+            vz[i] = vz[i] + az * dt;
+            wx[i] = vx[i];
+            wy[i] = vy[i];
+            wz[i] = vz[i];
+            px[i] = px[i] + dt * vx[i];
+            py[i] = py[i] + dt * vy[i];
+            pz[i] = pz[i] + dt * vz[i];
+        }
+
+        if (murs)
+            RebondMursBloc(*murs, bloc, fin, part);
+    }
+
+    _dt_prec = dt;
+} //void
+
+/*! Positions predites d Euler symplectique : x(t) + dt (x'(t) + dt a), soit dt^2 par unite d acceleration. */
+void SolveurEulerSymplectique::PredictionPositions(Vector g,
+                                                   int nb_som,
+                                                   const ParticleStore &part,
+                                                   ChampVectoriel &pred) const
+{
+    const float dt = _delta_t;
+    const float *fx = part.Force.x.data(), *fy = part.Force.y.data(), *fz = part.Force.z.data();
+    const float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    const float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+    pred.resize(nb_som);
+    float *qx = pred.x.data(), *qy = pred.y.data(), *qz = pred.z.data();
+
+#pragma omp parallel for simd
     for (int i = 0; i < nb_som; i++)
     {
-        VPrec[i] = VPrec[i] + A[i] * _delta_t;
-        V[i] = VPrec[i] + A[i] * _delta_t / 2;
-        P[i] = P[i] + _delta_t * VPrec[i];
+        qx[i] = px[i] + dt * (vx[i] + (fx[i] + g.x) * dt);
+        qy[i] = py[i] + dt * (vy[i] + (fy[i] + g.y) * dt);
+        qz[i] = pz[i] + dt * (vz[i] + (fz[i] + g.z) * dt);
     }
+}
+
+float SolveurEulerSymplectique::CoefDeplacement() const
+{
+    return _delta_t * _delta_t;
+}
+
+/*! Premier pas du saute-mouton : demi-impulsion initiale. */
+void SolveurSauteMouton::CalculPremierPas(
+    int nb_som,
+    ParticleStore &part)
+{
+    const float dt = _delta_t;
+    const float *ax = part.A.x.data(), *ay = part.A.y.data(), *az = part.A.z.data();
+    float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < nb_som; i++)
+    {
+        wx[i] = wx[i] + ax[i] * dt / 2;
+        wy[i] = wy[i] + ay[i] * dt / 2;
+        wz[i] = wz[i] + az[i] * dt / 2;
+        vx[i] = vx[i] + ax[i] * dt;
+        vy[i] = vy[i] + ay[i] * dt;
+        vz[i] = vz[i] + az[i] * dt;
+        px[i] = px[i] + wx[i] * dt;
+        py[i] = py[i] + wy[i] * dt;
+        pz[i] = pz[i] + wz[i] * dt;
+    }
+
+    _dt_prec = dt;
+}
+/*! Calcul des vitesses et positions : 
+ *  Saute-mouton KDK :
+ *  x'(t+dt/2) = x'(t-dt/2) + (dt_prec + dt)/2 x"(t)
+ *  x(t+dt) = x(t) + dt x'(t+dt/2)
+ *  Chaque composante est un tableau contigu : la boucle est a pas unitaire et vectorisee.
+ *  Avec un pas de temps variable, les vitesses Vprec (au milieu des pas) sont mises a jour
+ *  avec la moyenne du pas precedent et du pas courant.
+ */
+void SolveurSauteMouton::Solve(Vector g,
+                              const MursDomaine *murs,
+                              int nb_som,
+                              ParticleStore &part)
+{
+    const float dt = _delta_t;
+    const float dt_moy = 0.5f * (_dt_prec + dt);
+    const float *fx = part.Force.x.data(), *fy = part.Force.y.data(), *fz = part.Force.z.data();
+    float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+
+#pragma omp parallel for
+    for (int bloc = 0; bloc < nb_som; bloc += TAILLE_BLOC)
+    {
+        const int fin = std::min(bloc + TAILLE_BLOC, nb_som);
+
+#pragma omp simd
+        for (int i = bloc; i < fin; i++)
+        {
+            // acceleration : on a calcule dans Force[i] fij / rho_i, on ajoute la gravite
+            const float ax = fx[i] + g.x, ay = fy[i] + g.y, az = fz[i] + g.z;
+            wx[i] = wx[i] + ax * dt_moy;
+            wy[i] = wy[i] + ay * dt_moy;
+            wz[i] = wz[i] + az * dt_moy;
+            vx[i] = wx[i] + ax * dt / 2;
+            vy[i] = wy[i] + ay * dt / 2;
+            vz[i] = wz[i] + az * dt / 2;
+            px[i] = px[i] + dt * wx[i];
+            py[i] = py[i] + dt * wy[i];
+            pz[i] = pz[i] + dt * wz[i];
+        }
+
+        if (murs)
+            RebondMursBloc(*murs, bloc, fin, part);
+    }
+
+    _dt_prec = dt;
+} //void
+
+/*! Positions predites du saute-mouton : x(t) + dt (x'(t-dt/2) + (dt_prec + dt)/2 a). */
+void SolveurSauteMouton::PredictionPositions(Vector g,
+                                             int nb_som,
+                                             const ParticleStore &part,
+                                             ChampVectoriel &pred) const
+{
+    const float dt = _delta_t;
+    const float dt_moy = 0.5f * (_dt_prec + dt);
+    const float *fx = part.Force.x.data(), *fy = part.Force.y.data(), *fz = part.Force.z.data();
+    const float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    const float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+    pred.resize(nb_som);
+    float *qx = pred.x.data(), *qy = pred.y.data(), *qz = pred.z.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < nb_som; i++)
+    {
+        qx[i] = px[i] + dt * (wx[i] + (fx[i] + g.x) * dt_moy);
+        qy[i] = py[i] + dt * (wy[i] + (fy[i] + g.y) * dt_moy);
+        qz[i] = pz[i] + dt * (wz[i] + (fz[i] + g.z) * dt_moy);
+    }
+}
+
+float SolveurSauteMouton::CoefDeplacement() const
+{
+    return _delta_t * 0.5f * (_dt_prec + _delta_t);
+}
+
+/*! Premier pas de Verlet vitesse : la vitesse V est celle de l instant initial. */
+void SolveurVerletVitesse::CalculPremierPas(
+    int nb_som,
+    ParticleStore &part)
+{
+    const float dt = _delta_t;
+    const float *ax = part.A.x.data(), *ay = part.A.y.data(), *az = part.A.z.data();
+    float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < nb_som; i++)
+    {
+        px[i] = px[i] + dt * vx[i] + ax[i] * (dt * dt / 2);
+        py[i] = py[i] + dt * vy[i] + ay[i] * (dt * dt / 2);
+        pz[i] = pz[i] + dt * vz[i] + az[i] * (dt * dt / 2);
+        wx[i] = vx[i] + ax[i] * dt / 2;
+        wy[i] = vy[i] + ay[i] * dt / 2;
+        wz[i] = vz[i] + az[i] * dt / 2;
+        vx[i] = vx[i] + ax[i] * dt;
+        vy[i] = vy[i] + ay[i] * dt;
+        vz[i] = vz[i] + az[i] * dt;
+    }
+
+    _dt_prec = dt;
+}
+/*! Calcul des vitesses et positions : 
+ *  Verlet vitesse, avec a(t) calculee aux positions x(t) :
+ *  x'(t) = x'(t-dt_prec) + dt_prec/2 (a(t-dt_prec) + a(t))   (Vprec + dt_prec/2 a(t))
+ *  x(t+dt) = x(t) + dt x'(t) + dt^2/2 a(t)
+ *  V recoit x'(t) + dt a(t), estimation de x'(t+dt) pour les forces du pas suivant.
+ */
+void SolveurVerletVitesse::Solve(Vector g,
+                                const MursDomaine *murs,
+                                int nb_som,
+                                ParticleStore &part)
+{
+    const float dt = _delta_t;
+    const float demi_prec = 0.5f * _dt_prec;
+    const float *fx = part.Force.x.data(), *fy = part.Force.y.data(), *fz = part.Force.z.data();
+    float *vx = part.V.x.data(), *vy = part.V.y.data(), *vz = part.V.z.data();
+    float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+
+#pragma omp parallel for
+    for (int bloc = 0; bloc < nb_som; bloc += TAILLE_BLOC)
+    {
+        const int fin = std::min(bloc + TAILLE_BLOC, nb_som);
+
+#pragma omp simd
+        for (int i = bloc; i < fin; i++)
+        {
+            // acceleration : on a calcule dans Force[i] fij / rho_i, on ajoute la gravite
+            const float ax = fx[i] + g.x, ay = fy[i] + g.y, az = fz[i] + g.z;
+            // vitesse a l instant t
+            float ux = wx[i] + ax * demi_prec;
+            float uy = wy[i] + ay * demi_prec;
+            float uz = wz[i] + az * demi_prec;
+            px[i] = px[i] + dt * ux + ax * (dt * dt / 2);
+            py[i] = py[i] + dt * uy + ay * (dt * dt / 2);
+            pz[i] = pz[i] + dt * uz + az * (dt * dt / 2);
+            wx[i] = ux + ax * dt / 2;
+            wy[i] = uy + ay * dt / 2;
+            wz[i] = uz + az * dt / 2;
+            vx[i] = ux + ax * dt;
+            vy[i] = uy + ay * dt;
+            vz[i] = uz + az * dt;
+        }
+
+        if (murs)
+            RebondMursBloc(*murs, bloc, fin, part);
+    }
+
+    _dt_prec = dt;
 } //void
+
+/*! Positions predites de Verlet vitesse : x(t) + dt (x'(t-dt_prec) + dt_prec/2 a) + dt^2/2 a. */
+void SolveurVerletVitesse::PredictionPositions(Vector g,
+                                               int nb_som,
+                                               const ParticleStore &part,
+                                               ChampVectoriel &pred) const
+{
+    const float dt = _delta_t;
+    const float demi_prec = 0.5f * _dt_prec;
+    const float *fx = part.Force.x.data(), *fy = part.Force.y.data(), *fz = part.Force.z.data();
+    const float *wx = part.Vprec.x.data(), *wy = part.Vprec.y.data(), *wz = part.Vprec.z.data();
+    const float *px = part.P.x.data(), *py = part.P.y.data(), *pz = part.P.z.data();
+    pred.resize(nb_som);
+    float *qx = pred.x.data(), *qy = pred.y.data(), *qz = pred.z.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < nb_som; i++)
+    {
+        const float ax = fx[i] + g.x, ay = fy[i] + g.y, az = fz[i] + g.z;
+        qx[i] = px[i] + dt * (wx[i] + ax * demi_prec) + ax * (dt * dt / 2);
+        qy[i] = py[i] + dt * (wy[i] + ay * demi_prec) + ay * (dt * dt / 2);
+        qz[i] = pz[i] + dt * (wz[i] + az * demi_prec) + az * (dt * dt / 2);
+    }
+}
+
+float SolveurVerletVitesse::CoefDeplacement() const
+{
+    return _delta_t * (0.5f * _dt_prec + 0.5f * _delta_t);
+}
@@ -15,56 +15,216 @@
 #include <vector>
 #include <string.h>
 #include <fstream>
+#include <string>
 
 // Fichiers de gkit2light
 #include "vec.h"
-#include "mesh.h"
 
 // Fichiers de master_meca_sim
 #include "Noeuds.h"
 #include "Properties.h"
 #include "ObjetSimule.h"
+#include "ParticleStore.h"
 
 
 
+/// Murs du domaine (min et max selon x, y et z)
+typedef float MursDomaine[3][2];
+
+
+/**
+ * Rebond amorti d une particule sur le mur de coordonnee barriere selon l axe a (les deux autres
+ * axes sont b et c) : retour en arriere selon le temps ecoule depuis la collision, symetrie par
+ * rapport au mur et amortissement (coefficient de restitution 0.75) de la vitesse v et de la
+ * vitesse de deplacement w. Les composantes sont passees une a une : elles viennent des tableaux
+ * des particules (SolveurExpl::Solve) ou de Vector (ObjetSimuleSPH::damp_reflect).
+ */
+inline void RebondMur(float barriere,
+                      float &pa, float &pb, float &pc,
+                      float &va, float &vb, float &vc,
+                      float &wa, float &wb, float &wc)
+{
+    float coef = 0.75;
+    if (va == 0)
+        return;
+
+    float tbounce = (pa - barriere) / va;
+    pa = pa - va * (1 - coef) * tbounce;
+    pb = pb - vb * (1 - coef) * tbounce;
+    pc = pc - vc * (1 - coef) * tbounce;
+    pa = 2 * barriere - pa;
+    va = -va;
+    wa = -wa;
+    va = va * coef; vb = vb * coef; vc = vc * coef;
+    wa = wa * coef; wb = wb * coef; wc = wc * coef;
+}
+
+
+/**
+ * Rebonds sur chacun des murs traverses, dans l ordre x min, x max, y min, ..., z max.
+ */
+inline void RebondMurs(const MursDomaine &murs,
+                       float &px, float &py, float &pz,
+                       float &vx, float &vy, float &vz,
+                       float &wx, float &wy, float &wz)
+{
+    if (px < murs[0][0])
+        RebondMur(murs[0][0], px, py, pz, vx, vy, vz, wx, wy, wz);
+    if (px > murs[0][1])
+        RebondMur(murs[0][1], px, py, pz, vx, vy, vz, wx, wy, wz);
+    if (py < murs[1][0])
+        RebondMur(murs[1][0], py, px, pz, vy, vx, vz, wy, wx, wz);
+    if (py > murs[1][1])
+        RebondMur(murs[1][1], py, px, pz, vy, vx, vz, wy, wx, wz);
+    if (pz < murs[2][0])
+        RebondMur(murs[2][0], pz, px, py, vz, vx, vy, wz, wx, wy);
+    if (pz > murs[2][1])
+        RebondMur(murs[2][1], pz, px, py, vz, vx, vy, wz, wx, wy);
+}
+
+
 /*
- * Class pour le schema d integration d'Euler semi-implicite.
+ * Class de base des schemas d integration explicites (interface commune).
+ * Le pas de temps (fixe ou adaptatif) est commun ; chaque schema definit son premier pas
+ * et son pas courant. Le pas courant est une seule passe sur les tableaux des particules,
+ * par blocs de TAILLE_BLOC : boucle vectorisee (acceleration F + g, vitesses, positions),
+ * puis rebonds sur les murs du domaine tant que le bloc est dans le cache ; chaque tableau
+ * n est lu et ecrit qu une fois en memoire. Les forces sont calculees une fois par pas,
+ * aux positions courantes.
+ * Pour tous les schemas, Vprec est la vitesse de deplacement du dernier pas
+ * (P = P_prec + dt Vprec) et V la vitesse utilisee par les forces du pas suivant.
  */
 class SolveurExpl
 {
 public:
     
     /*! Constructeur */
-    SolveurExpl(){}
+    SolveurExpl()
+        : _delta_t(0.001f), _Adaptatif(false), _CoefCFL(0.4f), _CoefForce(0.25f), _CoefViscosite(0.125f),
+          _dt_min(1e-6f), _dt_max(0.01f), _dt_prec(0.001f) {}
+    
+    /*! Destructeur */
+    virtual ~SolveurExpl() {}
+    
+    /*! Creation du schema d integration designe par son nom (cle Integration), NULL s il est inconnu */
+    static SolveurExpl *Cree(const std::string &integration);
+    
+    /*! Nom du schema */
+    virtual const char *Nom() const = 0;
+    
+    /// Nombre de particules d un bloc du pas courant : les tableaux d un bloc (12 flottants
+    /// par particule) restent dans le cache L1 entre l integration et les rebonds
+    static const int TAILLE_BLOC = 256;
     
-    /*! Calcul des accelerations (avec ajout de la gravite aux forces) */
-    void CalculAccel_ForceGravite(Vector g,
-                                  int nb_som,
-                                  std::vector<Vector> &A,
-                                  std::vector<Vector> &Force,
-                                  std::vector<float> &M);
+    /*! Calcul du pas de temps stable (criteres CFL, des forces et de la viscosite), borne par duree_max */
+    float CalculPasAdaptatif(float h, float c_son, float nu, float duree_max, Vector g,
+                             int nb_som, const ParticleStore &part);
     
-    void CalculPremierPas(
+    /*! Premier pas (les vitesses V sont celles de l instant initial, les accelerations dans A) */
+    virtual void CalculPremierPas(
                int nb_som,
-               std::vector<Vector> &A,
-               std::vector<Vector> &V,
-               std::vector<Vector> &Vprec,
-               std::vector<Vector> &P);
+               ParticleStore &part) = 0;
 
     
-    /*! Calcul des vitesses et positions */
-    void Solve(float visco,
+    /*! Calcul des accelerations (forces et gravite g), des vitesses, des positions
+        et des rebonds sur les murs (aucun si murs est NULL) */
+    virtual void Solve(Vector g,
+               const MursDomaine *murs,
                int nb_som,
-               int Tps,
-               std::vector<Vector> &A,
-               std::vector<Vector> &V,
-               std::vector<Vector> &Vprec,
-               std::vector<Vector> &P);
+               ParticleStore &part) = 0;
+    
+    /*! Positions que donnerait le pas courant avec les forces actuelles (sans les murs),
+        pour les solveurs de pression incompressibles */
+    virtual void PredictionPositions(Vector g, int nb_som, const ParticleStore &part, ChampVectoriel &pred) const = 0;
+    
+    /*! Derivee des positions du pas courant par rapport a l acceleration :
+        une acceleration supplementaire a deplace la particule de CoefDeplacement() a */
+    virtual float CoefDeplacement() const = 0;
     
     
     
     /// Pas de temps
     float _delta_t;
+    
+    /// Pas de temps adaptatif (recalcule a chaque pas) ou fixe
+    bool _Adaptatif;
+    
+    /// Coefficient de securite du critere CFL : dt <= coef h / (c + |v|max)
+    float _CoefCFL;
+    
+    /// Coefficient de securite du critere des forces : dt <= coef sqrt(h / |a|max)
+    float _CoefForce;
+    
+    /// Coefficient de securite du critere de viscosite : dt <= coef h^2 / nu
+    float _CoefViscosite;
+    
+    /// Borne inferieure du pas de temps adaptatif
+    float _dt_min;
+    
+    /// Borne superieure du pas de temps adaptatif
+    float _dt_max;
+    
+    /// Pas de temps precedent (les vitesses Vprec sont au milieu des deux pas)
+    float _dt_prec;
+};
+
+
+/*
+ * Euler symplectique (semi-implicite), ordre 1 : le moins couteux.
+ */
+class SolveurEulerSymplectique : public SolveurExpl
+{
+public:
+    
+    const char *Nom() const { return "euler_symplectique"; }
+    
+    void CalculPremierPas(int nb_som, ParticleStore &part);
+    
+    void Solve(Vector g, const MursDomaine *murs, int nb_som, ParticleStore &part);
+    
+    void PredictionPositions(Vector g, int nb_som, const ParticleStore &part, ChampVectoriel &pred) const;
+    
+    float CoefDeplacement() const;
+};
+
+
+/*
+ * Saute-mouton KDK (kick-drift-kick), ordre 2 : Vprec est la vitesse au milieu du pas,
+ * la demi-impulsion de fin du pas precedent et celle du debut du pas courant sont fusionnees.
+ */
+class SolveurSauteMouton : public SolveurExpl
+{
+public:
+    
+    const char *Nom() const { return "saute_mouton"; }
+    
+    void CalculPremierPas(int nb_som, ParticleStore &part);
+    
+    void Solve(Vector g, const MursDomaine *murs, int nb_som, ParticleStore &part);
+    
+    void PredictionPositions(Vector g, int nb_som, const ParticleStore &part, ChampVectoriel &pred) const;
+    
+    float CoefDeplacement() const;
+};
+
+
+/*
+ * Verlet vitesse, ordre 2 : la vitesse de l instant courant est d abord completee
+ * avec les nouvelles accelerations, puis les positions avancent de dt v + dt^2 / 2 a.
+ */
+class SolveurVerletVitesse : public SolveurExpl
+{
+public:
+    
+    const char *Nom() const { return "verlet_vitesse"; }
+    
+    void CalculPremierPas(int nb_som, ParticleStore &part);
+    
+    void Solve(Vector g, const MursDomaine *murs, int nb_som, ParticleStore &part);
+    
+    void PredictionPositions(Vector g, int nb_som, const ParticleStore &part, ChampVectoriel &pred) const;
+    
+    float CoefDeplacement() const;
 };
 
 
@@ -0,0 +1,499 @@
+/** \file SolveursPression.cpp
+ \brief Solveurs de pression incompressibles pour la methode SPH : les pressions ne sont plus donnees
+ par l equation d etat p = bulk (rho - rho0), qui impose un pas de temps lie a la vitesse du son
+ sqrt(bulk / rho0), mais calculees a chaque pas pour que les densites restent proches de rho0.
+ PCISPH (Solenthaler et Pajarola 2009) : prediction-correction des pressions.
+ DFSPH (Bender et Koschier 2015) : solveur de densite constante et solveur de divergence nulle,
+ corrections des vitesses par des raideurs par particule, avec demarrage a chaud du solveur de divergence.
+ IISPH (Ihmsen et al. 2014) : equation de Poisson des pressions resolue par Jacobi relaxe, sans matrice.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#include "vec.h"
+#include "ObjetSimule.h"
+#include "ObjetSimuleSPH.h"
+
+using namespace std;
+
+
+/**
+ * Vitesse du son du critere CFL du pas adaptatif : sqrt(bulk / rho0) avec l equation d etat ;
+ * avec un solveur incompressible, le pas n est limite que par les vitesses des particules
+ * (et par les criteres des forces et de la viscosite).
+ */
+float ObjetSimuleSPH::VitesseSon() const
+{
+    if (_ModePression == PRESSION_EQUATION_ETAT)
+        return sqrtf(bulk / rho0);
+    return 0;
+}
+
+
+/**
+ * Sommes pour une particule de reference au centre d un reseau cubique d espacement s,
+ * sur ses voisins a distance r < h : densite rho, et
+ *  D = \sum_j G_j K_j r_j^2,
+ * ou -G_j r_j est le gradient du noyau de densite et K_j r_j (p_i + p_j) / (rho_i rho_j)
+ * le terme de pression de la paire (noyau des forces, viscosite exclue).
+ */
+static void SommesReseau(float h, float m, float s, float &rho, float &D)
+{
+    float h2 = h * h;
+    float c_rho = 4 * m / M_PI / (h2 * h2 * h2 * h2);
+    float c = m / M_PI / (h2 * h2);
+    int nb = (int)(h / s);
+
+    rho = c_rho * h2 * h2 * h2;
+    D = 0;
+    for (int a = -nb; a <= nb; ++a)
+        for (int b = -nb; b <= nb; ++b)
+            for (int e = -nb; e <= nb; ++e)
+            {
+                float r2 = s * s * (a * a + b * b + e * e);
+                if (r2 == 0 || r2 >= h2)
+                    continue;
+
+                float z = h2 - r2;
+                float q = sqrtf(r2) / h;
+                rho += c_rho * z * z * z;
+                D += 6 * c_rho * z * z * 15 * c * (1 - q) * (1 - q) / q * r2;
+            }
+}
+
+
+/**
+ * Coefficient de correction de PCISPH : une pression p identique pour la particule i et ses voisins
+ * deplace i de CoefDeplacement() a_i, avec a_i = 2 p / rho0^2 \sum_j K_j r_j, et ses voisins en sens
+ * oppose ; la densite de i varie alors de -CoefDeplacement() 2 p / rho0^2 D (voisinage complet,
+ * \sum_j G_j r_j = 0). Une erreur de densite e est donc corrigee par la pression
+ *  p = rho0^2 / (2 D CoefDeplacement()) e,
+ * et la fonction renvoie rho0^2 / (2 D).
+ * D est calcule une fois pour une particule de reference dont le voisinage est un reseau cubique
+ * complet ; l espacement du reseau est celui pour lequel la densite de reference est rho0
+ * avec la masse des particules (recherche par dichotomie).
+ * Calcule une fois par InitNoyaux (creation des particules, reprise) et conserve dans _CoefPCISPH.
+ */
+float ObjetSimuleSPH::CoefPCISPH() const
+{
+    float m = _Particules.M[0];
+    float rho, D;
+    float s_min = 0.2f * h, s_max = h;
+
+    for (int k = 0; k < 40; ++k)
+    {
+        float s = 0.5f * (s_min + s_max);
+        SommesReseau(h, m, s, rho, D);
+        if (rho > rho0)
+            s_min = s;
+        else
+            s_max = s;
+    }
+
+    SommesReseau(h, m, 0.5f * (s_min + s_max), rho, D);
+    return rho0 * rho0 / (2 * D);
+}
+
+
+/**
+ * Correction des pressions de PCISPH pour le pas courant (pas de temps deja choisi).
+ * Les forces sans pression (viscosite) sont dans Force ; a partir de pressions nulles, on repete :
+ *  - positions predites par le schema d integration avec les forces, la gravite et les accelerations
+ *    de pression courantes (prediction sans pression + CoefDeplacement() acceleration de pression),
+ *  - densites predites et erreurs e_i = rho*_i - rho0,
+ *  - p_i = max(p_i + delta e_i, 0) (pas de pressions negatives : pas d attraction a la surface libre),
+ *  - accelerations de pression aux positions courantes,
+ * tant que l erreur relative moyenne (compressions seules) depasse la tolerance, avec un nombre
+ * minimal et maximal d iterations. Les accelerations de pression sont enfin ajoutees a Force.
+ */
+void ObjetSimuleSPH::CorrectionPCISPH(Vector gravite)
+{
+    const int n = _Nb_Sommets;
+    if (n == 0)
+        return;
+
+    const float coef = _SolveurExpl->CoefDeplacement();
+    const float delta = _CoefPCISPH / coef;
+
+    _Pression.assign(n, 0.f);
+    _SolveurExpl->PredictionPositions(gravite, n, _Particules, _PredictionSansPression);
+    _PositionsPredites = _PredictionSansPression;
+
+    float *press = _Pression.data();
+    float erreur = 0;
+    int iter = 0;
+
+    do
+    {
+        if (iter > 0)
+        {
+            const float *bx = _PredictionSansPression.x.data(), *by = _PredictionSansPression.y.data(),
+                        *bz = _PredictionSansPression.z.data();
+            const float *ax = _AccelPression.x.data(), *ay = _AccelPression.y.data(), *az = _AccelPression.z.data();
+            float *qx = _PositionsPredites.x.data(), *qy = _PositionsPredites.y.data(), *qz = _PositionsPredites.z.data();
+
+#pragma omp parallel for simd
+            for (int i = 0; i < n; ++i)
+            {
+                qx[i] = bx[i] + coef * ax[i];
+                qy[i] = by[i] + coef * ay[i];
+                qz[i] = bz[i] + coef * az[i];
+            }
+        }
+
+        CalculDensitePredite();
+
+        const float *rho = _DensitesPredites.data();
+        double somme = 0;
+
+#pragma omp parallel for simd reduction(+ : somme)
+        for (int i = 0; i < n; ++i)
+        {
+            float e = rho[i] - rho0;
+            press[i] = std::max(press[i] + delta * e, 0.f);
+            somme += std::max(e, 0.f);
+        }
+        erreur = somme / ((double)n * rho0);
+
+        CalculAccelPression(_Pression.data(), _Particules.rho.data(), 1, _AccelPression);
+        ++iter;
+    } while ((erreur > _TolerancePression || iter < _IterMinPression) && iter < _IterMaxPression);
+
+    float *fx = _Particules.Force.x.data(), *fy = _Particules.Force.y.data(), *fz = _Particules.Force.z.data();
+    const float *ax = _AccelPression.x.data(), *ay = _AccelPression.y.data(), *az = _AccelPression.z.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < n; ++i)
+    {
+        fx[i] += ax[i];
+        fy[i] += ay[i];
+        fz[i] += az[i];
+    }
+
+    _StatsPression.Ajoute(iter, erreur);
+}
+
+
+/**
+ * Iterations de correction de DFSPH (Jacobi) sur les vitesses v, pour un pas dt.
+ * Erreur de densite de chaque particule :
+ *  E_i = \rho_i + dt div_i - \rho_0 (densite constante, densite = true) ou dt div_i (divergence nulle),
+ * ou div_i est la derivee de la densite (gradient du noyau de densite, cf CalculDivergence),
+ * increment de raideur omega E_i alpha_i / dt^2 (Jacobi relaxe : sans relaxation, les iterations divergent
+ * sur les voisinages denses), la raideur cumulee kappa_i restant positive (pas d attraction : seule la
+ * compression est corrigee, mais un demarrage a chaud trop fort peut etre reduit), et correction
+ * des vitesses par l increment de raideur
+ *  v_i -= dt \sum_j m (kappa_i / \rho_i + kappa_j / \rho_j) grad W'_ij (gradient des pressions),
+ * tant que l erreur relative moyenne des compressions depasse la tolerance. La moyenne porte sur les
+ * particules contraintes : voisinage non vide (alpha_i > 0), non exclues du solveur, et comprimees ou de
+ * raideur non nulle ; les particules isolees ou en expansion ne diluent pas l erreur.
+ * kappa contient en entree les raideurs du demarrage a chaud (nulles sans demarrage a chaud), en sortie
+ * leur cumul ; les raideurs ne dependent pas du pas de temps, qui change d un pas a l autre (pas adaptatif,
+ * dernier pas d une image).
+ * Renvoie le nombre d iterations ; residu recoit l erreur relative moyenne finale.
+ */
+int ObjetSimuleSPH::IterationsDFSPH(ChampVectoriel &v, float dt, bool densite, float tolerance,
+                                    TableauAligne &kappa, float &residu)
+{
+    const int n = _Nb_Sommets;
+    const float *rho = _Particules.rho.data();
+    const float *alpha = _Alpha.data();
+    const float inv_dt2 = 1 / (dt * dt);
+    const float omega = _Relaxation;
+    // E_i = facteur rho_i + dt div_i - decalage ; les particules au voisinage incomplet (rho_i < seuil,
+    // surface et eclaboussures) sont exclues du solveur de divergence : leurs facteurs alpha, a
+    // gradients presque nuls, donneraient des corrections demesurees
+    const float facteur = densite ? 1.f : 0.f;
+    const float decalage = densite ? rho0 : 0.f;
+    const float seuil = densite ? 0.f : rho0;
+
+    _Pression.resize(n);
+    _Divergence.resize(n);
+    _DensitesUnites.assign(n, 1.f);
+    float *press = _Pression.data();
+    float *erreur = _Divergence.data();
+    float *k = kappa.data();
+    float *vx = v.x.data(), *vy = v.y.data(), *vz = v.z.data();
+
+    // Correction des vitesses par les pressions press (kappa / rho)
+    auto corrige = [&]() {
+        CalculAccelPression(press, _DensitesUnites.data(), 2, _AccelPression);
+        const float *ax = _AccelPression.x.data(), *ay = _AccelPression.y.data(), *az = _AccelPression.z.data();
+
+#pragma omp parallel for simd
+        for (int i = 0; i < n; ++i)
+        {
+            vx[i] += dt * ax[i];
+            vy[i] += dt * ay[i];
+            vz[i] += dt * az[i];
+        }
+    };
+
+    /* Demarrage a chaud : raideurs du pas precedent (nulles hors du solveur), puis raideurs multipliees
+       par dt^2 pendant les iterations */
+    float kmax = 0;
+
+#pragma omp parallel for simd reduction(max : kmax)
+    for (int i = 0; i < n; ++i)
+    {
+        if (rho[i] < seuil || alpha[i] <= 0)
+            k[i] = 0;
+        press[i] = k[i] / rho[i];
+        kmax = std::max(kmax, k[i]);
+        k[i] *= dt * dt;
+    }
+
+    if (kmax > 0)
+        corrige();
+
+    int iter = 0;
+    for (;;)
+    {
+        CalculDivergence(v, erreur);
+        double somme = 0;
+        int contraintes = 0;
+
+#pragma omp parallel for simd reduction(+ : somme, contraintes)
+        for (int i = 0; i < n; ++i)
+        {
+            erreur[i] = (rho[i] >= seuil && alpha[i] > 0) ? facteur * rho[i] + dt * erreur[i] - decalage : 0.f;
+            somme += std::max(erreur[i], 0.f);
+            contraintes += (erreur[i] > 0 || k[i] > 0) ? 1 : 0;
+        }
+        residu = somme / ((double)std::max(contraintes, 1) * rho0);
+
+        if ((residu <= tolerance && iter >= _IterMinPression) || iter >= _IterMaxPression)
+            break;
+
+#pragma omp parallel for simd
+        for (int i = 0; i < n; ++i)
+        {
+            float ki = std::max(k[i] + omega * erreur[i] * alpha[i], 0.f);
+            press[i] = (ki - k[i]) * inv_dt2 / rho[i];
+            k[i] = ki;
+        }
+
+        corrige();
+        ++iter;
+    }
+
+#pragma omp parallel for simd
+    for (int i = 0; i < n; ++i)
+        k[i] *= inv_dt2;
+
+    return iter;
+}
+
+
+/**
+ * Raideurs du pas precedent (indexees par identifiant persistant, donc valables apres un
+ * reordonnancement des particules) dans l ordre courant ; nulles au premier pas.
+ */
+static void RaideursPrecedentes(const TableauAligne &prec, const std::vector<int> &id, int n, TableauAligne &kappa)
+{
+    kappa.assign(n, 0.f);
+    if ((int)prec.size() != n)
+        return;
+
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+        kappa[i] = prec[id[i]];
+}
+
+/**
+ * Conservation des raideurs du pas pour le demarrage a chaud du suivant.
+ */
+static void ConserveRaideurs(const TableauAligne &kappa, const std::vector<int> &id, int n, TableauAligne &prec)
+{
+    prec.resize(n);
+
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+        prec[id[i]] = kappa[i];
+}
+
+
+/**
+ * Solveur de divergence nulle de DFSPH, au debut du pas (densites et facteurs alpha calcules aux
+ * positions courantes) : les vitesses V sont corrigees pour que les densites ne varient pas,
+ * avec le pas de temps precedent.
+ */
+void ObjetSimuleSPH::CorrectionDivergenceDFSPH()
+{
+    const int n = _Nb_Sommets;
+    if (n == 0)
+        return;
+
+    float residu;
+    RaideursPrecedentes(_KappaDivergencePrec, _Particules.Id, n, _KappaDivergence);
+    int iter = IterationsDFSPH(_Particules.V, _SolveurExpl->_delta_t, false, _ToleranceDivergence,
+                               _KappaDivergence, residu);
+    ConserveRaideurs(_KappaDivergence, _Particules.Id, n, _KappaDivergencePrec);
+
+    _StatsDivergence.Ajoute(iter, residu);
+}
+
+
+/**
+ * Solveur de densite constante de DFSPH pour le pas courant (pas de temps choisi, forces sans
+ * pression dans Force) : vitesses predites v* = V + dt (Force + g), corrigees pour que les densites
+ * predites soient rho0 ; la correction est ajoutee a Force, de sorte que le pas d Euler symplectique
+ * de l integration donne les vitesses v* (et les rebonds sur les murs).
+ */
+void ObjetSimuleSPH::CorrectionDensiteDFSPH(Vector gravite)
+{
+    const int n = _Nb_Sommets;
+    if (n == 0)
+        return;
+
+    const float dt = _SolveurExpl->_delta_t;
+    const float *vx = _Particules.V.x.data(), *vy = _Particules.V.y.data(), *vz = _Particules.V.z.data();
+    float *fx = _Particules.Force.x.data(), *fy = _Particules.Force.y.data(), *fz = _Particules.Force.z.data();
+
+    _VitessesPredites.resize(n);
+    float *wx = _VitessesPredites.x.data(), *wy = _VitessesPredites.y.data(), *wz = _VitessesPredites.z.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < n; ++i)
+    {
+        wx[i] = vx[i] + dt * (fx[i] + gravite.x);
+        wy[i] = vy[i] + dt * (fy[i] + gravite.y);
+        wz[i] = vz[i] + dt * (fz[i] + gravite.z);
+    }
+
+    float residu;
+    // Sans demarrage a chaud : les raideurs du pas precedent corrigeraient a nouveau une compression
+    // deja resorbee, et l expansion qui en resulte n est pas mesuree (seules les compressions le sont)
+    _KappaDensite.assign(n, 0.f);
+    int iter = IterationsDFSPH(_VitessesPredites, dt, true, _TolerancePression, _KappaDensite, residu);
+
+#pragma omp parallel for simd
+    for (int i = 0; i < n; ++i)
+    {
+        fx[i] = (wx[i] - vx[i]) / dt - gravite.x;
+        fy[i] = (wy[i] - vy[i]) / dt - gravite.y;
+        fz[i] = (wz[i] - vz[i]) / dt - gravite.z;
+    }
+
+    _StatsPression.Ajoute(iter, residu);
+}
+
+
+/**
+ * Pressions d IISPH pour le pas courant (pas de temps deja choisi, forces sans pression dans Force).
+ * Les densites d advection rho*_i sont calculees aux positions predites sans pression ; les pressions
+ * verifient l equation de Poisson linearisee aux positions courantes
+ *  rho*_i + coef \sum_j m (a_i - a_j) . grad W_ij = rho0,
+ * ou a sont les accelerations de pression (cf CalculCoefficientsIISPH) et coef = CoefDeplacement().
+ * Jacobi relaxe sans matrice : a partir de la moitie des pressions du pas precedent, on repete
+ *  - accelerations de pression a (noyau des forces) puis variations de densite coef (A p)_i,
+ *  - erreurs e_i = rho*_i + coef (A p)_i - rho0,
+ *  - p_i = max(p_i - omega e_i / a_ii, 0),
+ * avec la meme tolerance et les memes nombres d iterations que PCISPH ; chaque iteration fait deux
+ * parcours des voisins, et la memoire utilisee est lineaire en nombre de particules.
+ * Les accelerations des pressions finales sont ajoutees a Force.
+ */
+void ObjetSimuleSPH::CorrectionIISPH(Vector gravite)
+{
+    const int n = _Nb_Sommets;
+    if (n == 0)
+        return;
+
+    const float coef = _SolveurExpl->CoefDeplacement();
+    const float omega = _Relaxation;
+    const float *rho = _Particules.rho.data();
+
+    CalculCoefficientsIISPH(coef);
+    _SolveurExpl->PredictionPositions(gravite, n, _Particules, _PositionsPredites);
+    CalculDensitePredite();
+
+    // Demarrage a chaud : moitie des pressions du pas precedent
+    RaideursPrecedentes(_PressionPrec, _Particules.Id, n, _Pression);
+    _PressionsReduites.resize(n);
+    _Divergence.resize(n);
+    _DensitesUnites.assign(n, 1.f);
+
+    float *press = _Pression.data();
+    float *reduite = _PressionsReduites.data();
+    float *erreur = _Divergence.data();
+    const float *rho_adv = _DensitesPredites.data();
+    const float *aii = _Aii.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < n; ++i)
+        press[i] *= 0.5f;
+
+    float residu = 0;
+    int iter = 0;
+    for (;;)
+    {
+#pragma omp parallel for simd
+        for (int i = 0; i < n; ++i)
+            reduite[i] = press[i] / (rho[i] * rho[i]);
+
+        CalculAccelPression(reduite, _DensitesUnites.data(), 2, _AccelPression);
+        CalculDivergence(_AccelPression, erreur);
+        double somme = 0;
+
+#pragma omp parallel for simd reduction(+ : somme)
+        for (int i = 0; i < n; ++i)
+        {
+            erreur[i] = rho_adv[i] + coef * erreur[i] - rho0;
+            somme += std::max(erreur[i], 0.f);
+        }
+        residu = somme / ((double)n * rho0);
+
+        if ((residu <= _TolerancePression && iter >= _IterMinPression) || iter >= _IterMaxPression)
+            break;
+
+        // a_ii nul : particule sans voisin, pression nulle
+#pragma omp parallel for simd
+        for (int i = 0; i < n; ++i)
+            press[i] = (aii[i] < 0) ? std::max(press[i] - omega * erreur[i] / aii[i], 0.f) : 0.f;
+
+        ++iter;
+    }
+
+    ConserveRaideurs(_Pression, _Particules.Id, n, _PressionPrec);
+
+    float *fx = _Particules.Force.x.data(), *fy = _Particules.Force.y.data(), *fz = _Particules.Force.z.data();
+    const float *ax = _AccelPression.x.data(), *ay = _AccelPression.y.data(), *az = _AccelPression.z.data();
+
+#pragma omp parallel for simd
+    for (int i = 0; i < n; ++i)
+    {
+        fx[i] += ax[i];
+        fy[i] += ay[i];
+        fz[i] += az[i];
+    }
+
+    _StatsPression.Ajoute(iter, residu);
+}
+
+
+/**
+ * Affichage des iterations par pas (moyenne et maximum) et des residus moyens des solveurs
+ * de pression depuis le dernier rapport, puis remise a zero des cumuls.
+ */
+void ObjetSimuleSPH::RapportPression()
+{
+    StatistiquesSolveur *stats[] = {&_StatsPression, &_StatsDivergence};
+    const char *noms[] = {"densite", "divergence"};
+
+    for (int s = 0; s < 2; ++s)
+    {
+        StatistiquesSolveur &st = *stats[s];
+        if (st.nb_pas == 0)
+            continue;
+
+        std::cout << "Pression (" << noms[s] << ") : " << (double)st.somme_iterations / st.nb_pas
+                  << " iterations par pas (max " << st.max_iterations << ") ; residu "
+                  << 100 * st.somme_residus / st.nb_pas << " % (dernier pas : " << st.iterations << " iterations, "
+                  << 100 * st.residu << " %)" << std::endl;
+        st.Reinitialise();
+    }
+}
@@ -0,0 +1,464 @@
+/** \file Trajectoire.cpp
+ \brief Ecriture et lecture des trajectoires des particules.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <algorithm>
+
+#include "Trajectoire.h"
+
+
+/**
+ * Deplacement dans un fichier de plus de 2 Go.
+ */
+static int deplace(FILE *f, uint64_t position)
+{
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)position, SEEK_SET);
+#else
+    return fseeko(f, (off_t)position, SEEK_SET);
+#endif
+}
+
+/**
+ * Taille d un fichier de plus de 2 Go.
+ */
+static uint64_t taille_fichier(FILE *f)
+{
+#ifdef _WIN32
+    _fseeki64(f, 0, SEEK_END);
+    return (uint64_t)_ftelli64(f);
+#else
+    fseeko(f, 0, SEEK_END);
+    return (uint64_t)ftello(f);
+#endif
+}
+
+
+/**
+ * Constructeur.
+ */
+EcritureTrajectoire::EcritureTrajectoire()
+    : _Fichier(NULL), _Position(0), _Erreur(false), _Arret(false)
+{
+    memset(&_Entete, 0, sizeof(_Entete));
+}
+
+
+/**
+ * Destructeur : les images en attente et l index sont ecrits.
+ */
+EcritureTrajectoire::~EcritureTrajectoire()
+{
+    Ferme();
+
+    for (unsigned int i = 0; i < _Libres.size(); ++i)
+        delete _Libres[i];
+}
+
+
+/**
+ * Creation du fichier, ecriture de l entete et lancement du thread d ecriture.
+ * periode_cle : une image cle toutes les periode_cle images, les autres sont codees
+ * par difference avec l image precedente (1 : uniquement des images cles).
+ */
+bool EcritureTrajectoire::Ouvre(const std::string &fichier, int nb_particules, const Vector &pmin, const Vector &pmax,
+                                int periode, int periode_cle)
+{
+    Ferme();
+
+    _Fichier = fopen(fichier.c_str(), "wb");
+    if (_Fichier == NULL)
+    {
+        std::cout << "Trajectoire : impossible de creer " << fichier << std::endl;
+        return false;
+    }
+
+    memset(&_Entete, 0, sizeof(_Entete));
+    memcpy(_Entete.magie, MAGIE_TRAJECTOIRE, sizeof(_Entete.magie));
+    _Entete.version = VERSION_TRAJECTOIRE;
+    _Entete.boutisme = BOUTISME_TRAJECTOIRE;
+    _Entete.nb_particules = nb_particules;
+    _Entete.periode = std::max(periode, 1);
+    _Entete.periode_cle = std::max(periode_cle, 1);
+    _Entete.min[0] = pmin.x;
+    _Entete.min[1] = pmin.y;
+    _Entete.min[2] = pmin.z;
+    _Entete.max[0] = pmax.x;
+    _Entete.max[1] = pmax.y;
+    _Entete.max[2] = pmax.z;
+
+    _Index.clear();
+    _Erreur = fwrite(&_Entete, sizeof(_Entete), 1, _Fichier) != 1;
+    _Position = sizeof(_Entete);
+
+    _Arret = false;
+    _Thread = std::thread(&EcritureTrajectoire::Boucle, this);
+
+    std::cout << "Trajectoire : " << fichier << ", " << nb_particules << " particules, une image toutes les "
+              << _Entete.periode << " iterations" << std::endl;
+    return !_Erreur;
+}
+
+
+/**
+ * Ajout d une image : copie des positions dans une image libre, puis mise en file.
+ */
+void EcritureTrajectoire::Ajoute(int iteration, float temps, const std::vector<Vector> &positions)
+{
+    if (_Fichier == NULL)
+        return;
+
+    Image *image;
+    {
+        std::unique_lock<std::mutex> verrou(_Mutex);
+        _Condition.wait(verrou, [this] { return (int)_File.size() < MAX_EN_ATTENTE; });
+
+        if (_Libres.empty())
+            image = new Image;
+        else
+        {
+            image = _Libres.back();
+            _Libres.pop_back();
+        }
+    }
+
+    image->iteration = iteration;
+    image->temps = temps;
+    image->positions = positions;
+
+    {
+        std::lock_guard<std::mutex> verrou(_Mutex);
+        _File.push_back(image);
+    }
+    _Condition.notify_all();
+}
+
+
+/**
+ * Boucle du thread d ecriture : les images sont ecrites dans l ordre d ajout,
+ * jusqu a l arret et a l ecriture de la derniere image en attente.
+ */
+void EcritureTrajectoire::Boucle()
+{
+    for (;;)
+    {
+        Image *image;
+        {
+            std::unique_lock<std::mutex> verrou(_Mutex);
+            _Condition.wait(verrou, [this] { return !_File.empty() || _Arret; });
+            if (_File.empty())
+                break;
+
+            image = _File.front();
+            _File.pop_front();
+        }
+        _Condition.notify_all();
+
+        Ecrit(*image);
+
+        std::lock_guard<std::mutex> verrou(_Mutex);
+        _Libres.push_back(image);
+    }
+}
+
+
+/**
+ * Ecriture d une image. Chaque composante est quantifiee sur 16 bits dans les bornes du domaine ;
+ * une image cle contient les entiers, une image delta leurs differences avec l image precedente
+ * (zigzag : 0, -1, 1, -2... deviennent 0, 1, 2, 3...) sur 7 bits par octet : un deplacement de
+ * moins de 64 pas de quantification tient en un octet.
+ */
+void EcritureTrajectoire::Ecrit(const Image &image)
+{
+    int n = _Entete.nb_particules;
+    if ((int)image.positions.size() != n)
+    {
+        std::cout << "Trajectoire : " << image.positions.size() << " positions au lieu de " << n
+                  << ", image " << image.iteration << " ignoree" << std::endl;
+        return;
+    }
+
+    _Courante.resize(3 * n);
+    for (int c = 0; c < 3; ++c)
+    {
+        float pmin = _Entete.min[c];
+        float echelle = _Entete.max[c] > pmin ? 65535.f / (_Entete.max[c] - pmin) : 0.f;
+        uint16_t *q = &_Courante[c * n];
+
+        for (int i = 0; i < n; ++i)
+        {
+            const Vector &p = image.positions[i];
+            float v = ((c == 0 ? p.x : (c == 1 ? p.y : p.z)) - pmin) * echelle + 0.5f;
+            q[i] = (uint16_t)std::min(std::max(v, 0.f), 65535.f);
+        }
+    }
+
+    uint32_t type = (_Index.size() % _Entete.periode_cle == 0) ? IMAGE_CLE : IMAGE_DELTA;
+
+    _Octets.clear();
+    if (type == IMAGE_CLE)
+    {
+        _Octets.resize(_Courante.size() * sizeof(uint16_t));
+        memcpy(_Octets.data(), _Courante.data(), _Octets.size());
+    }
+    else
+    {
+        for (int i = 0; i < 3 * n; ++i)
+        {
+            int d = (int)_Courante[i] - (int)_Precedente[i];
+            uint32_t z = d >= 0 ? 2 * (uint32_t)d : 2 * (uint32_t)(-d) - 1;
+            while (z >= 0x80)
+            {
+                _Octets.push_back((unsigned char)(z | 0x80));
+                z >>= 7;
+            }
+            _Octets.push_back((unsigned char)z);
+        }
+    }
+
+    EnteteImageTrajectoire entete;
+    entete.iteration = image.iteration;
+    entete.temps = image.temps;
+    entete.type = type;
+    entete.octets = (uint32_t)_Octets.size();
+
+    EntreeIndexTrajectoire entree;
+    entree.position = _Position;
+    entree.iteration = entete.iteration;
+    entree.temps = entete.temps;
+    entree.type = entete.type;
+    entree.octets = entete.octets;
+
+    if (fwrite(&entete, sizeof(entete), 1, _Fichier) != 1
+        || (entete.octets > 0 && fwrite(_Octets.data(), 1, _Octets.size(), _Fichier) != _Octets.size()))
+        _Erreur = true;
+
+    _Position += sizeof(entete) + _Octets.size();
+    _Index.push_back(entree);
+    _Precedente.swap(_Courante);
+}
+
+
+/**
+ * Fermeture : arret du thread apres l ecriture des images en attente, puis ecriture
+ * de l index et de la fin du fichier.
+ */
+bool EcritureTrajectoire::Ferme()
+{
+    if (_Fichier == NULL)
+        return false;
+
+    {
+        std::lock_guard<std::mutex> verrou(_Mutex);
+        _Arret = true;
+    }
+    _Condition.notify_all();
+    if (_Thread.joinable())
+        _Thread.join();
+
+    FinTrajectoire fin;
+    memset(&fin, 0, sizeof(fin));
+    fin.position_index = _Position;
+    fin.nb_images = (uint32_t)_Index.size();
+    memcpy(fin.magie, MAGIE_FIN_TRAJECTOIRE, sizeof(fin.magie));
+
+    if ((!_Index.empty() && fwrite(_Index.data(), sizeof(EntreeIndexTrajectoire), _Index.size(), _Fichier) != _Index.size())
+        || fwrite(&fin, sizeof(fin), 1, _Fichier) != 1)
+        _Erreur = true;
+
+    if (fclose(_Fichier) != 0)
+        _Erreur = true;
+    _Fichier = NULL;
+
+    if (_Erreur)
+        std::cout << "Trajectoire : erreur d ecriture" << std::endl;
+    else
+        std::cout << "Trajectoire : " << _Index.size() << " images, " << _Position << " octets" << std::endl;
+
+    return !_Erreur;
+}
+
+
+/**
+ * Destructeur.
+ */
+LectureTrajectoire::~LectureTrajectoire()
+{
+    if (_Fichier)
+        fclose(_Fichier);
+}
+
+
+/**
+ * Ouverture : verification de l entete et lecture de l index de fin de fichier,
+ * ou reconstruction de l index si le fichier n a pas ete ferme.
+ */
+bool LectureTrajectoire::Ouvre(const std::string &fichier)
+{
+    if (_Fichier)
+        fclose(_Fichier);
+    _Index.clear();
+    _Derniere = -1;
+
+    _Fichier = fopen(fichier.c_str(), "rb");
+    if (_Fichier == NULL)
+    {
+        std::cout << "Trajectoire : impossible d ouvrir " << fichier << std::endl;
+        return false;
+    }
+
+    if (fread(&_Entete, sizeof(_Entete), 1, _Fichier) != 1
+        || memcmp(_Entete.magie, MAGIE_TRAJECTOIRE, sizeof(_Entete.magie)) != 0
+        || _Entete.boutisme != BOUTISME_TRAJECTOIRE)
+    {
+        std::cout << "Trajectoire : " << fichier << " n est pas un fichier de trajectoire" << std::endl;
+        return false;
+    }
+    if (_Entete.version != VERSION_TRAJECTOIRE)
+    {
+        std::cout << "Trajectoire : version " << _Entete.version << " de " << fichier << " non supportee" << std::endl;
+        return false;
+    }
+
+    uint64_t taille = taille_fichier(_Fichier);
+
+    FinTrajectoire fin;
+    if (taille >= sizeof(_Entete) + sizeof(fin)
+        && deplace(_Fichier, taille - sizeof(fin)) == 0
+        && fread(&fin, sizeof(fin), 1, _Fichier) == 1
+        && memcmp(fin.magie, MAGIE_FIN_TRAJECTOIRE, sizeof(fin.magie)) == 0
+        && fin.position_index + (uint64_t)fin.nb_images * sizeof(EntreeIndexTrajectoire) + sizeof(fin) == taille)
+    {
+        _Index.resize(fin.nb_images);
+        if (fin.nb_images > 0
+            && (deplace(_Fichier, fin.position_index) != 0
+                || fread(_Index.data(), sizeof(EntreeIndexTrajectoire), _Index.size(), _Fichier) != _Index.size()))
+        {
+            std::cout << "Trajectoire : index illisible" << std::endl;
+            _Index.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // Pas d index : parcours des images completes
+    uint64_t position = sizeof(_Entete);
+    EnteteImageTrajectoire entete;
+    while (position + sizeof(entete) <= taille
+           && deplace(_Fichier, position) == 0
+           && fread(&entete, sizeof(entete), 1, _Fichier) == 1
+           && position + sizeof(entete) + entete.octets <= taille)
+    {
+        EntreeIndexTrajectoire entree;
+        entree.position = position;
+        entree.iteration = entete.iteration;
+        entree.temps = entete.temps;
+        entree.type = entete.type;
+        entree.octets = entete.octets;
+        _Index.push_back(entree);
+
+        position += sizeof(entete) + entete.octets;
+    }
+
+    std::cout << "Trajectoire : " << fichier << " non ferme, index reconstruit (" << _Index.size() << " images)" << std::endl;
+    return true;
+}
+
+
+/**
+ * Decodage de l image k ; une image delta s appuie sur l image k - 1, deja dans _Quantifie.
+ */
+bool LectureTrajectoire::Decode(int k)
+{
+    const EntreeIndexTrajectoire &entree = _Index[k];
+    int n = _Entete.nb_particules;
+
+    _Octets.resize(entree.octets);
+    if (deplace(_Fichier, entree.position + sizeof(EnteteImageTrajectoire)) != 0
+        || (entree.octets > 0 && fread(_Octets.data(), 1, entree.octets, _Fichier) != entree.octets))
+        return false;
+
+    if (entree.type == IMAGE_CLE)
+    {
+        if (entree.octets != 3 * n * sizeof(uint16_t))
+            return false;
+        _Quantifie.resize(3 * n);
+        memcpy(_Quantifie.data(), _Octets.data(), entree.octets);
+    }
+    else
+    {
+        if (_Derniere != k - 1 || (int)_Quantifie.size() != 3 * n)
+            return false;
+
+        size_t o = 0;
+        for (int i = 0; i < 3 * n; ++i)
+        {
+            uint32_t z = 0;
+            int decalage = 0;
+            for (;;)
+            {
+                if (o >= _Octets.size() || decalage > 28)
+                    return false;
+                unsigned char b = _Octets[o++];
+                z |= (uint32_t)(b & 0x7f) << decalage;
+                decalage += 7;
+                if ((b & 0x80) == 0)
+                    break;
+            }
+
+            int d = (z & 1) ? -(int)((z + 1) >> 1) : (int)(z >> 1);
+            _Quantifie[i] = (uint16_t)(_Quantifie[i] + d);
+        }
+    }
+
+    _Derniere = k;
+    return true;
+}
+
+
+/**
+ * Positions de l image k : decodage depuis l image cle precedente, ou depuis
+ * la derniere image decodee si elle se trouve entre les deux.
+ */
+bool LectureTrajectoire::Image(int k, std::vector<Vector> &positions)
+{
+    if (k < 0 || k >= (int)_Index.size())
+        return false;
+
+    if (_Derniere != k)
+    {
+        int debut = k;
+        while (debut > 0 && _Index[debut].type != IMAGE_CLE)
+            --debut;
+        if (_Index[debut].type != IMAGE_CLE)
+            return false;
+
+        if (_Derniere >= debut && _Derniere < k)
+            debut = _Derniere + 1;
+
+        for (int j = debut; j <= k; ++j)
+        {
+            if (!Decode(j))
+            {
+                std::cout << "Trajectoire : image " << j << " illisible" << std::endl;
+                _Derniere = -1;
+                return false;
+            }
+        }
+    }
+
+    int n = _Entete.nb_particules;
+    positions.resize(n);
+    float pas[3];
+    for (int c = 0; c < 3; ++c)
+        pas[c] = (_Entete.max[c] - _Entete.min[c]) / 65535.f;
+
+    for (int i = 0; i < n; ++i)
+        positions[i] = Vector(_Entete.min[0] + _Quantifie[i] * pas[0],
+                              _Entete.min[1] + _Quantifie[n + i] * pas[1],
+                              _Entete.min[2] + _Quantifie[2 * n + i] * pas[2]);
+    return true;
+}
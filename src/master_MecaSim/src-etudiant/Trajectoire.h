@@ -0,0 +1,225 @@
+/** \file Trajectoire.h
+ \brief Enregistrement des trajectoires des particules : positions quantifiees sur 16 bits,
+ codage differentiel et compactage, ecriture par un thread d entrees / sorties,
+ et relecture avec acces direct a chaque image grace a un index en fin de fichier.
+ */
+
+#ifndef TRAJECTOIRE_H
+#define TRAJECTOIRE_H
+
+
+/** Librairies de base **/
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Fichiers de gkit2light
+#include "vec.h"
+
+
+/// Identification d un fichier de trajectoire (debut et fin du fichier)
+const char MAGIE_TRAJECTOIRE[8] = {'M', 'E', 'C', 'A', 'T', 'R', 'A', 'J'};
+const char MAGIE_FIN_TRAJECTOIRE[8] = {'T', 'R', 'A', 'J', '-', 'F', 'I', 'N'};
+
+/// Version du format
+const uint32_t VERSION_TRAJECTOIRE = 1;
+
+/// Valeur ecrite pour detecter un fichier produit par une machine d un autre boutisme
+const uint32_t BOUTISME_TRAJECTOIRE = 0x01020304;
+
+/// Type d une image : positions quantifiees completes, ou differences avec l image precedente
+enum TypeImageTrajectoire
+{
+    IMAGE_CLE = 0,
+    IMAGE_DELTA = 1
+};
+
+
+/**
+ * \brief Entete du fichier.
+ * Format : EnteteTrajectoire, les images (EnteteImageTrajectoire suivi des donnees), l index
+ * (une EntreeIndexTrajectoire par image) et FinTrajectoire. Les donnees d une image sont rangees
+ * par composante (tous les x, puis les y, puis les z) : entiers sur 16 bits pour une image cle,
+ * differences en zigzag codees sur 1 a 3 octets (varint) pour une image delta.
+ */
+struct EnteteTrajectoire
+{
+    char magie[8];
+    uint32_t version;
+    uint32_t boutisme;
+    uint32_t nb_particules;
+    uint32_t periode;           //!< iterations entre deux images
+    uint32_t periode_cle;       //!< une image cle toutes les periode_cle images (1 : pas de codage differentiel)
+    float min[3], max[3];       //!< bornes du domaine de quantification
+};
+
+/**
+ * \brief Entete d une image.
+ */
+struct EnteteImageTrajectoire
+{
+    int32_t iteration;
+    float temps;
+    uint32_t type;              //!< TypeImageTrajectoire
+    uint32_t octets;            //!< taille des donnees qui suivent
+};
+
+/**
+ * \brief Entree de l index : position de l image dans le fichier.
+ */
+struct EntreeIndexTrajectoire
+{
+    uint64_t position;          //!< position de l EnteteImageTrajectoire
+    int32_t iteration;
+    float temps;
+    uint32_t type;
+    uint32_t octets;
+};
+
+/**
+ * \brief Fin du fichier : position de l index.
+ */
+struct FinTrajectoire
+{
+    uint64_t position_index;
+    uint32_t nb_images;
+    uint32_t reserve;
+    char magie[8];
+};
+
+
+/**
+ * \brief Ecriture d une trajectoire.
+ * Ajoute() copie les positions et rend la main ; un thread d entrees / sorties quantifie, code
+ * et ecrit les images dans l ordre. Au plus MAX_EN_ATTENTE images attendent d etre ecrites :
+ * au-dela, Ajoute() attend (la memoire reste bornee si le disque est plus lent que la simulation).
+ */
+class EcritureTrajectoire
+{
+public:
+
+    /// Nombre maximal d images en attente d ecriture
+    static const int MAX_EN_ATTENTE = 4;
+
+    /*! Constructeur */
+    EcritureTrajectoire();
+
+    /*! Destructeur : fermeture du fichier */
+    ~EcritureTrajectoire();
+
+    /*! Creation du fichier et lancement du thread d ecriture */
+    bool Ouvre(const std::string &fichier, int nb_particules, const Vector &pmin, const Vector &pmax,
+               int periode, int periode_cle);
+
+    /*! Ajout d une image (positions par identifiant de particule) */
+    void Ajoute(int iteration, float temps, const std::vector<Vector> &positions);
+
+    /*! Ecriture des images en attente, de l index, et fermeture */
+    bool Ferme();
+
+    /*! Indique si le fichier est ouvert */
+    bool EstOuvert() const { return _Fichier != NULL; }
+
+private:
+
+    /**
+     * \brief Image en attente d ecriture.
+     */
+    struct Image
+    {
+        int iteration;
+        float temps;
+        std::vector<Vector> positions;
+    };
+
+    /*! Boucle du thread d ecriture */
+    void Boucle();
+
+    /*! Quantification, codage et ecriture d une image */
+    void Ecrit(const Image &image);
+
+    /// Fichier
+    FILE *_Fichier;
+    EnteteTrajectoire _Entete;
+
+    /// Index des images ecrites
+    std::vector<EntreeIndexTrajectoire> _Index;
+    uint64_t _Position;
+    bool _Erreur;
+
+    /// Positions quantifiees de l image precedente et de l image courante, par composante
+    std::vector<uint16_t> _Precedente, _Courante;
+
+    /// Donnees codees d une image
+    std::vector<unsigned char> _Octets;
+
+    /// File des images a ecrire et images libres (reutilisees)
+    std::deque<Image *> _File, _Libres;
+    std::mutex _Mutex;
+    std::condition_variable _Condition;
+    bool _Arret;
+
+    /// Thread d ecriture
+    std::thread _Thread;
+};
+
+
+/**
+ * \brief Lecture d une trajectoire.
+ * L index de fin de fichier donne la position de chaque image ; une image delta est reconstruite
+ * a partir de l image cle qui la precede. La derniere image decodee est conservee : une lecture
+ * dans l ordre ne decode chaque image qu une fois. Si le fichier n a pas ete ferme (simulation
+ * interrompue), l index est reconstruit en parcourant les images.
+ */
+class LectureTrajectoire
+{
+public:
+
+    /*! Constructeur */
+    LectureTrajectoire() : _Fichier(NULL), _Derniere(-1) {}
+
+    /*! Destructeur */
+    ~LectureTrajectoire();
+
+    /*! Ouverture du fichier et lecture de l index */
+    bool Ouvre(const std::string &fichier);
+
+    /*! Entete du fichier */
+    const EnteteTrajectoire &Entete() const { return _Entete; }
+
+    /*! Nombre d images */
+    int NbImages() const { return (int)_Index.size(); }
+
+    /*! Description de l image k */
+    const EntreeIndexTrajectoire &Info(int k) const { return _Index[k]; }
+
+    /*! Positions de l image k */
+    bool Image(int k, std::vector<Vector> &positions);
+
+private:
+
+    /*! Decodage de l image k a partir de l image precedente (deja dans _Quantifie) */
+    bool Decode(int k);
+
+    /// Fichier
+    FILE *_Fichier;
+    EnteteTrajectoire _Entete;
+
+    /// Index des images
+    std::vector<EntreeIndexTrajectoire> _Index;
+
+    /// Positions quantifiees de la derniere image decodee, et son numero
+    std::vector<uint16_t> _Quantifie;
+    int _Derniere;
+
+    /// Donnees codees d une image
+    std::vector<unsigned char> _Octets;
+};
+
+
+#endif
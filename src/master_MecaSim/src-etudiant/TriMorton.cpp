@@ -0,0 +1,77 @@
+/** \file TriMorton.cpp
+ \brief Tri par base parallele des codes de Morton.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+#include "TriMorton.h"
+
+
+/// Nombre de valeurs d un chiffre (8 bits)
+const int NB_SEAUX = 256;
+
+
+/**
+ * Tri par base LSD parallele.
+ * A chaque passe (8 bits), chaque thread compte les chiffres de sa tranche de cles,
+ * les positions de depart sont obtenues par une somme prefixe (chiffre, thread),
+ * puis chaque thread place ses cles dans l ordre : le tri est stable
+ * et le resultat ne depend pas du nombre de threads.
+ */
+void TriRadixParallele(const std::vector<unsigned int> &cles, int nb_bits, std::vector<int> &perm)
+{
+    int n = (int)cles.size();
+
+    std::vector<unsigned int> cles_a(cles), cles_b(n);
+    std::vector<int> perm_a(n), perm_b(n);
+    for (int i = 0; i < n; ++i)
+        perm_a[i] = i;
+
+    std::vector<int> histo(omp_get_max_threads() * NB_SEAUX);
+
+    for (int decalage = 0; decalage < nb_bits; decalage += 8)
+    {
+#pragma omp parallel
+        {
+            int t = omp_get_thread_num();
+            int nb_threads = omp_get_num_threads();
+            int debut = (int)((long)n * t / nb_threads);
+            int fin = (int)((long)n * (t + 1) / nb_threads);
+            int *h = &histo[t * NB_SEAUX];
+
+            /* Histogramme de la tranche du thread */
+            std::fill(h, h + NB_SEAUX, 0);
+            for (int i = debut; i < fin; ++i)
+                h[(cles_a[i] >> decalage) & 0xFF]++;
+
+#pragma omp barrier
+#pragma omp single
+            {
+                /* Somme prefixe dans l ordre (chiffre, thread) */
+                int somme = 0;
+                for (int s = 0; s < NB_SEAUX; ++s)
+                    for (int u = 0; u < nb_threads; ++u)
+                    {
+                        int c = histo[u * NB_SEAUX + s];
+                        histo[u * NB_SEAUX + s] = somme;
+                        somme += c;
+                    }
+            }
+
+            /* Placement des cles de la tranche */
+            for (int i = debut; i < fin; ++i)
+            {
+                int pos = h[(cles_a[i] >> decalage) & 0xFF]++;
+                cles_b[pos] = cles_a[i];
+                perm_b[pos] = perm_a[i];
+            }
+        }
+
+        cles_a.swap(cles_b);
+        perm_a.swap(perm_b);
+    }
+
+    perm.swap(perm_a);
+}
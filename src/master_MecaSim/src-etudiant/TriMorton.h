@@ -0,0 +1,41 @@
+/** \file TriMorton.h
+ \brief Codes de Morton (courbe en Z) des cellules et tri par base parallele,
+ pour reordonner les particules en memoire selon leur position.
+ */
+
+#ifndef TRI_MORTON_H
+#define TRI_MORTON_H
+
+
+/** Librairies de base **/
+#include <vector>
+
+
+/**
+ * Ecarte les 10 bits de poids faible de v : bit k -> bit 3k.
+ */
+inline unsigned int EcarteBits(unsigned int v)
+{
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+/**
+ * Code de Morton 30 bits de la cellule (ix, iy, iz) : bits de x, y et z entrelaces.
+ * Deux cellules proches dans l espace ont le plus souvent des codes proches.
+ */
+inline unsigned int CodeMorton(int ix, int iy, int iz)
+{
+    return EcarteBits(ix) | (EcarteBits(iy) << 1) | (EcarteBits(iz) << 2);
+}
+
+
+/*! Tri par base (LSD, chiffres de 8 bits) parallele et stable : perm[k] = indice de la k-ieme plus petite cle */
+void TriRadixParallele(const std::vector<unsigned int> &cles, int nb_bits, std::vector<int> &perm);
+
+
+#endif
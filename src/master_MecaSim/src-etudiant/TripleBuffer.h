@@ -0,0 +1,69 @@
+/** \file TripleBuffer.h
+ \brief Echange sans verrou de donnees entre un thread producteur et un thread consommateur.
+ */
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+
+/** Librairies de base **/
+#include <atomic>
+
+
+/**
+ * \brief Triple tampon : le producteur remplit un tampon pendant que le consommateur lit un autre ;
+ * le troisieme contient la derniere donnee publiee.
+ * Publier et lire echangent un indice avec le tampon du milieu par une seule operation atomique :
+ * aucun thread n attend l autre, le consommateur voit toujours la donnee publiee la plus recente
+ * et les donnees intermediaires non lues sont ecrasees.
+ * Les tampons ne sont jamais reallooues : des std::vector gardent leur capacite d un echange a l autre.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+
+    /*! Constructeur : tampon 0 en lecture, 1 au milieu, 2 en ecriture */
+    TripleBuffer() : _Milieu(1), _Ecriture(2), _Lecture(0) {}
+
+    /*! Tampon a remplir (thread producteur uniquement) */
+    T &Ecriture() { return _Tampons[_Ecriture]; }
+
+    /*! Publication du tampon rempli ; le producteur recupere l ancien tampon du milieu */
+    void Publie()
+    {
+        _Ecriture = _Milieu.exchange(_Ecriture | NOUVEAU, std::memory_order_acq_rel) & INDICE;
+    }
+
+    /*! Indique si une donnee a ete publiee depuis la derniere lecture */
+    bool Nouveau() const { return (_Milieu.load(std::memory_order_relaxed) & NOUVEAU) != 0; }
+
+    /*! Derniere donnee publiee (thread consommateur uniquement) ; la meme que precedemment si rien n a ete publie */
+    const T &Lecture()
+    {
+        if (_Milieu.load(std::memory_order_relaxed) & NOUVEAU)
+            _Lecture = _Milieu.exchange(_Lecture, std::memory_order_acq_rel) & INDICE;
+        return _Tampons[_Lecture];
+    }
+
+private:
+
+    /// Indice d un tampon et marque de publication dans _Milieu
+    static const int INDICE = 3;
+    static const int NOUVEAU = 4;
+
+    /// Les trois tampons
+    T _Tampons[3];
+
+    /// Indice du tampon du milieu (et marque NOUVEAU s il n a pas ete lu)
+    std::atomic<int> _Milieu;
+
+    /// Indice du tampon du producteur
+    int _Ecriture;
+
+    /// Indice du tampon du consommateur
+    int _Lecture;
+};
+
+
+#endif
@@ -9,6 +9,7 @@
 
 #include "draw.h"
 #include "Viewer.h"
+#include "ObjetSimuleSPH.h"
 
 using namespace std;
 
@@ -87,6 +88,39 @@ void Viewer::init_plan(float x, float y, float z)
 }
 
 
+/*
+ * Creation du maillage (aretes des triangles) des frontieres de forme quelconque
+ * et des maillages de collision des objets SPH.
+ */
+void Viewer::init_frontiere()
+{
+    m_frontiere = Mesh(GL_LINES);
+    
+    // Couleur des frontieres
+    m_frontiere.color( Color(1, 0.5, 0));
+    
+    ListeNoeuds::iterator e;
+    for (e = _Simu->_enfants.begin(); e != _Simu->_enfants.end(); e++)
+    {
+        ObjetSimuleSPH *sph = dynamic_cast<ObjetSimuleSPH *>(*e);
+        if (sph == NULL)
+            continue;
+        
+        for (int m = 0; m < 2; m++)
+        {
+            const std::vector<Vector> &s = m == 0 ? sph->_SommetsFrontiere : sph->_SommetsCollision;
+            const std::vector<int> &t = m == 0 ? sph->_TrianglesFrontiere : sph->_TrianglesCollision;
+            for (size_t k = 0; k + 2 < t.size(); k += 3)
+                for (int a = 0; a < 3; a++)
+                {
+                    m_frontiere.vertex( Point(s[t[k + a]]) );
+                    m_frontiere.vertex( Point(s[t[k + (a + 1) % 3]]) );
+                }
+        }
+    }
+}
+
+
 /*
  * Creation du maillage d un cube.
  */
@@ -226,17 +260,34 @@ int Viewer::init()
     init_grid();
     init_cube();
     init_sphere();
+    init_frontiere();
+    
+    // Affichage instancie des particules : une sphere par particule, un seul draw
+    m_rendu_particules.init(m_sphere);
+    m_coloration = CHAMP_AUCUN;
     
     // Creation du plan (x, y, z) - plan utilise pour les ObjetSimule::Collision(x, y, z);
     // Rq : pas vraiment le plan, mais < x, < y, < z
     //init_plan(0, 0, 0);
     
+    // Console texte du profilage
+    m_console = create_text();
+    
     // Initialisation du Tps
     Tps = 0;
     
     // Point interaction
     MousePos = Vector(0, 0, 0);
     
+    // Simulation dans son propre thread, ou une iteration par image (cf update)
+    if (_Simu->_Asynchrone)
+    {
+        m_simulation = new SimulationAsynchrone(_Simu);
+        m_simulation->Demarre();
+    }
+    else
+        SimulationAsynchrone::Capture(*_Simu, m_coloration, 0, m_image);
+    
     return 0;
     
 }
@@ -9,6 +9,7 @@
 
 #include "draw.h" // pour dessiner du point de vue d'une camera
 #include "Viewer.h"
+#include "Profilage.h"
 #include "Scene.h"
 
 #include "ObjetSimule.h"
@@ -18,6 +19,8 @@
  * Constructeur.
  */
 Viewer::Viewer() : App(1024, 768),
+                   _Simu(NULL),
+                   m_simulation(NULL),
                    mb_cullface(true),   // Par defaut - gestion des faces cachees
                    mb_wireframe(false), // Par defaut - affiche plein
                    b_draw_grid(true),   // Par defaut - affiche la grille
@@ -29,6 +32,7 @@ Viewer::Viewer() : App(1024, 768),
  * Constructeur dans le cas ou il y a une simulation mecanique.
  */
 Viewer::Viewer(string *Fichier_Param, int NbObj) : App(1024, 768),
+                                                   m_simulation(NULL),
                                                    mb_cullface(true),   // Par defaut - gestion des faces cachees
                                                    mb_wireframe(false), // Par defaut - affiche plein
                                                    b_draw_grid(true),   // Par defaut - affiche la grille
@@ -69,7 +73,10 @@ void Viewer::help()
     cout << "   c: (des)active GL_CULL_FACE" << endl;
     cout << "   w: (des)active wireframe" << endl;
     cout << "   a: (des)active l'affichage de l'axe" << endl;
-    cout << "   g: (des)active l'affichage de la grille" << endl
+    cout << "   g: (des)active l'affichage de la grille" << endl;
+    cout << "   p: (des)active le profilage (temps de chaque phase de la simulation)" << endl;
+    cout << "   v: coloration des particules (unie, densite, vitesse)" << endl;
+    cout << "   i: affichage des particules (spheres, imposteurs, points)" << endl
          << endl;
 
     cout << "   m+fleche/pageUp/pageDown: pour bouger point interaction" << endl
@@ -151,36 +158,50 @@ int Viewer::render()
     }
 
     /// Interaction avec l utilisateur
-    _Simu->Interaction(MousePos);
+    if (m_simulation)
+        m_simulation->Interaction(MousePos);
+    else
+        _Simu->Interaction(MousePos);
     MousePos = Vector(0, 0, 0);
 
     /* Affichage des objets */
-    Transform T;
-    T = Translation(0, 3, 0);
+    // Derniere image terminee par la simulation (lue sans verrou si elle tourne dans son thread)
+    const ImageSimulation &image = m_simulation ? m_simulation->Lecture() : m_image;
 
-    ListeNoeuds::iterator e;
-    int num = 0;
-
-    for (e = _Simu->_enfants.begin(); e != _Simu->_enfants.end(); e++)
+    // Cas systeme de particules non connectees :
+    // toutes les particules d un objet en un seul draw (spheres instanciees, imposteurs ou points)
+    for (unsigned int i = 0; i < image.objets.size(); i++)
     {
+        m_rendu_particules.draw(image.objets[i].P, image.objets[i].valeurs,
+                                m_camera.view(), m_camera.projection((float)window_width(), (float)window_height(), 45),
+                                gl.light(), White());
+    }
 
-        // Cas systeme de particules non connectees
-
-        // Affichage des particules
-        for (int i = 0; i < (*e)->_Nb_Sommets; i++)
-        {
+    /* Temps de chaque phase de la simulation */
+    if (image.profilage)
+        draw_profilage(image);
 
-            // Positionnement en fonction de la position de la particule
-            gl.model(Translation(Vector((*e)->P[i])));
+    return 1;
+}
 
-            // Affichage d une sphere pour modeliser une particule
-            gl.draw(m_sphere);
-        }
+/*
+ * Affichage des temps de chaque phase de la simulation :
+ * moyenne et centiles sur les dernieres iterations (copies dans l image par la simulation).
+ */
+void Viewer::draw_profilage(const ImageSimulation &image)
+{
+    clear(m_console);
+    printf(m_console, 0, 0, "iteration %ld", image.nb_iterations_profil);
+    printf(m_console, 0, 1, "phase          moy(ms)  p50(ms)  p95(ms)  p99(ms)");
 
-        num++;
+    for (int p = 0; p < NB_PHASES; p++)
+    {
+        const StatistiquesPhase &s = image.phases[p];
+        printf(m_console, 0, 2 + p, "%-14s %7.3f  %7.3f  %7.3f  %7.3f",
+               NOMS_PHASES[p], s.moyenne, s.p50, s.p95, s.p99);
     }
 
-    return 1;
+    draw(m_console, window_width(), window_height());
 }
 
 /*
@@ -196,14 +217,27 @@ int Viewer::update(const float time, const float delta)
     /* Mise a jour du maillage des objets du graphe de scene de la simulation  */
     /***************************************************************************/
 
+    /// Simulation dans son propre thread : seule la coloration est transmise
+    if (m_simulation)
+    {
+        m_simulation->Coloration(m_coloration);
+        return 1;
+    }
+
     /// Calcul de l animation
     _Simu->Simulation(Tps);
     /// Mise a jour du Mesh en fct des positions calculees
     ListeNoeuds::iterator e;
+    for (e = _Simu->_enfants.begin(); e != _Simu->_enfants.end(); e++)
+        (*e)->updateVertex();
+
     /// Le temps qui passe...
     Tps = Tps + 1;
     //cout << "Temps : " << Tps << endl;
 
+    /// Image affichee par render
+    SimulationAsynchrone::Capture(*_Simu, m_coloration, Tps, m_image);
+
     return 1;
 }
 
@@ -323,6 +357,27 @@ void Viewer::manageCameraLight()
         clear_key_state('a');
     }
 
+    // Coloration des particules : unie, densite, vitesse
+    if (key_state('v'))
+    {
+        m_coloration = ChampScalaire((m_coloration + 1) % NB_CHAMPS);
+        clear_key_state('v');
+    }
+
+    // Affichage des particules : spheres, imposteurs, points
+    if (key_state('i'))
+    {
+        m_rendu_particules._Mode = ModeRendu((m_rendu_particules._Mode + 1) % NB_MODES_RENDU);
+        clear_key_state('i');
+    }
+
+    // Profilage : oui/non
+    if (key_state('p'))
+    {
+        Profilage::Active(!Profilage::EstActif());
+        clear_key_state('p');
+    }
+
     // Camera
     gl.camera(m_camera);
 
@@ -332,6 +387,8 @@ void Viewer::manageCameraLight()
         gl.draw(m_grid);
     if (b_draw_axe)
         gl.draw(m_axe);
+    if (m_frontiere.vertex_count() > 0)
+        gl.draw(m_frontiere);
 
     // Affichage d un cube representant la position de la LIGHT
     gl.texture(0);
@@ -341,5 +398,20 @@ void Viewer::manageCameraLight()
 
 int Viewer::quit()
 {
+    // Arret de la simulation avant la destruction des objets openGL
+    if (m_simulation)
+    {
+        m_simulation->Arret();
+        delete m_simulation;
+        m_simulation = NULL;
+    }
+
+    // Destruction de la scene et de ses objets (fermeture des trajectoires)
+    delete _Simu;
+    _Simu = NULL;
+
+    release_text(m_console);
+    m_rendu_particules.release();
+    m_frontiere.release();
     return 0;
 }
@@ -0,0 +1,244 @@
+/** \file main-batch.cpp
+ \brief Simulation sans fenetre (ni SDL, ni OpenGL) : les iterations s enchainent
+ le plus vite possible et le debit (pas par seconde) est affiche a la fin.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "vec.h"
+#include "Scene.h"
+#include "ObjetSimuleSPH.h"
+#include "Profilage.h"
+
+using namespace std;
+
+
+/**
+ * Energie totale (cinetique, de pesanteur et interne) des objets SPH de la scene.
+ */
+static double EnergieScene(Scene *Simu)
+{
+    double total = 0;
+    ListeNoeuds::iterator e;
+    for (e = Simu->_enfants.begin(); e != Simu->_enfants.end(); e++)
+    {
+        ObjetSimuleSPH *sph = dynamic_cast<ObjetSimuleSPH *>(*e);
+        if (sph == NULL)
+            continue;
+
+        double cinetique, potentielle, interne;
+        sph->Energies(Simu->_g, cinetique, potentielle, interne);
+        total += cinetique + potentielle + interne;
+    }
+    return total;
+}
+
+
+int main( int argc, char **argv )
+{
+    std::cout << "----------------------------------------" << std::endl;
+
+    /// Nombre d iterations demande en ligne de commande (sinon nbiter du fichier de la simulation)
+    int NbIter = -1;
+
+    /// Fichier des statistiques de profilage (CSV, ou JSON si le nom finit par .json)
+    string FichierProfil;
+
+    /// Fichier de reprise a charger avant la simulation
+    string FichierRestart;
+
+    /// Fichier de reprise a ecrire (a la fin, et toutes les PeriodeCheckpoint iterations si > 0)
+    string FichierCheckpoint;
+    int PeriodeCheckpoint = 0;
+
+    /// Arguments restants : NbObj <Fichier_Param_Anim> <Fichier_Param_Obj1> ...
+    std::vector<char *> args;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            NbIter = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--profil") == 0 && i + 1 < argc)
+            FichierProfil = argv[++i];
+        else if (strcmp(argv[i], "--restart") == 0 && i + 1 < argc)
+            FichierRestart = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+            FichierCheckpoint = argv[++i];
+        else if (strcmp(argv[i], "--periode") == 0 && i + 1 < argc)
+            PeriodeCheckpoint = atoi(argv[++i]);
+        else
+            args.push_back(argv[i]);
+    }
+
+    /// Nombre d objets presents dans la simulation mecanique
+    int NbObj = 1;
+
+    /// Noms des fichiers de parametres (element 0 : simulation, element i : objet i)
+    std::vector<string> Fichier_Param;
+
+    if (args.empty())
+    {
+        // Memes fichiers par defaut que l executable avec fenetre
+        Fichier_Param.push_back("./src/master_MecaSim/exec/Fichier_Param.simu");
+        Fichier_Param.push_back("./src/master_MecaSim/exec/Fichier_Param.objet1");
+    }
+
+    else
+    {
+        NbObj = atoi(args[0]);
+
+        if (NbObj < 1 || (int)args.size() < NbObj + 2)
+        {
+            /// Usage de l execution du programme
+            cout << "Usage depuis le repertoire gkit2light:" << endl;
+            cout << "<executable> [-n NbIter] [--profil stats.csv|stats.json] [--restart etat.bin] [--checkpoint etat.bin [--periode N]]"
+                 << " NbObj <Fichier_Param_Anim> <Fichier_Param_Obj1> <Fichier_Param_Obj2> ..." << endl << endl;
+
+            cout << "Exemple pour un seul objet et 1000 iterations : " << endl;
+            cout << "./bin/master_MecaSim_batch -n 1000 1 ./src/master_MecaSim/exec/Fichier_Param.simu ./src/master_MecaSim/exec/Fichier_Param.objet1" << endl;
+
+            /// Arret du programme
+            exit(1);
+        }
+
+        for (int i = 0; i <= NbObj; i++)
+            Fichier_Param.push_back(args[i + 1]);
+    }
+
+    cout << "Fichiers de donnees de la simulation : " << Fichier_Param[0] << endl;
+
+    for (int i = 1; i <= NbObj; i++)
+        cout << "Fichier de donnees de l objet " << i << " : " << Fichier_Param[i] << endl;
+
+
+    if (!FichierProfil.empty())
+        Profilage::Active(true);
+
+
+    /** Graphe de scene, construit comme dans le Viewer mais sans maillage d affichage **/
+    Scene *Simu = new Scene(Fichier_Param[0], NbObj);
+
+    for (int i = 1; i <= Simu->_NbObj; i++)
+    {
+        cout << "Creation de l objet " << i << " de type : " << Simu->_type_objet[i - 1] << endl;
+        Simu->attache(new ObjetSimuleSPH(Fichier_Param[i]));
+    }
+
+    Simu->initObjetSimule();
+
+    /// Reprise d une simulation sauvegardee : les iterations reprennent la ou elles s etaient arretees
+    int TpsDebut = 0;
+    if (!FichierRestart.empty())
+    {
+        if (!Simu->Reprise(FichierRestart, TpsDebut))
+        {
+            cout << "Echec de la reprise depuis " << FichierRestart << endl;
+            exit(1);
+        }
+        cout << "Reprise depuis " << FichierRestart << " a l iteration " << TpsDebut << endl;
+    }
+
+    if (NbIter < 0)
+        NbIter = Simu->_nb_iter;
+
+    // Pas de temps deja effectues par chaque objet (non nuls apres une reprise)
+    int NbParticules = 0;
+    std::vector<long> PasDebut;
+    ListeNoeuds::iterator e;
+    for (e = Simu->_enfants.begin(); e != Simu->_enfants.end(); e++)
+    {
+        NbParticules += (*e)->_Nb_Sommets;
+        ObjetSimuleSPH *sph = dynamic_cast<ObjetSimuleSPH *>(*e);
+        PasDebut.push_back(sph ? sph->_Pas : 0);
+    }
+
+    cout << "Simulation sans affichage : " << NbIter << " iterations, "
+         << NbParticules << " particules" << endl;
+
+
+    /// Energie au debut, pour mesurer la derive du schema d integration
+    double EnergieDebut = EnergieScene(Simu);
+
+    /** Boucle de simulation **/
+    std::chrono::steady_clock::time_point debut = std::chrono::steady_clock::now();
+    int Progression = NbIter >= 10 ? NbIter / 10 : 1;
+
+    for (int Tps = TpsDebut; Tps < TpsDebut + NbIter; Tps++)
+    {
+        Simu->Simulation(Tps);
+
+        if ((Tps + 1 - TpsDebut) % Progression == 0)
+            cout << "Iteration " << Tps + 1 - TpsDebut << " / " << NbIter << endl;
+
+        if (!FichierCheckpoint.empty() && PeriodeCheckpoint > 0 && (Tps + 1) % PeriodeCheckpoint == 0)
+            Simu->Sauvegarde(FichierCheckpoint, Tps + 1);
+    }
+
+    std::chrono::steady_clock::time_point fin = std::chrono::steady_clock::now();
+    double duree = std::chrono::duration<double>(fin - debut).count();
+
+    /** Sauvegarde de l etat final **/
+    if (!FichierCheckpoint.empty())
+    {
+        if (Simu->Sauvegarde(FichierCheckpoint, TpsDebut + NbIter))
+            cout << "Etat sauvegarde dans " << FichierCheckpoint << endl;
+        else
+            cout << "Erreur de sauvegarde de " << FichierCheckpoint << endl;
+    }
+
+
+    /** Debit **/
+    // En mode pas de temps adaptatif, une iteration (image) compte plusieurs sous-pas
+    long NbPas = NbIter;
+    double ParticulesPas = 0;
+    int i = 0;
+    for (e = Simu->_enfants.begin(); e != Simu->_enfants.end(); e++, i++)
+    {
+        ObjetSimuleSPH *sph = dynamic_cast<ObjetSimuleSPH *>(*e);
+        long pas = sph ? sph->_Pas - PasDebut[i] : NbIter;
+        NbPas = std::max(NbPas, pas);
+        ParticulesPas += (double)(*e)->_Nb_Sommets * pas;
+    }
+
+    cout << "----------------------------------------" << endl;
+    cout << "Duree : " << duree << " s" << endl;
+    cout << "Iterations par seconde : " << NbIter / duree << endl;
+    cout << "Pas de temps par seconde : " << NbPas / duree << " (" << NbPas << " pas)" << endl;
+    cout << "Particules x pas par seconde : " << ParticulesPas / duree << endl;
+
+    /** Derive de l energie (les rebonds amortis sur les murs et frontieres dissipent aussi de l energie) **/
+    double EnergieFin = EnergieScene(Simu);
+    cout << "Energie : " << EnergieDebut << " -> " << EnergieFin << " (variation relative "
+         << (EnergieFin - EnergieDebut) / std::max(fabs(EnergieDebut), 1e-30) << ")" << endl;
+
+    /** Statistiques par phase **/
+    if (Profilage::EstActif())
+    {
+        Profilage &profil = Profilage::Instance();
+
+        cout << "Phase          moyenne(ms)   p50(ms)   p95(ms)   p99(ms)" << endl;
+        for (int p = 0; p < NB_PHASES; p++)
+        {
+            StatistiquesPhase s = profil.Statistiques(p);
+            printf("%-14s %11.3f %9.3f %9.3f %9.3f\n", NOMS_PHASES[p], s.moyenne, s.p50, s.p95, s.p99);
+        }
+
+        if (!FichierProfil.empty())
+        {
+            if (profil.Ecrit(FichierProfil))
+                cout << "Statistiques de profilage ecrites dans " << FichierProfil << endl;
+            else
+                cout << "Erreur d ecriture de " << FichierProfil << endl;
+        }
+    }
+
+    delete Simu;
+
+    return 0;
+}
@@ -0,0 +1,398 @@
+/** \file main-bench.cpp
+ \brief Micro-benchmarks des calculs SPH (voisins, densites, pressions, forces, integration,
+ collisions, pas complet) sur des blocs de particules synthetiques de taille et de densite
+ choisies : echauffement, repetitions, statistiques, et ecriture des resultats en JSON
+ pour suivre les regressions d un commit a l autre. Sans fenetre (ni SDL, ni OpenGL).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <omp.h>
+
+#include "vec.h"
+#include "Scene.h"
+#include "ObjetSimuleSPH.h"
+
+using namespace std;
+
+
+/**
+ * \brief Statistiques des durees d un calcul sur les repetitions (en ms).
+ */
+struct StatistiquesBench
+{
+    double min, p50, moyenne, ecart_type, p95, max;
+};
+
+
+/**
+ * \brief Mesure d un calcul sur un bloc de particules.
+ */
+struct MesureBench
+{
+    /// Nom du calcul
+    string nom;
+
+    /// Statistiques des durees
+    StatistiquesBench stats;
+};
+
+
+/**
+ * \brief Resultats pour un bloc de particules.
+ */
+struct BlocBench
+{
+    /// Nombre de particules par cote, nombre total de particules
+    int cote, particules;
+
+    /// Taille des particules et espacement initial
+    float h, espacement;
+
+    /// Nombre de paires de voisins (listes de la passe de densite)
+    long paires;
+
+    /// Mesures des calculs
+    std::vector<MesureBench> mesures;
+};
+
+
+/**
+ * Statistiques (minimum, mediane, moyenne, ecart type, centile 95, maximum) des durees.
+ */
+static StatistiquesBench Statistiques(std::vector<double> durees)
+{
+    StatistiquesBench s;
+    int n = (int)durees.size();
+    std::sort(durees.begin(), durees.end());
+
+    double somme = 0, somme2 = 0;
+    for (int k = 0; k < n; k++)
+    {
+        somme += durees[k];
+        somme2 += durees[k] * durees[k];
+    }
+
+    s.min = durees[0];
+    s.max = durees[n - 1];
+    s.p50 = durees[(int)(0.50 * (n - 1) + 0.5)];
+    s.p95 = durees[(int)(0.95 * (n - 1) + 0.5)];
+    s.moyenne = somme / n;
+    s.ecart_type = n > 1 ? sqrt(std::max(0.0, (somme2 - n * s.moyenne * s.moyenne) / (n - 1))) : 0;
+    return s;
+}
+
+
+/**
+ * Mesure d un calcul : echauffement appels non mesures, puis repetitions appels mesures.
+ * preparation (non mesuree) remet l etat necessaire avant chaque appel de calcul.
+ */
+template <class Preparation, class Calcul>
+static MesureBench Mesure(const char *nom, int echauffement, int repetitions,
+                          Preparation preparation, Calcul calcul)
+{
+    std::vector<double> durees;
+
+    for (int k = 0; k < echauffement + repetitions; k++)
+    {
+        preparation();
+
+        std::chrono::steady_clock::time_point debut = std::chrono::steady_clock::now();
+        calcul();
+        std::chrono::steady_clock::time_point fin = std::chrono::steady_clock::now();
+
+        if (k >= echauffement)
+            durees.push_back(std::chrono::duration<double, std::milli>(fin - debut).count());
+    }
+
+    MesureBench m;
+    m.nom = nom;
+    m.stats = Statistiques(durees);
+    return m;
+}
+
+
+/**
+ * Bloc synthetique de cote^3 particules, comme la boite de initObjetSimule : la boite [0, 0.5)^3
+ * est remplie avec un espacement h / espacement, et h est choisi pour y placer cote particules
+ * par cote (espacement fixe donc le nombre de voisins par particule). Les longueurs relatives
+ * a h (skin des listes de Verlet, pas du champ de distance, epaisseur de collision) suivent h.
+ */
+static void CreeBloc(ObjetSimuleSPH *sph, int cote, float espacement)
+{
+    const float pas = 0.5f / cote;
+    const float echelle = espacement * pas / sph->h;
+
+    sph->h *= echelle;
+    sph->_Skin *= echelle;
+    sph->_PasFrontiere *= echelle;
+    sph->_EpaisseurCollision *= echelle;
+
+    sph->initFrontiere();
+    sph->initMaillageCollision();
+
+    sph->_Nb_Sommets = 0;
+    for (int i = 0; i < cote; i++)
+        for (int j = 0; j < cote; j++)
+            for (int k = 0; k < cote; k++)
+            {
+                sph->_Particules.push_back(Vector(i * pas, j * pas, k * pas), 1);
+                ++sph->_Nb_Sommets;
+            }
+
+    sph->initEtatParticules();
+}
+
+
+/**
+ * Mesure de chacun des calculs d un pas de temps sur un bloc de cote^3 particules.
+ * Renvoie aussi les noms des noyaux SIMD et du schema d integration utilises.
+ */
+static BlocBench MesureBloc(const string &fichier_objet, int cote, float espacement,
+                            Vector gravite, float viscosite, int echauffement, int repetitions,
+                            string &noyaux, string &integration)
+{
+    ObjetSimuleSPH *sph = new ObjetSimuleSPH(fichier_objet);
+    CreeBloc(sph, cote, espacement);
+    noyaux = sph->_Noyaux->nom;
+    integration = sph->_SolveurExpl->Nom();
+
+    BlocBench bloc;
+    bloc.cote = cote;
+    bloc.particules = sph->_Nb_Sommets;
+    bloc.h = sph->h;
+    bloc.espacement = espacement;
+    bloc.paires = sph->_Voisins.NbPaires();
+
+    const int nb = sph->_Nb_Sommets;
+    ParticleStore &part = sph->_Particules;
+    SolveurExpl *solveur = sph->_SolveurExpl;
+
+    // Etat complet d un pas (densites, pressions, forces) avant les calculs qui en dependent
+    auto etat_forces = [&]() {
+        sph->Reinitialisation();
+        sph->CalculDensite();
+        sph->CalculPression();
+        sph->CalculInteraction(viscosite);
+    };
+    auto rien = []() {};
+
+    // Grille et listes de Verlet reconstruites a chaque appel, sans reordonnancement
+    sph->_ProchainTri = INT_MAX;
+    bloc.mesures.push_back(Mesure("voisins", echauffement, repetitions,
+                                  [&]() { sph->_VerletValide = false; },
+                                  [&]() { sph->PreparationVoisins(1); }));
+
+    bloc.mesures.push_back(Mesure("tri_morton", echauffement, repetitions, rien,
+                                  [&]() { sph->ReordonneParticules(); }));
+
+    // Listes de voisins coherentes avec l ordre courant des particules
+    sph->_VerletValide = false;
+    sph->PreparationVoisins(1);
+
+    bloc.mesures.push_back(Mesure("densite", echauffement, repetitions, rien,
+                                  [&]() { sph->Reinitialisation(); sph->CalculDensite(); }));
+
+    bloc.mesures.push_back(Mesure("pression", echauffement, repetitions, rien,
+                                  [&]() { sph->CalculPression(); }));
+
+    bloc.mesures.push_back(Mesure("interaction", echauffement, repetitions,
+                                  [&]() { sph->Reinitialisation(); sph->CalculDensite(); sph->CalculPression(); },
+                                  [&]() { sph->CalculInteraction(viscosite); }));
+
+    bloc.mesures.push_back(Mesure("solve", echauffement, repetitions, etat_forces,
+                                  [&]() { solveur->Solve(gravite, sph->MursIntegration(), nb, part); }));
+
+    bloc.mesures.push_back(Mesure("collision", echauffement, repetitions, rien,
+                                  [&]() { sph->Collision(); }));
+
+    // Un sous-pas complet (en mode adaptatif, borne par la duree d une image comme dans Simulation)
+    const float duree_max = solveur->_Adaptatif ? sph->_DureeImage : solveur->_delta_t;
+    bloc.mesures.push_back(Mesure("pas", echauffement, repetitions, rien,
+                                  [&]() { sph->PasDeTemps(gravite, viscosite, duree_max); }));
+
+    delete sph;
+    return bloc;
+}
+
+
+/**
+ * Ecriture des resultats au format JSON (un objet par bloc, une mesure par calcul).
+ */
+static bool EcritJSON(const string &fichier, const string &etiquette, const string &noyaux,
+                      const string &integration, int threads, int echauffement, int repetitions,
+                      const std::vector<BlocBench> &blocs)
+{
+    FILE *f = fopen(fichier.c_str(), "w");
+    if (f == NULL)
+        return false;
+
+    fprintf(f, "{\n  \"etiquette\": \"%s\",\n  \"noyaux\": \"%s\",\n  \"integration\": \"%s\",\n"
+               "  \"threads\": %d,\n  \"echauffement\": %d,\n  \"repetitions\": %d,\n  \"blocs\": [\n",
+            etiquette.c_str(), noyaux.c_str(), integration.c_str(), threads, echauffement, repetitions);
+
+    for (unsigned int b = 0; b < blocs.size(); b++)
+    {
+        const BlocBench &bloc = blocs[b];
+        fprintf(f, "    {\"cote\": %d, \"particules\": %d, \"h\": %g, \"espacement\": %g, \"paires\": %ld,\n"
+                   "     \"mesures\": [\n",
+                bloc.cote, bloc.particules, bloc.h, bloc.espacement, bloc.paires);
+
+        for (unsigned int m = 0; m < bloc.mesures.size(); m++)
+        {
+            const StatistiquesBench &s = bloc.mesures[m].stats;
+            fprintf(f, "       {\"calcul\": \"%s\", \"min_ms\": %.6f, \"p50_ms\": %.6f, \"moyenne_ms\": %.6f, "
+                       "\"ecart_type_ms\": %.6f, \"p95_ms\": %.6f, \"max_ms\": %.6f, \"particules_par_s\": %.6g}%s\n",
+                    bloc.mesures[m].nom.c_str(), s.min, s.p50, s.moyenne, s.ecart_type, s.p95, s.max,
+                    s.p50 > 0 ? bloc.particules / (s.p50 * 1e-3) : 0.0,
+                    m + 1 < bloc.mesures.size() ? "," : "");
+        }
+        fprintf(f, "     ]}%s\n", b + 1 < blocs.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+
+    fclose(f);
+    return true;
+}
+
+
+int main( int argc, char **argv )
+{
+    std::cout << "----------------------------------------" << std::endl;
+
+    /// Nombres de particules par cote des blocs mesures
+    std::vector<int> Cotes;
+
+    /// Rapport h / espacement initial des particules (1.4 comme initObjetSimule)
+    float Espacement = 1.4f;
+
+    /// Appels non mesures puis mesures de chaque calcul
+    int Echauffement = 3;
+    int Repetitions = 20;
+
+    /// Fichier JSON des resultats, et etiquette enregistree avec (par exemple le commit)
+    string FichierJSON = "bench.json";
+    string Etiquette;
+
+    /// Arguments restants : <Fichier_Param_Anim> <Fichier_Param_Obj>
+    std::vector<char *> args;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--cote") == 0 && i + 1 < argc)
+        {
+            // liste separee par des virgules : 16,32,64
+            for (char *c = strtok(argv[++i], ","); c != NULL; c = strtok(NULL, ","))
+                Cotes.push_back(atoi(c));
+        }
+        else if (strcmp(argv[i], "--espacement") == 0 && i + 1 < argc)
+            Espacement = atof(argv[++i]);
+        else if (strcmp(argv[i], "--echauffement") == 0 && i + 1 < argc)
+            Echauffement = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc)
+            Repetitions = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            FichierJSON = argv[++i];
+        else if (strcmp(argv[i], "--etiquette") == 0 && i + 1 < argc)
+            Etiquette = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+
+    if (Cotes.empty())
+    {
+        Cotes.push_back(16);
+        Cotes.push_back(32);
+        Cotes.push_back(64);
+    }
+
+    /// Noms des fichiers de parametres (element 0 : simulation, element 1 : objet)
+    std::vector<string> Fichier_Param;
+
+    if (args.empty())
+    {
+        // Memes fichiers par defaut que l executable avec fenetre
+        Fichier_Param.push_back("./src/master_MecaSim/exec/Fichier_Param.simu");
+        Fichier_Param.push_back("./src/master_MecaSim/exec/Fichier_Param.objet1");
+    }
+
+    else if (args.size() == 2)
+    {
+        Fichier_Param.push_back(args[0]);
+        Fichier_Param.push_back(args[1]);
+    }
+
+    else
+    {
+        /// Usage de l execution du programme
+        cout << "Usage depuis le repertoire gkit2light:" << endl;
+        cout << "<executable> [--cote 16,32,64] [--espacement 1.4] [--echauffement 3] [--repetitions 20]"
+             << " [--json bench.json] [--etiquette nom] [<Fichier_Param_Anim> <Fichier_Param_Obj>]" << endl << endl;
+
+        cout << "Exemple : " << endl;
+        cout << "./bin/master_MecaSim_bench --cote 32,64 --json bench.json --etiquette $(git rev-parse --short HEAD)" << endl;
+
+        /// Arret du programme
+        exit(1);
+    }
+
+    for (unsigned int c = 0; c < Cotes.size(); c++)
+    {
+        if (Cotes[c] < 2)
+        {
+            cout << "Cote de bloc invalide : " << Cotes[c] << endl;
+            exit(1);
+        }
+    }
+
+    Repetitions = std::max(Repetitions, 1);
+    Echauffement = std::max(Echauffement, 0);
+
+    cout << "Fichiers de donnees de la simulation : " << Fichier_Param[0] << endl;
+    cout << "Fichier de donnees de l objet : " << Fichier_Param[1] << endl;
+
+    /** Gravite et viscosite de la simulation **/
+    Scene *Simu = new Scene(Fichier_Param[0], 1);
+    Vector gravite = Simu->_g;
+    float viscosite = Simu->_visco;
+    delete Simu;
+
+    int threads = omp_get_max_threads();
+
+    /** Mesures, bloc par bloc **/
+    std::vector<BlocBench> blocs;
+    string noyaux, integration;
+
+    for (unsigned int c = 0; c < Cotes.size(); c++)
+    {
+        cout << "----------------------------------------" << endl;
+        blocs.push_back(MesureBloc(Fichier_Param[1], Cotes[c], Espacement, gravite, viscosite,
+                                   Echauffement, Repetitions, noyaux, integration));
+
+        const BlocBench &bloc = blocs.back();
+        printf("Bloc %d^3 : %d particules, h = %g, %ld paires\n", bloc.cote, bloc.particules, bloc.h, bloc.paires);
+        printf("Calcul          min(ms)   p50(ms)  moyenne(ms)  ecart(ms)   p95(ms)   particules/s\n");
+        for (unsigned int m = 0; m < bloc.mesures.size(); m++)
+        {
+            const StatistiquesBench &s = bloc.mesures[m].stats;
+            printf("%-14s %8.3f %9.3f %12.3f %10.3f %9.3f %14.4g\n", bloc.mesures[m].nom.c_str(),
+                   s.min, s.p50, s.moyenne, s.ecart_type, s.p95,
+                   s.p50 > 0 ? bloc.particules / (s.p50 * 1e-3) : 0.0);
+        }
+    }
+
+    cout << "----------------------------------------" << endl;
+    if (EcritJSON(FichierJSON, Etiquette, noyaux, integration, threads, Echauffement, Repetitions, blocs))
+        cout << "Resultats ecrits dans " << FichierJSON << endl;
+    else
+        cout << "Erreur d ecriture de " << FichierJSON << endl;
+
+    return 0;
+}